@@ -0,0 +1,100 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <Json.h>
+
+using namespace emb;
+
+
+/**
+ * Benchmark of the JSON reader and writer on a large document.
+ * Usage: JsonBenchmark [number of records]
+ */
+int main(int argc, char **argv) {
+
+    using clock = std::chrono::steady_clock;
+
+    // number of records
+    unsigned long records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // write document (sink appends to a string, the writer itself only uses the small buffer)
+    std::string document;
+    document.reserve(records * 96);
+    char buffer[4096];
+    JsonWriter writer(buffer, sizeof(buffer), [&document](const char *data, unsigned long size) {
+        document.append(data, size);
+    });
+
+    auto t0 = clock::now();
+
+    writer.beginArray();
+    for(unsigned long i = 0; i < records; ++i) {
+
+        writer.beginObject();
+        writer.key("id").value(i);
+        writer.key("state").value("running");
+        writer.key("time").value((double) i * 0.001);
+        writer.key("values").beginArray().value(1.5).value(-2).value(true).endArray();
+        writer.endObject();
+
+    }
+
+    writer.endArray();
+    writer.flush();
+
+    auto t1 = clock::now();
+
+    // read document
+    JsonReader reader(document.data(), document.size());
+    unsigned long tokens = 0;
+    double sum = 0.0;
+
+    JsonToken token;
+    while((token = reader.next()) != JsonToken::End && token != JsonToken::Error) {
+
+        if(token == JsonToken::Number)
+            sum += reader.number();
+
+        tokens++;
+
+    }
+
+    auto t2 = clock::now();
+
+    // report
+    auto mb = (double) document.size() / (1024.0 * 1024.0);
+    auto write = std::chrono::duration<double>(t1 - t0).count();
+    auto read = std::chrono::duration<double>(t2 - t1).count();
+
+    std::printf("document: %.1f MB, %lu tokens (checksum %g)%s\n", mb, tokens, sum,
+            token == JsonToken::Error ? " ERROR" : "");
+    std::printf("write:    %8.3f s  %8.1f MB/s\n", write, mb / write);
+    std::printf("read:     %8.3f s  %8.1f MB/s\n", read, mb / read);
+
+    return token == JsonToken::Error ? 1 : 0;
+
+}
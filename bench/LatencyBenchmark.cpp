@@ -0,0 +1,346 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-18.
+//
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <State.h>
+
+using namespace emb;
+
+typedef std::chrono::steady_clock Clock;
+
+
+/** Stimulus state of one machine, shared between the stimulus and the control thread */
+struct Probe {
+
+    std::atomic<bool> busy{false};          //!< Stimulus in flight (cleared when the machine is back in idle)
+    std::atomic<bool> condition{false};     //!< Condition read by the guard of the idle state
+    std::atomic<long long> stimulus{0};     //!< Time stamp of the stimulus in nanoseconds
+    bool event = false;                     //!< Kind of the stimulus in flight (control thread only)
+
+};
+
+
+/** Returns the monotonic time in nanoseconds */
+static long long now() {
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+
+}
+
+
+/** Pins the calling thread to a CPU and optionally switches it to SCHED_FIFO */
+static void configure(const char *name, int cpu, int priority) {
+
+    if(cpu >= 0) {
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % (int) std::max(1u, std::thread::hardware_concurrency()), &set);
+
+        auto error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if(error != 0)
+            std::printf("%s: pinning failed (%s)\n", name, std::strerror(error));
+
+    }
+
+    if(priority > 0) {
+
+        sched_param param{};
+        param.sched_priority = priority;
+
+        auto error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if(error != 0)
+            std::printf("%s: SCHED_FIFO failed (%s)\n", name, std::strerror(error));
+
+    }
+
+}
+
+
+/** Prints the percentiles of the latencies in microseconds */
+static void report(const char *name, std::vector<double> &latencies) {
+
+    if(latencies.empty()) {
+        std::printf("%-22s no samples\n", name);
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    // nearest rank
+    auto percentile = [&latencies](double p) {
+        auto rank = (unsigned long) (p * (double) latencies.size() + 0.999999);
+        return latencies[std::min(latencies.size(), std::max(1ul, rank)) - 1];
+    };
+
+    std::printf("%-22s %8lu %10.2f %10.2f %10.2f %10.2f\n", name, (unsigned long) latencies.size(),
+                percentile(0.5), percentile(0.99), percentile(0.999), latencies.back());
+
+}
+
+
+/** Prints the usage */
+static void usage(const char *name) {
+
+    std::printf("Usage: %s [machines] [stimuli] [load threads] [period us] [realtime] [cpu] [interval us]\n"
+                "  machines:     number of machines (>= 1, default 100)\n"
+                "  stimuli:      number of stimuli (default 10000)\n"
+                "  load threads: number of busy threads (default 0)\n"
+                "  period:       step period of the control loop (0: busy loop, default 1000)\n"
+                "  realtime:     1 locks the memory and runs with SCHED_FIFO (needs CAP_SYS_NICE, default 0)\n"
+                "  cpu:          CPU of the control thread, the stimulus thread runs on the next (-1: off, default)\n"
+                "  interval:     maximum random pause between two stimuli (default 100)\n", name);
+
+}
+
+
+/** Parses the argument at the index (if given) as integer of at least the minimum, returns false if invalid */
+static bool argument(int argc, char **argv, int index, long minimum, long &value) {
+
+    if(argc <= index)
+        return true;
+
+    char *end = nullptr;
+    errno = 0;
+    auto parsed = std::strtol(argv[index], &end, 10);
+    if(end == argv[index] || *end != '\0' || errno != 0 || parsed < minimum)
+        return false;
+
+    value = parsed;
+    return true;
+
+}
+
+
+/**
+ * Reaction latency benchmark: time from a stimulus (an event posted or a guard condition becoming true in another
+ * thread) until onEnter of the target state runs on the control thread, measured with a monotonic clock.
+ * Usage: LatencyBenchmark [machines] [stimuli] [load threads] [period us] [realtime] [cpu] [interval us]
+ *   period:   step period of the control loop (0: busy loop)
+ *   realtime: 1 locks the memory and runs the control and stimulus thread with SCHED_FIFO (needs CAP_SYS_NICE)
+ *   cpu:      pins the control thread and the load threads to this CPU, the stimulus thread to the next (-1: off)
+ *   interval: maximum random pause between two stimuli
+ */
+int main(int argc, char **argv) {
+
+    // configuration
+    long machineCount = 100, stimulusCount = 10000, loadCount = 0, period = 1000, rt = 0, cpuIndex = -1, interval = 100;
+
+    for(int i = 1; i < argc; ++i) {
+        if(std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return 0;
+        }
+    }
+
+    if(argc > 8 || !argument(argc, argv, 1, 1, machineCount) || !argument(argc, argv, 2, 0, stimulusCount)
+            || !argument(argc, argv, 3, 0, loadCount) || !argument(argc, argv, 4, 0, period)
+            || !argument(argc, argv, 5, 0, rt) || !argument(argc, argv, 6, -1, cpuIndex)
+            || !argument(argc, argv, 7, 0, interval)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto machines = (unsigned long) machineCount;
+    auto stimuli = (unsigned long) stimulusCount;
+    auto loadThreads = (unsigned long) loadCount;
+    auto realtime = rt != 0;
+    auto cpu = (int) cpuIndex;
+
+    if(realtime && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        std::printf("mlockall failed (%s)\n", std::strerror(errno));
+
+    // machines: idle -> active on event 1 or on the condition, active -> idle in the next step
+    std::vector<Probe> probes(machines);
+    std::vector<std::unique_ptr<State>> roots{};
+    std::vector<double> eventLatencies{}, conditionLatencies{};
+    eventLatencies.reserve(stimuli);
+    conditionLatencies.reserve(stimuli);
+
+    for(unsigned long i = 0; i < machines; ++i) {
+
+        auto probe = &probes[i];
+        roots.emplace_back(new State);
+
+        auto idle = roots.back()->createState();
+        auto active = roots.back()->createState();
+
+        idle->addEventTransition(1, active);
+        idle->addTransition([probe](const Transition *) { return probe->condition.load(std::memory_order_acquire); },
+                            active);
+        active->addTransition([](const Transition *) { return true; }, idle);
+
+        active->onEnter = [probe, &eventLatencies, &conditionLatencies](const Transition *) {
+
+            auto latency = (double) (now() - probe->stimulus.load(std::memory_order_acquire)) * 1e-3;
+            (probe->event ? eventLatencies : conditionLatencies).push_back(latency);
+
+            probe->event = false;
+            probe->condition.store(false, std::memory_order_relaxed);
+
+        };
+
+        idle->onEnter = [probe](const Transition *) { probe->busy.store(false, std::memory_order_release); };
+        idle->initialize();
+
+    }
+
+    // mailbox for events (the event queues belong to the control thread)
+    std::mutex mutex{};
+    std::vector<unsigned long> mailbox{}, delivery{};
+    mailbox.reserve(machines);
+    delivery.reserve(machines);
+
+    std::atomic<bool> running{true};
+    std::atomic<unsigned long> steps{0};
+
+    // load
+    std::vector<std::thread> load{};
+    for(unsigned long i = 0; i < loadThreads; ++i) {
+
+        load.emplace_back([&running, cpu]() {
+
+            configure("load", cpu, 0);
+
+            volatile double x = 1.0;
+            while(running.load(std::memory_order_relaxed))
+                x = x * 1.0000001 + 1e-9;
+
+        });
+
+    }
+
+    // control loop
+    std::thread control([&]() {
+
+        configure("control", cpu, realtime ? 80 : 0);
+
+        auto next = Clock::now();
+        while(running.load(std::memory_order_relaxed)) {
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::swap(mailbox, delivery);
+            }
+
+            for(auto i : delivery) {
+                probes[i].event = true;
+                roots[i]->post(Event{1});
+            }
+
+            delivery.clear();
+
+            for(auto &root : roots)
+                root->step();
+
+            steps++;
+
+            if(period > 0) {
+                next += std::chrono::microseconds(period);
+                std::this_thread::sleep_until(next);
+            }
+
+        }
+
+    });
+
+    // stimuli
+    std::thread stimulus([&]() {
+
+        configure("stimulus", cpu >= 0 ? cpu + 1 : -1, realtime ? 79 : 0);
+
+        std::mt19937 random{1};
+        std::uniform_int_distribution<long> pause(0, interval);
+
+        for(unsigned long k = 0; k < stimuli; ++k) {
+
+            auto &probe = probes[k % machines];
+
+            // the machine must be back in idle
+            while(probe.busy.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            std::this_thread::sleep_for(std::chrono::microseconds(pause(random)));
+
+            probe.busy.store(true, std::memory_order_relaxed);
+            probe.stimulus.store(now(), std::memory_order_release);
+
+            // alternating events and conditions
+            if(k % 2 == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                mailbox.push_back(k % machines);
+            } else {
+                probe.condition.store(true, std::memory_order_release);
+            }
+
+        }
+
+        // wait for the last reactions
+        for(auto &probe : probes) {
+            while(probe.busy.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+    });
+
+    auto t0 = Clock::now();
+    stimulus.join();
+    auto t1 = Clock::now();
+
+    running = false;
+    control.join();
+    for(auto &t : load)
+        t.join();
+
+    // report
+    std::vector<double> all{eventLatencies};
+    all.insert(all.end(), conditionLatencies.begin(), conditionLatencies.end());
+
+    std::printf("machines:              %lu\n", machines);
+    std::printf("load threads:          %lu\n", loadThreads);
+    std::printf("period:                %ld us%s\n", period, period > 0 ? "" : " (busy loop)");
+    std::printf("realtime:              %s, cpu %d\n", realtime ? "SCHED_FIFO" : "off", cpu);
+    std::printf("duration:              %.3f s, %lu steps\n",
+                std::chrono::duration<double>(t1 - t0).count(), steps.load());
+    std::printf("\n%-22s %8s %10s %10s %10s %10s\n", "latency [us]", "count", "p50", "p99", "p99.9", "max");
+    report("event", eventLatencies);
+    report("condition", conditionLatencies);
+    report("all", all);
+
+    return 0;
+
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-25.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <Series.h>
+
+using namespace emb;
+
+
+/**
+ * Benchmark of the cost of SeriesRecorder::record() on the calling thread: plain samples, samples completing a
+ * block (write and fflush) and the worst flush including the rotation of the files.
+ * Usage: SeriesBenchmark [number of samples] [samples per block] [file size in bytes]
+ */
+int main(int argc, char **argv) {
+
+    using clock = std::chrono::steady_clock;
+
+    // arguments
+    unsigned long samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    unsigned long block = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1024;
+    unsigned long fileSize = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 64 * 1024;
+
+    // machine toggling between two states
+    double level = 0.0, pressure = 1.0;
+    State root{};
+    auto low = root.createState();
+    auto high = root.createState();
+    low->addTransition([&level](const Transition *) { return level > 50.0; }, high);
+    high->addTransition([&level](const Transition *) { return level <= 50.0; }, low);
+    low->initialize();
+
+    std::string path = "/tmp/series_benchmark.bin";
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 0.01);
+    recorder.addSignal("pressure", &pressure, 0.0001);
+    recorder.setBlockSize(block);
+
+    if(!recorder.open(path.c_str(), fileSize, 3)) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+
+    // plain samples and samples writing a block
+    double plain = 0.0, plainMax = 0.0, flush = 0.0, flushMax = 0.0;
+    unsigned long flushes = 0;
+
+    for(unsigned long i = 0; i < samples; ++i) {
+
+        level = (double) (i % 100);
+        pressure = 1.0 + 0.001 * (double) (i % 7);
+        root.step();
+
+        auto written = recorder.written();
+        auto t0 = clock::now();
+        recorder.record(0.001 * (double) i);
+        auto duration = std::chrono::duration<double>(clock::now() - t0).count();
+
+        if(recorder.written() != written) {
+            flush += duration;
+            flushMax = std::max(flushMax, duration);
+            flushes++;
+        } else {
+            plain += duration;
+            plainMax = std::max(plainMax, duration);
+        }
+
+    }
+
+    recorder.close();
+
+    // report
+    auto plainCount = samples - flushes;
+    std::printf("samples: %lu, blocks: %lu, written: %.1f MB\n", samples, flushes,
+            (double) recorder.written() / (1024.0 * 1024.0));
+    std::printf("record:  mean %8.3f us  max %8.3f us\n", plainCount > 0 ? plain / (double) plainCount * 1e6 : 0.0,
+            plainMax * 1e6);
+    std::printf("block:   mean %8.3f us  max %8.3f us\n", flushes > 0 ? flush / (double) flushes * 1e6 : 0.0,
+            flushMax * 1e6);
+    std::printf("worst flush incl. rotation: %.3f us\n", recorder.worstFlush() * 1e6);
+
+    std::remove(path.c_str());
+    for(int i = 1; i < 3; ++i)
+        std::remove((path + "." + std::to_string(i)).c_str());
+
+    return 0;
+
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-04.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <Audit.h>
+#include <Generator.h>
+
+using namespace emb;
+
+
+/**
+ * Stress and scaling benchmark on random machines (also checks the invariants after every step).
+ * Usage: StressBenchmark [states] [depth] [fan-out] [transitions per state] [guard probability] [guard cost] [steps]
+ *                        [seed]
+ */
+int main(int argc, char **argv) {
+
+    using clock = std::chrono::steady_clock;
+
+    // configuration
+    GeneratorConfig config{};
+    config.states = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    config.depth = argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 20;
+    config.fanOut = argc > 3 ? (unsigned int) std::strtoul(argv[3], nullptr, 10) : 8;
+    config.transitions = argc > 4 ? (unsigned int) std::strtoul(argv[4], nullptr, 10) : 100;
+    config.probability = argc > 5 ? std::strtod(argv[5], nullptr) : 0.001;
+    config.guardCost = argc > 6 ? (unsigned int) std::strtoul(argv[6], nullptr, 10) : 0;
+    auto steps = argc > 7 ? std::strtoul(argv[7], nullptr, 10) : 100000;
+    config.seed = argc > 8 ? std::strtoul(argv[8], nullptr, 10) : 1;
+
+    // build
+    auto buildAllocations = AllocationAudit::allocations();
+    auto buildBytes = AllocationAudit::bytes();
+    auto t0 = clock::now();
+
+    MachineGenerator generator{config};
+
+    auto t1 = clock::now();
+    buildAllocations = AllocationAudit::allocations() - buildAllocations;
+    buildBytes = AllocationAudit::bytes() - buildBytes;
+
+    // run
+    generator.initialize();
+    auto &machine = generator.machine();
+    unsigned long runAllocations = 0, violations = 0, transitionSteps = 0;
+    double stepTime = 0.0, transitionTime = 0.0, worst = 0.0;
+    std::string message{};
+
+    for(unsigned long i = 0; i < steps; ++i) {
+
+        auto count = machine.getTransitionCount();
+        auto before = AllocationAudit::allocations();
+        auto s0 = clock::now();
+
+        machine.step();
+
+        auto s1 = clock::now();
+        runAllocations += AllocationAudit::allocations() - before;
+
+        auto duration = std::chrono::duration<double, std::micro>(s1 - s0).count();
+        worst = std::max(worst, duration);
+
+        // steps with and without transition
+        if(machine.getTransitionCount() != count) {
+            transitionTime += duration;
+            transitionSteps++;
+        } else {
+            stepTime += duration;
+        }
+
+        if(!generator.check(&message) && violations++ == 0)
+            std::printf("invariant violated in step %lu: %s\n", i, message.c_str());
+
+    }
+
+    auto plainSteps = steps - transitionSteps;
+
+    // report
+    std::printf("states:               %lu (%lu leaves, depth %u)\n", generator.states(), generator.leaves(),
+                generator.depth());
+    std::printf("transitions:          %lu per leaf\n", (unsigned long) config.transitions);
+    std::printf("build:                %.3f ms, %lu allocations\n",
+                std::chrono::duration<double, std::milli>(t1 - t0).count(), buildAllocations);
+    std::printf("memory per state:     %.1f bytes (heap, incl. transitions)\n",
+                (double) buildBytes / (double) std::max(1ul, generator.states()));
+    std::printf("step:                 %.3f us (mean without transition)\n",
+                plainSteps > 0 ? stepTime / (double) plainSteps : 0.0);
+    std::printf("transition step:      %.3f us (mean, %lu steps)\n",
+                transitionSteps > 0 ? transitionTime / (double) transitionSteps : 0.0, transitionSteps);
+    std::printf("worst step:           %.3f us\n", worst);
+    std::printf("guard evaluations:    %lu\n", generator.evaluations());
+    std::printf("allocations per step: %.3f\n", (double) runAllocations / (double) std::max(1ul, steps));
+    std::printf("invariant violations: %lu\n", violations);
+
+    return violations == 0 ? 0 : 1;
+
+}
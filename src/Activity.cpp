@@ -0,0 +1,166 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-17.
+//
+
+#include "Activity.h"
+
+using namespace emb;
+
+
+void Activity::start(State *state) {
+
+    _state = state;
+    _line = 0;
+    _wakeUp = 0.0;
+    _sleeping = false;
+    _finished = false;
+
+}
+
+
+void Activity::cancel() {
+
+    _state = nullptr;
+    _line = 0;
+    _sleeping = false;
+
+}
+
+
+void Activity::resume() {
+
+    // only run when started and not finished
+    if(!running() || !body)
+        return;
+
+    body(*this);
+
+}
+
+
+bool Activity::finished() const {
+
+    return _finished;
+
+}
+
+
+bool Activity::running() const {
+
+    return _state != nullptr && !_finished;
+
+}
+
+
+State *Activity::state() const {
+
+    return _state;
+
+}
+
+
+double Activity::wakeUpTime() const {
+
+    return _wakeUp;
+
+}
+
+
+bool Activity::sleeping() const {
+
+    return running() && _sleeping;
+
+}
+
+
+unsigned int &Activity::resumePoint() {
+
+    return _line;
+
+}
+
+
+void Activity::sleep(double seconds) {
+
+    _wakeUp = _state->getTime() + seconds;
+    _sleeping = true;
+
+}
+
+
+bool Activity::awake() {
+
+    if(_state->getTime() < _wakeUp)
+        return false;
+
+    // end timed wait
+    _sleeping = false;
+    return true;
+
+}
+
+
+void Activity::finish() {
+
+    _finished = true;
+
+}
+
+
+void ActivityState::_activate() {
+
+    // start activity with the state
+    State::_activate();
+    activity.start(this);
+
+}
+
+
+void ActivityState::_deactivate() {
+
+    // cancel the activity
+    activity.cancel();
+    State::_deactivate();
+
+}
+
+
+void ActivityState::_run() {
+
+    // run step callback and resume the activity
+    State::_run();
+    activity.resume();
+
+}
+
+
+double ActivityState::_deadline(double now) const {
+
+    auto deadline = State::_deadline(now);
+
+    // wake-up of the activity (when not stepped regularly anyway)
+    if(_timeStepSize <= 0.0 && activity.sleeping() && now - getTime() + activity.wakeUpTime() < deadline)
+        deadline = now - getTime() + activity.wakeUpTime();
+
+    return deadline;
+
+}
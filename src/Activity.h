@@ -0,0 +1,173 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-17.
+//
+
+
+#ifndef STATE_MACHINE_ACTIVITY_H
+#define STATE_MACHINE_ACTIVITY_H
+
+#include <functional>
+#include "State.h"
+
+/**
+ * @brief Starts the body of an activity. Must be the first statement of the body.
+ * Activities are stackless: local variables do not survive an await, keep them in captured variables instead. The
+ * await macros must not be used within nested switch statements.
+ */
+#define EMB_ACTIVITY_BEGIN(activity) switch((activity).resumePoint()) { case 0:
+
+/** @brief Ends the body of an activity. Must be the last statement of the body. */
+#define EMB_ACTIVITY_END(activity) } (activity).finish()
+
+/** @brief Suspends the activity until the condition is fulfilled (checked once per step) */
+#define EMB_AWAIT(activity, condition) \
+    do { (activity).resumePoint() = __LINE__; case __LINE__: if(!(condition)) return; } while(0)
+
+/** @brief Suspends the activity for the given time in seconds */
+#define EMB_AWAIT_TIME(activity, seconds) \
+    do { (activity).sleep(seconds); (activity).resumePoint() = __LINE__; case __LINE__: if(!(activity).awake()) return; } while(0)
+
+/** @brief Suspends the activity until the event with the given id is present */
+#define EMB_AWAIT_EVENT(activity, eventId) \
+    EMB_AWAIT(activity, (activity).state()->currentEvent() != nullptr && (activity).state()->currentEvent()->id == (eventId))
+
+/** @brief Suspends the activity until the next step */
+#define EMB_YIELD(activity) \
+    do { (activity).resumePoint() = __LINE__; return; case __LINE__:; } while(0)
+
+namespace emb {
+
+    class Activity;
+
+    typedef std::function<void (Activity &activity)> ActivityCallback; //!< Type definition for activity bodies
+
+
+    /**
+     * @brief Sequential behaviour of a state which can wait without blocking.
+     * The body is a resumable function written with the EMB_ACTIVITY_* and EMB_AWAIT* macros. It runs until the
+     * next await and is resumed in the following steps of the state. The resume point is kept in the activity
+     * itself, so no frame has to be allocated.
+     */
+    class Activity {
+
+    protected:
+
+        State *_state = nullptr;     //!< State the activity belongs to
+        unsigned int _line = 0;      //!< Resume point
+        double _wakeUp = 0.0;        //!< State time to wake up (for timed waits)
+        bool _sleeping = false;      //!< Flag whether the activity is in a timed wait
+        bool _finished = false;      //!< Flag whether the body has finished
+
+    public:
+
+        ActivityCallback body{};     //!< The body of the activity
+
+
+        /**
+         * @brief Starts the activity from the beginning (cancels a running one)
+         * @param state The state the activity runs in
+         */
+        void start(State *state);
+
+
+        /**
+         * @brief Cancels the activity
+         */
+        void cancel();
+
+
+        /**
+         * @brief Resumes the activity until the next await
+         */
+        void resume();
+
+
+        /**
+         * Returns whether the activity has finished its body
+         * @return Flag
+         */
+        bool finished() const;
+
+
+        /**
+         * Returns whether the activity is started and not finished
+         * @return Flag
+         */
+        bool running() const;
+
+
+        /**
+         * Returns the state the activity runs in
+         * @return The state
+         */
+        State *state() const;
+
+
+        /**
+         * Returns the state time at which a timed wait ends
+         * @return Wake-up time (state time in seconds)
+         */
+        double wakeUpTime() const;
+
+
+        /**
+         * Returns whether the activity is in a timed wait
+         * @return Flag
+         */
+        bool sleeping() const;
+
+
+        /** Access to the resume point (used by the macros) */
+        unsigned int &resumePoint();
+
+        /** Sets the wake-up time relative to the current state time (used by the macros) */
+        void sleep(double seconds);
+
+        /** Returns whether the wake-up time has passed and ends the timed wait (used by the macros) */
+        bool awake();
+
+        /** Marks the body as finished (used by the macros) */
+        void finish();
+
+    };
+
+
+    /**
+     * @brief State which runs an activity.
+     * The activity is started on entry, resumed in every step after the step callback and cancelled on exit.
+     */
+    struct ActivityState : public State {
+
+        Activity activity{}; //!< The activity of the state
+
+    protected:
+
+        void _activate() override;
+        void _deactivate() override;
+        void _run() override;
+        double _deadline(double now) const override;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_ACTIVITY_H
@@ -0,0 +1,193 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-10.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "Audit.h"
+
+#ifdef __GLIBC__
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+using namespace emb;
+
+
+namespace {
+
+    thread_local unsigned long allocationCount = 0;
+    thread_local unsigned long allocatedBytes = 0;
+    thread_local unsigned long violationCount = 0;
+    thread_local unsigned int noAllocDepth = 0;
+    thread_local bool handling = false;
+
+    AllocationViolationHandler violationHandler = &AllocationAudit::printViolation;
+
+
+    void *allocate(std::size_t size) {
+
+        allocationCount++;
+        allocatedBytes += size;
+
+        // report allocations within no-alloc scopes (allocations of the handler itself are not reported)
+        if(noAllocDepth > 0 && !handling) {
+
+            violationCount++;
+            handling = true;
+            violationHandler((unsigned long) size);
+            handling = false;
+
+        }
+
+        return std::malloc(size > 0 ? size : 1);
+
+    }
+
+}
+
+
+// counting replacements of the global allocation functions
+void *operator new(std::size_t size) {
+
+    auto pointer = allocate(size);
+    if(pointer == nullptr)
+        throw std::bad_alloc();
+
+    return pointer;
+
+}
+
+
+void *operator new[](std::size_t size) {
+
+    return operator new(size);
+
+}
+
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+
+    return allocate(size);
+
+}
+
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+
+    return allocate(size);
+
+}
+
+
+void operator delete(void *pointer) noexcept {
+
+    std::free(pointer);
+
+}
+
+
+void operator delete[](void *pointer) noexcept {
+
+    std::free(pointer);
+
+}
+
+
+void operator delete(void *pointer, std::size_t) noexcept {
+
+    std::free(pointer);
+
+}
+
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+
+    std::free(pointer);
+
+}
+
+
+unsigned long AllocationAudit::allocations() {
+
+    return allocationCount;
+
+}
+
+
+unsigned long AllocationAudit::bytes() {
+
+    return allocatedBytes;
+
+}
+
+
+unsigned long AllocationAudit::violations() {
+
+    return violationCount;
+
+}
+
+
+void AllocationAudit::setViolationHandler(AllocationViolationHandler handler) {
+
+    violationHandler = handler != nullptr ? handler : &AllocationAudit::printViolation;
+
+}
+
+
+void AllocationAudit::printViolation(unsigned long size) {
+
+    std::fprintf(stderr, "allocation of %lu bytes in no-alloc scope\n", size);
+
+#ifdef __GLIBC__
+
+    // symbols are written directly to the file descriptor (no allocation)
+    void *frames[32];
+    auto count = backtrace(frames, 32);
+    backtrace_symbols_fd(frames, count, STDERR_FILENO);
+
+#endif
+
+}
+
+
+ScopedNoAlloc::ScopedNoAlloc() : _start(allocationCount) {
+
+    noAllocDepth++;
+
+}
+
+
+ScopedNoAlloc::~ScopedNoAlloc() {
+
+    noAllocDepth--;
+
+}
+
+
+unsigned long ScopedNoAlloc::allocations() const {
+
+    return allocationCount - _start;
+
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-10.
+//
+
+
+#ifndef STATE_MACHINE_AUDIT_H
+#define STATE_MACHINE_AUDIT_H
+
+namespace emb {
+
+    typedef void (*AllocationViolationHandler)(unsigned long size); //!< Type definition for violation handlers (must not allocate)
+
+
+    /**
+     * @brief Counts the heap allocations of the current thread.
+     * Linking the library `state_audit` replaces the global operator new and delete of the executable with counting
+     * versions (the library must not be linked together with another replacement). Counters are kept per thread.
+     */
+    class AllocationAudit {
+
+    public:
+
+        /**
+         * Returns the number of allocations of the current thread
+         * @return Number of allocations
+         */
+        static unsigned long allocations();
+
+
+        /**
+         * Returns the number of bytes allocated by the current thread
+         * @return Number of bytes
+         */
+        static unsigned long bytes();
+
+
+        /**
+         * Returns the number of allocations of the current thread within ScopedNoAlloc scopes
+         * @return Number of violations
+         */
+        static unsigned long violations();
+
+
+        /**
+         * @brief Sets the function called on each allocation within a ScopedNoAlloc scope.
+         * The default handler writes the size and a backtrace of the allocation to stderr (where available).
+         * @param handler Handler (nullptr restores the default handler)
+         */
+        static void setViolationHandler(AllocationViolationHandler handler);
+
+
+        /**
+         * @brief Default violation handler: writes the size and a backtrace to stderr
+         * @param size Size of the allocation
+         */
+        static void printViolation(unsigned long size);
+
+    };
+
+
+    /**
+     * @brief Marks a scope in which the current thread must not allocate.
+     * Every allocation within the scope calls the violation handler and is counted, so tests can check the hot path
+     * of a machine, e.g. `ScopedNoAlloc scope{}; machine.step(); EXPECT_EQ(0, scope.allocations());`. Scopes can be
+     * nested.
+     */
+    class ScopedNoAlloc {
+
+    protected:
+
+        unsigned long _start;       //!< Number of allocations of the thread at construction
+
+    public:
+
+        ScopedNoAlloc();
+        ~ScopedNoAlloc();
+
+        ScopedNoAlloc(const ScopedNoAlloc &) = delete;
+        ScopedNoAlloc &operator=(const ScopedNoAlloc &) = delete;
+
+
+        /**
+         * Returns the number of allocations since construction
+         * @return Number of allocations
+         */
+        unsigned long allocations() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_AUDIT_H
@@ -0,0 +1,347 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-16.
+//
+
+#include <algorithm>
+#include "Batch.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMB_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define EMB_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace emb;
+
+
+namespace {
+
+    inline bool compare(double value, GuardOp op, double threshold) {
+
+        switch(op) {
+            case GuardOp::Less:         return value < threshold;
+            case GuardOp::LessEqual:    return value <= threshold;
+            case GuardOp::Greater:      return value > threshold;
+            case GuardOp::GreaterEqual: return value >= threshold;
+            case GuardOp::Equal:        return value == threshold;
+            case GuardOp::NotEqual:     return value != threshold;
+            default:                    return false;
+        }
+
+    }
+
+
+#ifdef EMB_BATCH_AVX2
+
+    template<int CMP>
+    __attribute__((target("avx2")))
+    unsigned long compareAVX2(const double *values, unsigned long count, double threshold, unsigned char *mask) {
+
+        auto t = _mm256_set1_pd(threshold);
+
+        // four values per iteration
+        unsigned long i = 0;
+        for(; i + 4 <= count; i += 4) {
+
+            auto m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), t, CMP));
+            mask[i]     = (unsigned char) (m & 1);
+            mask[i + 1] = (unsigned char) ((m >> 1) & 1);
+            mask[i + 2] = (unsigned char) ((m >> 2) & 1);
+            mask[i + 3] = (unsigned char) ((m >> 3) & 1);
+
+        }
+
+        return i;
+
+    }
+
+
+    unsigned long compareVector(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask) {
+
+        // check the CPU once
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if(!avx2)
+            return 0;
+
+        switch(op) {
+            case GuardOp::Less:         return compareAVX2<_CMP_LT_OQ>(values, count, threshold, mask);
+            case GuardOp::LessEqual:    return compareAVX2<_CMP_LE_OQ>(values, count, threshold, mask);
+            case GuardOp::Greater:      return compareAVX2<_CMP_GT_OQ>(values, count, threshold, mask);
+            case GuardOp::GreaterEqual: return compareAVX2<_CMP_GE_OQ>(values, count, threshold, mask);
+            case GuardOp::Equal:        return compareAVX2<_CMP_EQ_OQ>(values, count, threshold, mask);
+            case GuardOp::NotEqual:     return compareAVX2<_CMP_NEQ_UQ>(values, count, threshold, mask);
+            default:                    return 0;
+        }
+
+    }
+
+#elif defined(EMB_BATCH_NEON)
+
+    unsigned long compareVector(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask) {
+
+        auto t = vdupq_n_f64(threshold);
+
+        // two values per iteration
+        unsigned long i = 0;
+        for(; i + 2 <= count; i += 2) {
+
+            auto v = vld1q_f64(values + i);
+            uint64x2_t m;
+
+            switch(op) {
+                case GuardOp::Less:         m = vcltq_f64(v, t); break;
+                case GuardOp::LessEqual:    m = vcleq_f64(v, t); break;
+                case GuardOp::Greater:      m = vcgtq_f64(v, t); break;
+                case GuardOp::GreaterEqual: m = vcgeq_f64(v, t); break;
+                case GuardOp::Equal:        m = vceqq_f64(v, t); break;
+                case GuardOp::NotEqual:     m = veorq_u64(vceqq_f64(v, t), vdupq_n_u64(~0ull)); break;
+                default:                    return i;
+            }
+
+            mask[i]     = (unsigned char) (vgetq_lane_u64(m, 0) & 1);
+            mask[i + 1] = (unsigned char) (vgetq_lane_u64(m, 1) & 1);
+
+        }
+
+        return i;
+
+    }
+
+#else
+
+    unsigned long compareVector(const double *, unsigned long, GuardOp, double, unsigned char *) {
+
+        return 0;
+
+    }
+
+#endif
+
+}
+
+
+void emb::batchCompareScalar(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask) {
+
+    for(unsigned long i = 0; i < count; ++i)
+        mask[i] = (unsigned char) compare(values[i], op, threshold);
+
+}
+
+
+void emb::batchCompare(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask) {
+
+    // vectorized part, remainder is done scalar
+    auto done = compareVector(values, count, op, threshold, mask);
+    batchCompareScalar(values + done, count - done, op, threshold, mask + done);
+
+}
+
+
+BatchMachine::BatchMachine(unsigned long instances) :
+    _size(instances), _state(instances, 0), _next(instances, 0), _entryTime(instances, 0.0), _age(instances, 0.0),
+    _mask(instances, 0), _fired(instances, 0) {}
+
+
+unsigned long BatchMachine::size() const {
+
+    return _size;
+
+}
+
+
+unsigned int BatchMachine::createState() {
+
+    _population.push_back(0);
+    return _stateCount++;
+
+}
+
+
+unsigned long BatchMachine::createSignal(const std::string &name) {
+
+    _signalNames.push_back(name);
+    _signals.emplace_back(_size, 0.0);
+
+    return _signals.size() - 1;
+
+}
+
+
+double *BatchMachine::signal(unsigned long column) {
+
+    return _signals[column].data();
+
+}
+
+
+void BatchMachine::addTransition(unsigned int from, long column, GuardOp op, double threshold, unsigned int to) {
+
+    _rules.push_back(Rule{from, to, column, op, threshold});
+
+}
+
+
+bool BatchMachine::addTransition(unsigned int from, const Guard &guard, unsigned int to) {
+
+    // must be a single comparison: operand, constant, comparison
+    auto &code = guard.code();
+    if(code.size() != 3)
+        return false;
+
+    // check operation
+    auto op = code[2].op;
+    if(op < GuardOp::Less || op > GuardOp::NotEqual)
+        return false;
+
+    // check threshold
+    if(code[1].op != GuardOp::Constant && code[1].op != GuardOp::Parameter)
+        return false;
+
+    // time
+    if(code[0].op == GuardOp::Time) {
+        addTransition(from, -1, op, guard.operand(code[1]), to);
+        return true;
+    }
+
+    // signal
+    if(code[0].op != GuardOp::Signal)
+        return false;
+
+    // find column
+    auto &name = guard.signals()[code[0].arg];
+    for(unsigned long c = 0; c < _signalNames.size(); ++c) {
+
+        if(_signalNames[c] == name) {
+            addTransition(from, (long) c, op, guard.operand(code[1]), to);
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+
+void BatchMachine::initialize(unsigned int state, double time) {
+
+    // set state and time
+    std::fill(_state.begin(), _state.end(), state);
+    std::fill(_entryTime.begin(), _entryTime.end(), time);
+
+    // update statistics
+    std::fill(_population.begin(), _population.end(), 0);
+    _population[state] = _size;
+
+}
+
+
+unsigned long BatchMachine::step(double time) {
+
+    bool ageUpdated = false;
+
+    // reset flags
+    std::fill(_fired.begin(), _fired.end(), 0);
+    std::copy(_state.begin(), _state.end(), _next.begin());
+
+    // evaluate rules in order
+    for(auto &r : _rules) {
+
+        // skip rules of empty states
+        if(_population[r.from] == 0)
+            continue;
+
+        // get input column
+        const double *values;
+        if(r.column < 0) {
+
+            // calculate state time once
+            if(!ageUpdated) {
+                for(unsigned long i = 0; i < _size; ++i)
+                    _age[i] = time - _entryTime[i];
+                ageUpdated = true;
+            }
+
+            values = _age.data();
+
+        } else {
+
+            values = _signals[(unsigned long) r.column].data();
+
+        }
+
+        // vectorized comparison
+        batchCompare(values, _size, r.op, r.threshold, _mask.data());
+
+        // merge with state
+        auto state = _state.data();
+        auto next = _next.data();
+        auto fired = _fired.data();
+        auto mask = _mask.data();
+        for(unsigned long i = 0; i < _size; ++i) {
+
+            unsigned char hit = mask[i] & (unsigned char) (state[i] == r.from) & (unsigned char) (fired[i] ^ 1u);
+            next[i] = hit ? r.to : next[i];
+            fired[i] |= hit;
+
+        }
+
+    }
+
+    // apply transitions in bulk
+    unsigned long count = 0;
+    for(unsigned long i = 0; i < _size; ++i) {
+
+        if(!_fired[i])
+            continue;
+
+        auto from = _state[i];
+        _population[from]--;
+        _population[_next[i]]++;
+        _state[i] = _next[i];
+        _entryTime[i] = time;
+        count++;
+
+        if(onTransition)
+            onTransition(i, from, _next[i]);
+
+    }
+
+    return count;
+
+}
+
+
+unsigned int BatchMachine::state(unsigned long instance) const {
+
+    return _state[instance];
+
+}
+
+
+unsigned long BatchMachine::population(unsigned int state) const {
+
+    return _population[state];
+
+}
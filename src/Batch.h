@@ -0,0 +1,190 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-16.
+//
+
+
+#ifndef STATE_MACHINE_BATCH_H
+#define STATE_MACHINE_BATCH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Guard.h"
+
+namespace emb {
+
+    typedef std::function<void (unsigned long instance, unsigned int from, unsigned int to)> BatchTransitionCallback; //!< Type definition for callbacks on batch transitions
+
+
+    /**
+     * @brief Compares the values with the threshold and writes the result (0 or 1) into the mask.
+     * Uses AVX2 (x86-64, detected at run-time) or NEON (aarch64) when available.
+     * @param values Values to be compared
+     * @param count Number of values
+     * @param op Comparison operation (Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual)
+     * @param threshold Threshold to be compared with
+     * @param mask Result mask
+     */
+    void batchCompare(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask);
+
+
+    /**
+     * @brief Scalar reference implementation of batchCompare
+     */
+    void batchCompareScalar(const double *values, unsigned long count, GuardOp op, double threshold, unsigned char *mask);
+
+
+    /**
+     * @brief Many instances of a state machine with the same topology.
+     * The states are identified by indices, the guards are threshold comparisons of a signal or the state time. All
+     * inputs are stored as structure of arrays (one column per signal) so that a transition rule is evaluated for all
+     * instances at once by a vectorized kernel. Like in State, the first fulfilled transition (in insertion order) of
+     * the active state is followed.
+     */
+    class BatchMachine {
+
+    protected:
+
+        struct Rule {
+            unsigned int from;   //!< Source state
+            unsigned int to;     //!< Target state
+            long column;         //!< Signal column (or -1 for the state time)
+            GuardOp op;          //!< Comparison
+            double threshold;    //!< Threshold
+        };
+
+        unsigned long _size = 0;                    //!< Number of instances
+        unsigned int _stateCount = 0;               //!< Number of states
+        std::vector<Rule> _rules{};                 //!< Transition rules
+
+        std::vector<std::string> _signalNames{};    //!< Names of the signal columns
+        std::vector<std::vector<double>> _signals{}; //!< Signal columns
+
+        std::vector<unsigned int> _state{};         //!< Active state per instance
+        std::vector<unsigned int> _next{};          //!< Next state per instance
+        std::vector<double> _entryTime{};           //!< Entry time per instance
+        std::vector<double> _age{};                 //!< State time per instance (scratch)
+        std::vector<unsigned char> _mask{};         //!< Comparison result (scratch)
+        std::vector<unsigned char> _fired{};        //!< Flag per instance whether a transition was taken (scratch)
+        std::vector<unsigned long> _population{};   //!< Number of instances per state
+
+    public:
+
+        BatchTransitionCallback onTransition{};     //!< Callback to be called for every transition taken
+
+
+        /**
+         * @brief Creates a batch with the given number of instances
+         * @param instances Number of instances
+         */
+        explicit BatchMachine(unsigned long instances);
+
+
+        /**
+         * Returns the number of instances
+         * @return Number of instances
+         */
+        unsigned long size() const;
+
+
+        /**
+         * Creates a state
+         * @return Index of the state
+         */
+        unsigned int createState();
+
+
+        /**
+         * Creates a signal column
+         * @param name Name of the signal (used to map guards)
+         * @return Index of the column
+         */
+        unsigned long createSignal(const std::string &name);
+
+
+        /**
+         * Returns the data of a signal column (one value per instance) to be written by the user
+         * @param column Index of the column
+         * @return Pointer to the column
+         */
+        double *signal(unsigned long column);
+
+
+        /**
+         * @brief Adds a threshold transition
+         * @param from Source state
+         * @param column Signal column (or -1 for the state time)
+         * @param op Comparison operation
+         * @param threshold Threshold
+         * @param to Target state
+         */
+        void addTransition(unsigned int from, long column, GuardOp op, double threshold, unsigned int to);
+
+
+        /**
+         * @brief Adds a transition from a guard.
+         * The guard must be a single comparison of a signal (or `time`) with a constant or parameter, e.g.
+         * `Guard::signal("temp") > 80.0`. The signal is mapped to the column of the same name.
+         * @param from Source state
+         * @param guard Guard to be mapped
+         * @param to Target state
+         * @return Flag whether the guard could be mapped
+         */
+        bool addTransition(unsigned int from, const Guard &guard, unsigned int to);
+
+
+        /**
+         * Sets all instances to the given state
+         * @param state Initial state
+         * @param time Current time
+         */
+        void initialize(unsigned int state, double time);
+
+
+        /**
+         * @brief Performs a step for all instances
+         * @param time Current time (used for the state time)
+         * @return Number of transitions taken
+         */
+        unsigned long step(double time);
+
+
+        /**
+         * Returns the active state of an instance
+         * @param instance Index of the instance
+         * @return State index
+         */
+        unsigned int state(unsigned long instance) const;
+
+
+        /**
+         * Returns the number of instances in the given state
+         * @param state State index
+         * @return Number of instances
+         */
+        unsigned long population(unsigned int state) const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_BATCH_H
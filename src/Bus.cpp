@@ -0,0 +1,381 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-23.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "Bus.h"
+
+using namespace emb;
+
+
+namespace {
+
+    /** Splits the topic into levels, returns the number of levels (or 0 if there are too many) */
+    unsigned long split(const char *topic, const char **levels, unsigned long *lengths) {
+
+        unsigned long count = 0;
+        auto start = topic;
+
+        for(auto c = topic; ; ++c) {
+
+            if(*c != '/' && *c != '\0')
+                continue;
+
+            // add level
+            if(count >= EMB_BUS_MAX_LEVELS)
+                return 0;
+
+            levels[count] = start;
+            lengths[count] = (unsigned long) (c - start);
+            count++;
+            start = c + 1;
+
+            if(*c == '\0')
+                return count;
+
+        }
+
+    }
+
+
+    /** Compares a level with a child name */
+    int compare(const std::string &name, const char *level, unsigned long length) {
+
+        auto n = std::min(name.size(), (size_t) length);
+        auto r = std::memcmp(name.data(), level, n);
+        if(r != 0)
+            return r;
+
+        return name.size() < length ? -1 : (name.size() > length ? 1 : 0);
+
+    }
+
+}
+
+
+unsigned long Bus::_subscribe(const std::string &filter, Subscriber &&subscriber) {
+
+    const char *levels[EMB_BUS_MAX_LEVELS];
+    unsigned long lengths[EMB_BUS_MAX_LEVELS];
+
+    // split filter
+    auto count = split(filter.c_str(), levels, lengths);
+    if(count == 0)
+        return 0;
+
+    // validate wildcards
+    for(unsigned long i = 0; i < count; ++i) {
+
+        for(unsigned long k = 0; k < lengths[i]; ++k) {
+
+            auto c = levels[i][k];
+            if((c == '+' || c == '#') && lengths[i] != 1)
+                return 0;
+            if(c == '#' && i + 1 != count)
+                return 0;
+
+        }
+
+    }
+
+    // walk through the trie and create the nodes
+    Node *node = &_root;
+    for(unsigned long i = 0; i < count; ++i) {
+
+        std::unique_ptr<Node> *next;
+        if(lengths[i] == 1 && levels[i][0] == '+') {
+
+            next = &node->single;
+
+        } else if(lengths[i] == 1 && levels[i][0] == '#') {
+
+            next = &node->multi;
+
+        } else {
+
+            // find position in sorted children
+            auto &children = node->children;
+            auto it = std::lower_bound(children.begin(), children.end(), i,
+                    [&](const std::pair<std::string, std::unique_ptr<Node>> &child, unsigned long l) {
+                        return compare(child.first, levels[l], lengths[l]) < 0;
+                    });
+
+            if(it == children.end() || compare(it->first, levels[i], lengths[i]) != 0)
+                it = children.emplace(it, std::string(levels[i], lengths[i]), std::unique_ptr<Node>());
+
+            next = &it->second;
+
+        }
+
+        if(!*next)
+            next->reset(new Node);
+
+        node = next->get();
+
+    }
+
+    // add subscriber
+    auto id = _nextId++;
+    subscriber.id = id;
+    node->subscribers.emplace_back(new Subscriber(std::move(subscriber)));
+    _nodes[id] = node;
+
+    return id;
+
+}
+
+
+unsigned long Bus::subscribe(const std::string &filter, State *machine, unsigned int event) {
+
+    return _subscribe(filter, Subscriber{0, machine, event, nullptr, nullptr});
+
+}
+
+
+unsigned long Bus::subscribe(const std::string &filter, BusCallback &&callback) {
+
+    return _subscribe(filter, Subscriber{0, nullptr, 0, std::move(callback), nullptr});
+
+}
+
+
+unsigned long Bus::subscribeMessages(const std::string &filter, BusMessageCallback &&callback) {
+
+    return _subscribe(filter, Subscriber{0, nullptr, 0, nullptr, std::move(callback)});
+
+}
+
+
+void Bus::unsubscribe(unsigned long id) {
+
+    auto it = _nodes.find(id);
+    if(it == _nodes.end())
+        return;
+
+    auto node = it->second;
+    _nodes.erase(it);
+
+    // during delivery the subscriber is only marked (it may be the running callback)
+    if(_depth > 0) {
+
+        for(auto &s : node->subscribers) {
+            if(s->id == id)
+                s->id = 0;
+        }
+
+        _removed.push_back(node);
+        return;
+
+    }
+
+    // remove subscriber (the node is kept)
+    auto &subscribers = node->subscribers;
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+            [id](const std::unique_ptr<Subscriber> &s) { return s->id == id; }), subscribers.end());
+
+}
+
+
+unsigned long Bus::_deliver(const Node &node, const char *topic, const std::shared_ptr<const void> &payload,
+                           const BusMessage *message) {
+
+    unsigned long delivered = 0;
+
+    // by index, callbacks may add subscribers to the node
+    for(unsigned long i = 0; i < node.subscribers.size(); ++i) {
+
+        auto &s = *node.subscribers[i];
+
+        // removed or added during the publication
+        if(s.id == 0 || s.id >= _limit)
+            continue;
+
+        if(s.machine != nullptr) {
+
+            // post event with shared payload
+            if(!s.machine->post(Event{s.event, payload}))
+                _dropped++;
+
+        } else if(s.callback) {
+
+            s.callback(topic, payload);
+
+        } else if(s.messageCallback) {
+
+            // other payloads are not data messages
+            if(message == nullptr)
+                continue;
+
+            s.messageCallback(*message);
+
+        }
+
+        delivered++;
+
+    }
+
+    return delivered;
+
+}
+
+
+unsigned long Bus::_match(const Node &node, const char *const *levels, const unsigned long *lengths,
+                          unsigned long count, unsigned long index, const char *topic,
+                          const std::shared_ptr<const void> &payload, const BusMessage *message) {
+
+    unsigned long delivered = 0;
+
+    // wildcards do not match topics starting with $ on the first level
+    bool wildcards = index > 0 || topic[0] != '$';
+
+    // multi-level wildcard matches the rest (also the parent level)
+    if(node.multi && wildcards)
+        delivered += _deliver(*node.multi, topic, payload, message);
+
+    // end of topic
+    if(index == count)
+        return delivered + _deliver(node, topic, payload, message);
+
+    // exact level
+    auto &children = node.children;
+    auto it = std::lower_bound(children.begin(), children.end(), index,
+            [&](const std::pair<std::string, std::unique_ptr<Node>> &child, unsigned long l) {
+                return compare(child.first, levels[l], lengths[l]) < 0;
+            });
+
+    if(it != children.end() && compare(it->first, levels[index], lengths[index]) == 0)
+        delivered += _match(*it->second, levels, lengths, count, index + 1, topic, payload, message);
+
+    // single-level wildcard
+    if(node.single && wildcards)
+        delivered += _match(*node.single, levels, lengths, count, index + 1, topic, payload, message);
+
+    return delivered;
+
+}
+
+
+unsigned long Bus::_publish(const char *topic, const std::shared_ptr<const void> &payload,
+                           const BusMessage *message) {
+
+    const char *levels[EMB_BUS_MAX_LEVELS];
+    unsigned long lengths[EMB_BUS_MAX_LEVELS];
+
+    // topics must not contain wildcards
+    if(std::strpbrk(topic, "+#") != nullptr)
+        return 0;
+
+    // split topic
+    auto count = split(topic, levels, lengths);
+    if(count == 0)
+        return 0;
+
+    // subscriptions added by callbacks are not served
+    auto limit = _limit;
+    _limit = _nextId;
+    _depth++;
+
+    auto delivered = _match(_root, levels, lengths, count, 0, topic, payload, message);
+
+    _limit = limit;
+    if(--_depth > 0)
+        return delivered;
+
+    // release subscribers removed during delivery
+    for(auto node : _removed) {
+        auto &subscribers = node->subscribers;
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                [](const std::unique_ptr<Subscriber> &s) { return s->id == 0; }), subscribers.end());
+    }
+
+    _removed.clear();
+
+    return delivered;
+
+}
+
+
+unsigned long Bus::publish(const char *topic, const std::shared_ptr<const void> &payload) {
+
+    return _publish(topic, payload, nullptr);
+
+}
+
+
+unsigned long Bus::publish(const char *topic, const char *data, unsigned long size, const void *origin) {
+
+    // copy data once
+    auto message = std::make_shared<BusMessage>();
+    message->topic = topic;
+    message->data.assign(data, data + size);
+    message->origin = origin;
+
+    return _publish(topic, std::static_pointer_cast<const void>(message), message.get());
+
+}
+
+
+unsigned long Bus::dropped() const {
+
+    return _dropped;
+
+}
+
+
+bool Bus::matches(const std::string &filter, const std::string &topic) {
+
+    const char *fl[EMB_BUS_MAX_LEVELS], *tl[EMB_BUS_MAX_LEVELS];
+    unsigned long fn[EMB_BUS_MAX_LEVELS], tn[EMB_BUS_MAX_LEVELS];
+
+    // split both
+    auto fc = split(filter.c_str(), fl, fn);
+    auto tc = split(topic.c_str(), tl, tn);
+    if(fc == 0 || tc == 0)
+        return false;
+
+    // compare level by level
+    for(unsigned long i = 0; i < fc; ++i) {
+
+        // wildcards do not match topics starting with $ on the first level
+        bool wildcards = i > 0 || topic[0] != '$';
+
+        if(fn[i] == 1 && fl[i][0] == '#')
+            return wildcards;
+
+        if(i >= tc)
+            return false;
+
+        if(fn[i] == 1 && fl[i][0] == '+') {
+            if(!wildcards)
+                return false;
+            continue;
+        }
+
+        if(fn[i] != tn[i] || std::memcmp(fl[i], tl[i], fn[i]) != 0)
+            return false;
+
+    }
+
+    return fc == tc;
+
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-23.
+//
+
+
+#ifndef STATE_MACHINE_BUS_H
+#define STATE_MACHINE_BUS_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "State.h"
+
+#ifndef EMB_BUS_MAX_LEVELS
+#define EMB_BUS_MAX_LEVELS 32
+#endif
+
+namespace emb {
+
+    struct BusMessage {
+
+        std::string topic;         //!< Topic the message was published on
+        std::vector<char> data;    //!< Content of the message
+        const void *origin;        //!< Publisher-defined origin of the message (nullptr for local messages)
+
+    };
+
+    typedef std::function<void (const char *topic, const std::shared_ptr<const void> &payload)> BusCallback; //!< Type definition for bus subscribers
+    typedef std::function<void (const BusMessage &message)> BusMessageCallback; //!< Type definition for message subscribers
+
+
+    /**
+     * @brief In-process publish/subscribe bus with MQTT topic semantics.
+     * Topic filters may contain the wildcards `+` (one level) and `#` (all remaining levels). The filters are stored
+     * in a trie of topic levels, so publishing only visits the branches matching the topic and the cost grows with
+     * the number of matching subscribers. Payloads are shared between all subscribers without copies; subscribed
+     * machines receive them as event payload. Callbacks may subscribe and unsubscribe during delivery: new
+     * subscriptions receive the next publication, removed ones are skipped and released afterwards.
+     */
+    class Bus {
+
+    protected:
+
+        struct Subscriber {
+            unsigned long id;          //!< Subscription id
+            State *machine;            //!< Machine to post the event to (or nullptr)
+            unsigned int event;        //!< Id of the event to be posted
+            BusCallback callback;      //!< Callback (when no machine is set)
+            BusMessageCallback messageCallback; //!< Callback for data messages only
+        };
+
+        struct Node {
+            std::vector<std::pair<std::string, std::unique_ptr<Node>>> children{}; //!< Children (sorted by level)
+            std::unique_ptr<Node> single{};       //!< Child for the `+` wildcard
+            std::unique_ptr<Node> multi{};        //!< Child for the `#` wildcard
+            std::vector<std::unique_ptr<Subscriber>> subscribers{}; //!< Subscribers of the filter ending here
+        };
+
+        Node _root{};                                        //!< Root of the trie
+        std::unordered_map<unsigned long, Node *> _nodes{};  //!< Node of each subscription
+        unsigned long _nextId = 1;                           //!< Id of the next subscription
+        unsigned long _dropped = 0;                          //!< Number of events which could not be queued
+        unsigned long _depth = 0;                            //!< Number of publications in progress
+        unsigned long _limit = 0;                            //!< First subscription id not served by the publication
+        std::vector<Node *> _removed{};                      //!< Nodes with subscribers removed during delivery
+
+
+        /** Adds a subscriber for the filter */
+        unsigned long _subscribe(const std::string &filter, Subscriber &&subscriber);
+
+        /** Delivers the payload to all matching subscribers */
+        unsigned long _match(const Node &node, const char *const *levels, const unsigned long *lengths,
+                             unsigned long count, unsigned long index, const char *topic,
+                             const std::shared_ptr<const void> &payload, const BusMessage *message);
+
+        /** Delivers the payload to the subscribers of a node (message is set if the payload is a BusMessage) */
+        unsigned long _deliver(const Node &node, const char *topic, const std::shared_ptr<const void> &payload,
+                               const BusMessage *message);
+
+        /** Publishes a payload (message is set if the payload is a BusMessage) */
+        unsigned long _publish(const char *topic, const std::shared_ptr<const void> &payload,
+                               const BusMessage *message);
+
+    public:
+
+        /**
+         * @brief Subscribes a machine: every matching message is posted as event with the message as payload
+         * @param filter Topic filter
+         * @param machine Machine to post to
+         * @param event Id of the event to be posted
+         * @return Id of the subscription (0 if the filter is invalid)
+         */
+        unsigned long subscribe(const std::string &filter, State *machine, unsigned int event);
+
+
+        /**
+         * @brief Subscribes a callback
+         * @param filter Topic filter
+         * @param callback Callback to be called for every matching message
+         * @return Id of the subscription (0 if the filter is invalid)
+         */
+        unsigned long subscribe(const std::string &filter, BusCallback &&callback);
+
+
+        /**
+         * @brief Subscribes a callback to data messages. Only messages published with publish(topic, data, size) are
+         * delivered, other payloads on matching topics are skipped.
+         * @param filter Topic filter
+         * @param callback Callback to be called for every matching data message
+         * @return Id of the subscription (0 if the filter is invalid)
+         */
+        unsigned long subscribeMessages(const std::string &filter, BusMessageCallback &&callback);
+
+
+        /**
+         * @brief Removes a subscription
+         * @param id Id of the subscription
+         */
+        void unsubscribe(unsigned long id);
+
+
+        /**
+         * @brief Publishes a payload
+         * @param topic Topic (must not contain wildcards)
+         * @param payload Payload to be shared with the subscribers
+         * @return Number of subscribers the message was delivered to
+         */
+        unsigned long publish(const char *topic, const std::shared_ptr<const void> &payload);
+
+
+        /**
+         * @brief Publishes data. The data is copied once into a BusMessage which is shared by all subscribers.
+         * @param topic Topic (must not contain wildcards)
+         * @param data Data to be published
+         * @param size Size of the data
+         * @param origin Origin of the message, passed to the subscribers (e.g. to detect own messages)
+         * @return Number of subscribers the message was delivered to
+         */
+        unsigned long publish(const char *topic, const char *data, unsigned long size, const void *origin = nullptr);
+
+
+        /**
+         * Returns the number of events which could not be posted because the event queue was full
+         * @return Number of dropped events
+         */
+        unsigned long dropped() const;
+
+
+        /**
+         * @brief Checks whether the topic matches the filter
+         * @param filter Topic filter
+         * @param topic Topic
+         * @return Flag
+         */
+        static bool matches(const std::string &filter, const std::string &topic);
+
+    };
+
+}
+
+#endif // STATE_MACHINE_BUS_H
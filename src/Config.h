@@ -0,0 +1,84 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-24.
+//
+
+
+#ifndef STATE_MACHINE_CONFIG_H
+#define STATE_MACHINE_CONFIG_H
+
+/**
+ * Build profile of the state library.
+ *
+ * By default the library uses the standard containers and std::function. When EMB_EMBEDDED is defined, the library
+ * is built without heap, exceptions, RTTI and iostream: containers and callbacks have a fixed capacity and states and
+ * transitions are taken from static pools. The capacities can be set with the following definitions.
+ */
+
+#ifdef EMB_EMBEDDED
+
+#ifndef EMB_MAX_STATES
+#define EMB_MAX_STATES 8             //!< Maximum number of sub-states per state
+#endif
+
+#ifndef EMB_MAX_TRANSITIONS
+#define EMB_MAX_TRANSITIONS 8        //!< Maximum number of transitions per state
+#endif
+
+#ifndef EMB_CALLBACK_SIZE
+#define EMB_CALLBACK_SIZE 16         //!< Maximum size of the captures of a callback in bytes
+#endif
+
+#ifndef EMB_EVENT_QUEUE_SIZE
+#define EMB_EVENT_QUEUE_SIZE 8       //!< Capacity of the event queue of a machine
+#endif
+
+#ifndef EMB_EVENT_PRIORITY_SIZE
+#define EMB_EVENT_PRIORITY_SIZE 4    //!< Capacity of the priority lane of the event queue (critical events)
+#endif
+
+#ifndef EMB_EVENT_POLICIES
+#define EMB_EVENT_POLICIES 4         //!< Maximum number of event ids with a queue policy
+#endif
+
+#ifndef EMB_STATE_POOL_SIZE
+#define EMB_STATE_POOL_SIZE 16       //!< Number of states which can be created with createState
+#endif
+
+#ifndef EMB_STATE_EXTRA_SIZE
+#define EMB_STATE_EXTRA_SIZE 64      //!< Size in bytes for additional members of states created by createState<T>
+#endif
+
+#ifndef EMB_TRANSITION_POOL_SIZE
+#define EMB_TRANSITION_POOL_SIZE 32  //!< Number of transitions which can be created
+#endif
+
+#ifndef EMB_CAPACITY_EXCEEDED
+#define EMB_CAPACITY_EXCEEDED() __builtin_trap()  //!< Called when a fixed capacity is exceeded
+#endif
+
+#ifndef EMB_HEAP_USED
+#define EMB_HEAP_USED() __builtin_trap()          //!< Called when a state or monitor is deleted through the heap
+#endif
+
+#endif // EMB_EMBEDDED
+
+#endif // STATE_MACHINE_CONFIG_H
@@ -0,0 +1,313 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-15.
+//
+
+#include <utility>
+#include "Event.h"
+
+using namespace emb;
+
+
+void EventQueue::setCapacity(unsigned long capacity) {
+
+#ifdef EMB_EMBEDDED
+
+    // storage is static
+    _capacity = capacity < EMB_EVENT_QUEUE_SIZE ? capacity : EMB_EVENT_QUEUE_SIZE;
+
+#else
+
+    // reset the buffer, storage is allocated on next push
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    _capacity = capacity;
+
+#endif
+
+    // reset indices
+    _removed += _size;
+    _head = 0;
+    _size = 0;
+
+}
+
+
+unsigned long EventQueue::capacity() const {
+
+    return _capacity;
+
+}
+
+
+unsigned long EventQueue::size() const {
+
+    return _size + _prioritySize;
+
+}
+
+
+bool EventQueue::push(const Event &event) {
+
+    auto entry = _policy(event.id);
+    auto policy = entry != nullptr ? entry->policy : EventPolicy::Queue;
+
+    // critical events go to the priority lane
+    if(policy == EventPolicy::Critical) {
+
+#ifdef EMB_EMBEDDED
+        if(_priorityCapacity > EMB_EVENT_PRIORITY_SIZE)
+            _priorityCapacity = EMB_EVENT_PRIORITY_SIZE;
+#else
+        if(_priority.size() != _priorityCapacity)
+            _priority.resize(_priorityCapacity);
+#endif
+
+        if(_prioritySize >= _priorityCapacity) {
+            _dropped++;
+            return false;
+        }
+
+        _priority[(_priorityHead + _prioritySize) % _priorityCapacity] = event;
+        _prioritySize++;
+
+    } else {
+
+#ifdef EMB_EMBEDDED
+
+        // limit to static storage
+        if(_capacity > EMB_EVENT_QUEUE_SIZE)
+            _capacity = EMB_EVENT_QUEUE_SIZE;
+
+#else
+
+        // allocate storage once
+        if(_buffer.size() != _capacity)
+            _buffer.resize(_capacity);
+
+#endif
+
+        // replace the queued event of the same id
+        if(policy == EventPolicy::Latest && entry->sequence >= _removed && entry->sequence < _removed + _size) {
+
+            auto &queued = _buffer[(_head + entry->sequence - _removed) % _capacity];
+            if(queued.id == event.id) {
+                queued = event;
+                _coalesced++;
+                return true;
+            }
+
+        }
+
+        // check space
+        if(_size >= _capacity && policy == EventPolicy::DropOldest && _capacity > 0)
+            _dropOldest();
+
+        if(_size >= _capacity) {
+            _dropped++;
+            return false;
+        }
+
+        // add to the end of the ring
+        if(policy == EventPolicy::Latest)
+            entry->sequence = _removed + _size;
+
+        _buffer[(_head + _size) % _capacity] = event;
+        _size++;
+
+    }
+
+    if(size() > _highWaterMark)
+        _highWaterMark = size();
+
+    return true;
+
+}
+
+
+bool EventQueue::pop(Event &event) {
+
+    // critical events first
+    if(_prioritySize > 0) {
+
+        event = std::move(_priority[_priorityHead]);
+        _priorityHead = (_priorityHead + 1) % _priorityCapacity;
+        _prioritySize--;
+
+        return true;
+
+    }
+
+    // check for events
+    if(_size == 0)
+        return false;
+
+    // take the oldest one
+    event = std::move(_buffer[_head]);
+    _head = (_head + 1) % _capacity;
+    _size--;
+    _removed++;
+
+    return true;
+
+}
+
+
+void EventQueue::clear() {
+
+    // release payloads
+    for(unsigned long i = 0; i < _size; ++i)
+        _buffer[(_head + i) % _capacity].payload = nullptr;
+
+    for(unsigned long i = 0; i < _prioritySize; ++i)
+        _priority[(_priorityHead + i) % _priorityCapacity].payload = nullptr;
+
+    _removed += _size;
+    _head = 0;
+    _size = 0;
+    _priorityHead = 0;
+    _prioritySize = 0;
+
+}
+
+
+bool EventQueue::setPolicy(unsigned int id, EventPolicy policy) {
+
+    // remove the policy
+    if(policy == EventPolicy::Queue) {
+
+        for(auto &p : _policies) {
+            if(p.id == id) {
+                p = _policies[_policies.size() - 1];
+                _policies.pop_back();
+                break;
+            }
+        }
+
+        return true;
+
+    }
+
+    // change the policy
+    auto entry = _policy(id);
+    if(entry != nullptr) {
+        entry->policy = policy;
+        entry->sequence = 0;
+        return true;
+    }
+
+#ifdef EMB_EMBEDDED
+    if(_policies.size() >= EMB_EVENT_POLICIES)
+        return false;
+#endif
+
+    _policies.push_back(EventPolicyEntry{id, policy, 0});
+
+    return true;
+
+}
+
+
+EventPolicy EventQueue::policy(unsigned int id) const {
+
+    for(auto &p : _policies) {
+        if(p.id == id)
+            return p.policy;
+    }
+
+    return EventPolicy::Queue;
+
+}
+
+
+void EventQueue::setPriorityCapacity(unsigned long capacity) {
+
+#ifdef EMB_EMBEDDED
+
+    // storage is static
+    _priorityCapacity = capacity < EMB_EVENT_PRIORITY_SIZE ? capacity : EMB_EVENT_PRIORITY_SIZE;
+
+#else
+
+    // reset the buffer, storage is allocated on next push
+    _priority.clear();
+    _priority.shrink_to_fit();
+    _priorityCapacity = capacity;
+
+#endif
+
+    _priorityHead = 0;
+    _prioritySize = 0;
+
+}
+
+
+unsigned long EventQueue::highWaterMark() const {
+
+    return _highWaterMark;
+
+}
+
+
+unsigned long EventQueue::dropped() const {
+
+    return _dropped;
+
+}
+
+
+unsigned long EventQueue::coalesced() const {
+
+    return _coalesced;
+
+}
+
+
+void EventQueue::resetStatistics() {
+
+    _highWaterMark = size();
+    _dropped = 0;
+    _coalesced = 0;
+
+}
+
+
+EventPolicyEntry *EventQueue::_policy(unsigned int id) {
+
+    for(auto &p : _policies) {
+        if(p.id == id)
+            return &p;
+    }
+
+    return nullptr;
+
+}
+
+
+void EventQueue::_dropOldest() {
+
+    _buffer[_head].payload = nullptr;
+    _head = (_head + 1) % _capacity;
+    _size--;
+    _removed++;
+    _dropped++;
+
+}
@@ -0,0 +1,212 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-15.
+//
+
+
+#ifndef STATE_MACHINE_EVENT_H
+#define STATE_MACHINE_EVENT_H
+
+#include "Config.h"
+
+#ifdef EMB_EMBEDDED
+#include "Fixed.h"
+#define EMB_EVENT_QUEUE_STORAGE(name) Event name[EMB_EVENT_QUEUE_SIZE]
+#define EMB_EVENT_PRIORITY_STORAGE(name) Event name[EMB_EVENT_PRIORITY_SIZE]
+#define EMB_EVENT_POLICY_STORAGE(name) FixedVector<EventPolicyEntry, EMB_EVENT_POLICIES> name{}
+#else
+#include <memory>
+#include <vector>
+#define EMB_EVENT_QUEUE_STORAGE(name) std::vector<Event> name{}
+#define EMB_EVENT_PRIORITY_STORAGE(name) std::vector<Event> name{}
+#define EMB_EVENT_POLICY_STORAGE(name) std::vector<EventPolicyEntry> name{}
+#endif
+
+namespace emb {
+
+#ifdef EMB_EMBEDDED
+    typedef const void *EventPayload;                 //!< Payload is owned by the sender (no heap)
+#else
+    typedef std::shared_ptr<const void> EventPayload; //!< Payload is shared, not copied
+#endif
+
+    struct Event {
+
+        unsigned int id;                       //!< Identifier of the event
+        EventPayload payload;                  //!< Data of the event
+
+    };
+
+
+    /** Queue policies of event types */
+    enum class EventPolicy : unsigned char {
+        Queue,       //!< Appended, rejected when the queue is full (default)
+        Latest,      //!< Replaces a queued event of the same id (keeping its position), appended otherwise
+        DropOldest,  //!< Appended, the oldest queued event is dropped when the queue is full
+        Critical     //!< Appended to the priority lane, which is taken before all other events
+    };
+
+
+    struct EventPolicyEntry {
+
+        unsigned int id;          //!< Identifier of the event
+        EventPolicy policy;       //!< Policy of the event
+        unsigned long sequence;   //!< Sequence number of the last queued event of this id (Latest only)
+
+    };
+
+
+    /**
+     * @brief Bounded event queue with policies per event id.
+     * Events are kept in a ring buffer of fixed capacity. Critical events are kept in a separate priority lane, so
+     * their latency does not depend on the number of queued normal events. Memory is bounded by the capacities.
+     */
+    class EventQueue {
+
+    protected:
+
+        EMB_EVENT_QUEUE_STORAGE(_buffer); //!< Ring buffer storage (allocated on first use)
+        unsigned long _capacity = 16;     //!< Maximum number of queued events
+        unsigned long _head = 0;      //!< Index of the oldest event
+        unsigned long _size = 0;      //!< Number of queued events
+        unsigned long _removed = 0;   //!< Number of events removed from the front (sequence number of the oldest)
+
+        EMB_EVENT_PRIORITY_STORAGE(_priority); //!< Ring buffer of the priority lane (allocated on first use)
+        unsigned long _priorityCapacity = 4;   //!< Maximum number of queued critical events
+        unsigned long _priorityHead = 0;       //!< Index of the oldest critical event
+        unsigned long _prioritySize = 0;       //!< Number of queued critical events
+
+        EMB_EVENT_POLICY_STORAGE(_policies);   //!< Policies of the event ids
+
+        unsigned long _highWaterMark = 0;      //!< Maximum number of queued events
+        unsigned long _dropped = 0;            //!< Number of rejected or dropped events
+        unsigned long _coalesced = 0;          //!< Number of events replaced by a newer event of the same id
+
+
+        /** Returns the policy entry of the id (or nullptr) */
+        EventPolicyEntry *_policy(unsigned int id);
+
+        /** Removes the oldest normal event */
+        void _dropOldest();
+
+    public:
+
+        /**
+         * @brief Sets the capacity of the queue.
+         * The storage is allocated once, so this should be called before the machine is running. Queued events are
+         * discarded. In the embedded profile the capacity is limited to EMB_EVENT_QUEUE_SIZE.
+         * @param capacity Maximum number of queued events
+         */
+        void setCapacity(unsigned long capacity);
+
+
+        /**
+         * @brief Returns the capacity of the queue
+         * @return Maximum number of queued events
+         */
+        unsigned long capacity() const;
+
+
+        /**
+         * @brief Returns the number of queued events (both lanes)
+         * @return Number of events
+         */
+        unsigned long size() const;
+
+
+        /**
+         * @brief Appends an event to the queue according to the policy of its id.
+         * @param event Event to be appended
+         * @return Flag whether the event was queued or coalesced (false when the queue or lane is full)
+         */
+        bool push(const Event &event);
+
+
+        /**
+         * @brief Removes the oldest critical event or, if there is none, the oldest event from the queue.
+         * @param event Event to be written to
+         * @return Flag whether an event was available
+         */
+        bool pop(Event &event);
+
+
+        /**
+         * @brief Removes all events from the queue.
+         */
+        void clear();
+
+
+        /**
+         * @brief Sets the queue policy of an event id
+         * @param id Identifier of the event
+         * @param policy Policy (Queue removes the policy)
+         * @return Flag whether the policy could be set (false when the maximum number of policies is reached)
+         */
+        bool setPolicy(unsigned int id, EventPolicy policy);
+
+
+        /**
+         * @brief Returns the queue policy of an event id
+         * @param id Identifier of the event
+         * @return Policy
+         */
+        EventPolicy policy(unsigned int id) const;
+
+
+        /**
+         * @brief Sets the capacity of the priority lane. Queued critical events are discarded. In the embedded
+         * profile the capacity is limited to EMB_EVENT_PRIORITY_SIZE.
+         * @param capacity Maximum number of queued critical events
+         */
+        void setPriorityCapacity(unsigned long capacity);
+
+
+        /**
+         * @brief Returns the maximum number of queued events (both lanes) since the last reset
+         * @return High-water mark
+         */
+        unsigned long highWaterMark() const;
+
+
+        /**
+         * @brief Returns the number of events rejected on a full queue or dropped by DropOldest
+         * @return Number of lost events
+         */
+        unsigned long dropped() const;
+
+
+        /**
+         * @brief Returns the number of events replaced by a newer event of the same id (Latest)
+         * @return Number of coalesced events
+         */
+        unsigned long coalesced() const;
+
+
+        /**
+         * @brief Resets the high-water mark and the counters
+         */
+        void resetStatistics();
+
+    };
+
+}
+
+#endif // STATE_MACHINE_EVENT_H
@@ -0,0 +1,324 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-24.
+//
+
+
+#ifndef STATE_MACHINE_FIXED_H
+#define STATE_MACHINE_FIXED_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Config.h"
+
+#ifndef EMB_CAPACITY_EXCEEDED
+#define EMB_CAPACITY_EXCEEDED() __builtin_trap()
+#endif
+
+namespace emb {
+
+    /**
+     * @brief Vector with a fixed capacity and inline storage.
+     * Exceeding the capacity calls EMB_CAPACITY_EXCEEDED().
+     */
+    template<typename T, std::size_t N>
+    class FixedVector {
+
+    protected:
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type _data[N]; //!< Storage
+        std::size_t _size = 0;                                               //!< Number of elements
+
+    public:
+
+        FixedVector() = default;
+        FixedVector(const FixedVector &) = delete;
+        FixedVector &operator=(const FixedVector &) = delete;
+
+        ~FixedVector() {
+
+            clear();
+
+        }
+
+
+        template<typename... Args>
+        void emplace_back(Args &&... args) {
+
+            if(_size >= N) {
+                EMB_CAPACITY_EXCEEDED();
+                return;
+            }
+
+            new(&_data[_size]) T(std::forward<Args>(args)...);
+            _size++;
+
+        }
+
+
+        void push_back(const T &value) { emplace_back(value); }
+
+        void pop_back() { reinterpret_cast<T *>(&_data[--_size])->~T(); }
+
+        void clear() {
+
+            while(_size > 0)
+                reinterpret_cast<T *>(&_data[--_size])->~T();
+
+        }
+
+        T *begin() { return reinterpret_cast<T *>(&_data[0]); }
+        T *end() { return begin() + _size; }
+        const T *begin() const { return reinterpret_cast<const T *>(&_data[0]); }
+        const T *end() const { return begin() + _size; }
+
+        T &operator[](std::size_t i) { return begin()[i]; }
+        const T &operator[](std::size_t i) const { return begin()[i]; }
+
+        T &back() { return begin()[_size - 1]; }
+        const T &back() const { return begin()[_size - 1]; }
+
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        static constexpr std::size_t capacity() { return N; }
+
+    };
+
+
+    template<typename Signature, std::size_t N>
+    class FixedFunction;
+
+
+    /**
+     * @brief Callable with inline storage for the captures (no heap).
+     * Callables larger than N bytes are rejected at compile time.
+     */
+    template<typename R, typename... Args, std::size_t N>
+    class FixedFunction<R (Args...), N> {
+
+    protected:
+
+        typedef R (*Invoke)(void *, Args...);
+        typedef void (*Manage)(void *, const void *, bool);  // copy (source set) or destroy (source null)
+
+        typename std::aligned_storage<N, alignof(std::max_align_t)>::type _storage; //!< Storage of the callable
+        Invoke _invoke = nullptr;   //!< Calls the callable
+        Manage _manage = nullptr;   //!< Copies or destroys the callable
+
+
+        template<typename F>
+        static R _invokeImpl(void *storage, Args... args) {
+
+            return (*static_cast<F *>(storage))(std::forward<Args>(args)...);
+
+        }
+
+
+        template<typename F>
+        static void _manageImpl(void *storage, const void *source, bool) {
+
+            if(source != nullptr)
+                new(storage) F(*static_cast<const F *>(source));
+            else
+                static_cast<F *>(storage)->~F();
+
+        }
+
+    public:
+
+        FixedFunction() = default;
+        FixedFunction(std::nullptr_t) {}
+
+
+        template<typename F, typename = typename std::enable_if<
+                !std::is_same<typename std::decay<F>::type, FixedFunction>::value>::type>
+        FixedFunction(F &&f) {
+
+            typedef typename std::decay<F>::type Callable;
+            static_assert(sizeof(Callable) <= N, "callable exceeds the capacity of the callback (see EMB_CALLBACK_SIZE)");
+            static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable alignment not supported");
+
+            new(&_storage) Callable(std::forward<F>(f));
+            _invoke = &_invokeImpl<Callable>;
+            _manage = &_manageImpl<Callable>;
+
+        }
+
+
+        FixedFunction(const FixedFunction &other) {
+
+            if(other._manage)
+                other._manage(&_storage, &other._storage, true);
+
+            _invoke = other._invoke;
+            _manage = other._manage;
+
+        }
+
+
+        FixedFunction &operator=(const FixedFunction &other) {
+
+            if(this != &other) {
+                reset();
+                if(other._manage)
+                    other._manage(&_storage, &other._storage, true);
+                _invoke = other._invoke;
+                _manage = other._manage;
+            }
+
+            return *this;
+
+        }
+
+
+        FixedFunction &operator=(std::nullptr_t) {
+
+            reset();
+            return *this;
+
+        }
+
+
+        ~FixedFunction() {
+
+            reset();
+
+        }
+
+
+        void reset() {
+
+            if(_manage)
+                _manage(&_storage, nullptr, false);
+
+            _invoke = nullptr;
+            _manage = nullptr;
+
+        }
+
+
+        explicit operator bool() const {
+
+            return _invoke != nullptr;
+
+        }
+
+
+        R operator()(Args... args) const {
+
+            return _invoke(const_cast<void *>(static_cast<const void *>(&_storage)), std::forward<Args>(args)...);
+
+        }
+
+    };
+
+
+    /**
+     * @brief Pool of fixed-size memory blocks in static storage.
+     */
+    template<std::size_t BlockSize, std::size_t Count>
+    class BlockPool {
+
+    protected:
+
+        union Block {
+            Block *next;
+            typename std::aligned_storage<BlockSize, alignof(std::max_align_t)>::type data;
+        };
+
+        Block _blocks[Count];         //!< Storage
+        Block *_free = nullptr;       //!< Free list
+        std::size_t _used = 0;        //!< Number of blocks in use
+        bool _initialized = false;    //!< Flag whether the free list is built
+
+    public:
+
+        /**
+         * @brief Takes a block from the pool
+         * @param size Size needed
+         * @return Pointer to the block (or nullptr if the size is too large or the pool is empty)
+         */
+        void *allocate(std::size_t size) {
+
+            // build free list on first use
+            if(!_initialized) {
+                for(std::size_t i = 0; i < Count; ++i)
+                    _blocks[i].next = i + 1 < Count ? &_blocks[i + 1] : nullptr;
+                _free = Count > 0 ? &_blocks[0] : nullptr;
+                _initialized = true;
+            }
+
+            if(size > BlockSize || _free == nullptr)
+                return nullptr;
+
+            auto block = _free;
+            _free = block->next;
+            _used++;
+
+            return block;
+
+        }
+
+
+        /**
+         * @brief Returns a block to the pool
+         * @param pointer Pointer to the block
+         */
+        void release(void *pointer) {
+
+            auto block = static_cast<Block *>(pointer);
+            block->next = _free;
+            _free = block;
+            _used--;
+
+        }
+
+
+        std::size_t used() const { return _used; }
+        static constexpr std::size_t capacity() { return Count; }
+        static constexpr std::size_t blockSize() { return BlockSize; }
+
+    };
+
+
+    /**
+     * @brief Deleter for objects placed in a pool.
+     * Destroys the object and hands the memory back to the pool by the release function.
+     */
+    struct PoolDeleter {
+
+        void (*release)(void *);           //!< Function returning the memory to the pool
+
+        template<typename T>
+        void operator()(T *pointer) const {
+
+            pointer->~T();
+            release(pointer);
+
+        }
+
+    };
+
+}
+
+#endif // STATE_MACHINE_FIXED_H
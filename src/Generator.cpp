@@ -0,0 +1,191 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-04.
+//
+
+#include <algorithm>
+#include <utility>
+#include "Generator.h"
+
+using namespace emb;
+
+
+MachineGenerator::MachineGenerator(const GeneratorConfig &config) : _config(config), _random(config.seed) {
+
+    // frontier of states which may get sub-states (state and level)
+    std::vector<std::pair<State *, unsigned int>> frontier{{&_machine, 0}};
+
+    while(_states < _config.states && !frontier.empty()) {
+
+        // prefer the deepest state (grows deep hierarchies), otherwise a random one
+        auto index = _random() % 2 == 0 ? frontier.size() - 1 : _random() % frontier.size();
+        auto parent = frontier[index];
+        frontier.erase(frontier.begin() + (long) index);
+
+        // create sub-states
+        auto children = 1 + _random() % (_config.fanOut > 0 ? _config.fanOut : 1);
+        for(unsigned long c = 0; c < children && _states < _config.states; ++c) {
+
+            auto state = parent.first->createState();
+            _states++;
+
+            if(parent.second + 1 < _config.depth)
+                frontier.emplace_back(state, parent.second + 1);
+
+            if(parent.second + 1 > _depth)
+                _depth = parent.second + 1;
+
+        }
+
+    }
+
+    // classify states
+    std::vector<State *> stack{&_machine};
+    while(!stack.empty()) {
+
+        auto state = stack.back();
+        stack.pop_back();
+
+        for(auto child : state->getChildren()) {
+            (child->getChildren().empty() ? _leaves : _composites).push_back(child);
+            stack.push_back(child);
+        }
+
+    }
+
+    // transitions between leaves
+    auto threshold = (unsigned long) (_config.probability * (double) (std::minstd_rand::max() - std::minstd_rand::min()));
+    auto cost = _config.guardCost;
+
+    for(auto leaf : _leaves) {
+
+        for(unsigned int t = 0; t < _config.transitions; ++t) {
+
+            auto target = _leaves[_random() % _leaves.size()];
+            leaf->addTransition([this, cost, threshold](const Transition *) {
+                return _guard(cost, threshold);
+            }, target);
+
+        }
+
+    }
+
+}
+
+
+bool MachineGenerator::_guard(unsigned int cost, unsigned long threshold) {
+
+    _evaluations++;
+
+    // burn work
+    volatile unsigned long work = 0;
+    for(unsigned int i = 0; i < cost; ++i)
+        work = work + i;
+
+    return _random() - std::minstd_rand::min() < threshold;
+
+}
+
+
+State &MachineGenerator::machine() {
+
+    return _machine;
+
+}
+
+
+void MachineGenerator::initialize() {
+
+    if(!_leaves.empty())
+        _leaves[_random() % _leaves.size()]->initialize();
+
+}
+
+
+bool MachineGenerator::check(std::string *message) const {
+
+    auto fail = [message](const std::string &text) {
+        if(message != nullptr)
+            *message = text;
+        return false;
+    };
+
+    if(_leaves.empty())
+        return true;
+
+    // active path ends in a leaf
+    std::vector<const State *> path{};
+    const State *state = &_machine;
+    while(state->currentState() != nullptr) {
+
+        if(state->currentState()->getParent() != state)
+            return fail("current state is not a sub-state");
+
+        state = state->currentState();
+        path.push_back(state);
+
+    }
+
+    if(state == &_machine)
+        return fail("no active state");
+
+    if(!state->getChildren().empty())
+        return fail("active composite state has nullptr as current state");
+
+    // inactive composites must not have an active sub-state (exactly one active leaf)
+    for(auto composite : _composites) {
+
+        if(composite->currentState() != nullptr && std::find(path.begin(), path.end(), composite) == path.end())
+            return fail("inactive composite state has an active sub-state");
+
+    }
+
+    return true;
+
+}
+
+
+unsigned long MachineGenerator::states() const {
+
+    return _states;
+
+}
+
+
+unsigned long MachineGenerator::leaves() const {
+
+    return _leaves.size();
+
+}
+
+
+unsigned int MachineGenerator::depth() const {
+
+    return _depth;
+
+}
+
+
+unsigned long MachineGenerator::evaluations() const {
+
+    return _evaluations;
+
+}
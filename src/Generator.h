@@ -0,0 +1,133 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-04.
+//
+
+
+#ifndef STATE_MACHINE_GENERATOR_H
+#define STATE_MACHINE_GENERATOR_H
+
+#include <random>
+#include <string>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    struct GeneratorConfig {
+
+        unsigned long states = 100;      //!< Number of states (root excluded)
+        unsigned int depth = 3;          //!< Maximum depth of the hierarchy
+        unsigned int fanOut = 8;         //!< Maximum number of sub-states of a composite state
+        unsigned int transitions = 4;    //!< Number of transitions per leaf state
+        double probability = 0.05;       //!< Probability that a guard is fulfilled when evaluated
+        unsigned int guardCost = 0;      //!< Work per guard evaluation (loop iterations)
+        unsigned long seed = 1;          //!< Seed of the random generator
+
+    };
+
+
+    /**
+     * @brief Builds random machines for stress tests, scaling benchmarks and fuzzing.
+     * The hierarchy is grown randomly up to the given depth and fan-out. Leaf states get transitions to random leaf
+     * states, each guarded by a condition that burns the given work and is fulfilled with the given probability.
+     * check() verifies the invariants of a running machine.
+     */
+    class MachineGenerator {
+
+    protected:
+
+        GeneratorConfig _config;                 //!< Configuration
+        State _machine{};                        //!< Root state
+        std::vector<State *> _leaves{};          //!< Leaf states
+        std::vector<State *> _composites{};      //!< Composite states (root excluded)
+        std::minstd_rand _random;                //!< Random generator (also used by the guards)
+        unsigned long _states = 0;               //!< Number of states
+        unsigned int _depth = 0;                 //!< Reached depth
+        unsigned long _evaluations = 0;          //!< Number of guard evaluations
+
+
+        /** Evaluates a generated guard */
+        bool _guard(unsigned int cost, unsigned long threshold);
+
+    public:
+
+        /**
+         * @brief Builds the machine
+         * @param config Configuration
+         */
+        explicit MachineGenerator(const GeneratorConfig &config);
+
+
+        /**
+         * @brief Returns the machine
+         * @return Root state
+         */
+        State &machine();
+
+
+        /**
+         * @brief Initializes a random leaf state
+         */
+        void initialize();
+
+
+        /**
+         * @brief Checks the invariants: the active path ends in exactly one active leaf state, no active composite
+         * state has a nullptr current state and no inactive state has an active sub-state.
+         * @param message Description of the violation (optional)
+         * @return Flag whether the invariants hold
+         */
+        bool check(std::string *message = nullptr) const;
+
+
+        /**
+         * @brief Returns the number of states (root excluded)
+         * @return Number of states
+         */
+        unsigned long states() const;
+
+
+        /**
+         * @brief Returns the number of leaf states
+         * @return Number of leaf states
+         */
+        unsigned long leaves() const;
+
+
+        /**
+         * @brief Returns the reached depth of the hierarchy
+         * @return Depth
+         */
+        unsigned int depth() const;
+
+
+        /**
+         * @brief Returns the number of guard evaluations
+         * @return Number of evaluations
+         */
+        unsigned long evaluations() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_GENERATOR_H
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-20.
+//
+
+#include "Group.h"
+
+using namespace emb;
+
+
+MachineGroup::MachineGroup(unsigned int threads) {
+
+    for(unsigned int i = 0; i < threads; ++i)
+        _threads.emplace_back(&MachineGroup::_work, this, i + 1);
+
+}
+
+
+MachineGroup::~MachineGroup() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _start.notify_all();
+    for(auto &t : _threads)
+        t.join();
+
+}
+
+
+void MachineGroup::add(State *machine) {
+
+    _machines.push_back(machine);
+    _pending.push_back(nullptr);
+
+}
+
+
+unsigned long MachineGroup::size() const {
+
+    return _machines.size();
+
+}
+
+
+unsigned long MachineGroup::step() {
+
+    // take the events before any guard is evaluated, guards may read the events of other machines
+    for(auto machine : _machines)
+        machine->_takeEvent();
+
+    // read phase (the calling thread takes the first part)
+    if(!_threads.empty()) {
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _generation++;
+            _remaining = (unsigned int) _threads.size();
+        }
+
+        _start.notify_all();
+        _read(0);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() { return _remaining == 0; });
+
+    } else {
+
+        _read(0);
+
+    }
+
+    // commit phase in the order of the machines
+    unsigned long count = 0;
+    for(unsigned long i = 0; i < _machines.size(); ++i) {
+
+        _machines[i]->_commitStep(_pending[i]);
+        count += _pending[i] != nullptr ? 1 : 0;
+
+    }
+
+    _transitions += count;
+
+    return count;
+
+}
+
+
+unsigned long MachineGroup::transitions() const {
+
+    return _transitions;
+
+}
+
+
+void MachineGroup::_read(unsigned int part) {
+
+    // contiguous part of the machines
+    auto parts = _threads.size() + 1;
+    auto begin = _machines.size() * part / parts;
+    auto end = _machines.size() * (part + 1) / parts;
+
+    for(auto i = begin; i < end; ++i)
+        _pending[i] = _machines[i]->_prepareStep();
+
+}
+
+
+void MachineGroup::_work(unsigned int part) {
+
+    unsigned long generation = 0;
+
+    while(true) {
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _start.wait(lock, [this, generation]() { return _stop || _generation != generation; });
+
+            if(_stop)
+                return;
+
+            generation = _generation;
+        }
+
+        _read(part);
+
+        // last thread finishes the phase
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_remaining == 0)
+            _done.notify_one();
+
+    }
+
+}
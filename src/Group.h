@@ -0,0 +1,119 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-20.
+//
+
+
+#ifndef STATE_MACHINE_GROUP_H
+#define STATE_MACHINE_GROUP_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    /**
+     * @brief Group of interacting machines stepped in two phases.
+     * At the beginning of a step, the events of all machines are taken on the calling thread. In the read phase, the
+     * transitions of all machines are looked up (guards evaluated from the root down the active path) while no
+     * machine is changed, so every guard sees the states and events of the other machines as they were at the
+     * beginning of the step. In the commit phase, the step callbacks are run and the fired
+     * transitions are taken, machine by machine in the order they were added. The result therefore does not depend
+     * on the order of the machines, and the read phase can be split across threads. Guards must not change any
+     * machine. Unlike State::step(), all guards of a machine are evaluated before its step callbacks run, and no
+     * time step delay is applied.
+     */
+    class MachineGroup {
+
+    protected:
+
+        std::vector<State *> _machines{};              //!< Root states
+        std::vector<const Transition *> _pending{};    //!< Transition per machine found in the read phase
+        unsigned long _transitions = 0;                //!< Number of transitions taken
+
+        std::vector<std::thread> _threads{};           //!< Threads sharing the read phase
+        std::mutex _mutex{};                           //!< Protects the phase state below
+        std::condition_variable _start{};              //!< Starts a read phase
+        std::condition_variable _done{};               //!< Signals the end of a read phase
+        unsigned long _generation = 0;                 //!< Number of read phases started
+        unsigned int _remaining = 0;                   //!< Threads still reading
+        bool _stop = false;                            //!< Flag to stop the threads
+
+
+        /** Looks up the transitions of a part of the machines */
+        void _read(unsigned int part);
+
+        /** Thread function */
+        void _work(unsigned int part);
+
+    public:
+
+        /**
+         * @brief Creates the group
+         * @param threads Number of additional threads evaluating the guards (0: read phase on the calling thread)
+         */
+        explicit MachineGroup(unsigned int threads = 0);
+
+
+        /**
+         * @brief Stops the threads
+         */
+        ~MachineGroup();
+
+        MachineGroup(const MachineGroup &) = delete;
+        MachineGroup &operator=(const MachineGroup &) = delete;
+
+
+        /**
+         * @brief Adds a machine (not while stepping)
+         * @param machine Root state of the machine (must be initialized)
+         */
+        void add(State *machine);
+
+
+        /**
+         * Returns the number of machines
+         * @return Number of machines
+         */
+        unsigned long size() const;
+
+
+        /**
+         * @brief Performs a two-phase step of all machines
+         * @return Number of transitions taken in this step
+         */
+        unsigned long step();
+
+
+        /**
+         * Returns the number of transitions taken in all steps
+         * @return Number of transitions
+         */
+        unsigned long transitions() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_GROUP_H
@@ -0,0 +1,673 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-15.
+//
+
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include "Guard.h"
+#include "State.h"
+
+using namespace emb;
+
+
+namespace {
+
+    /** Simple recursive descent parser for guard expressions */
+    struct GuardParser {
+
+        const std::string &text;
+        size_t pos;
+        unsigned int depth; // nesting of parentheses and unary operators
+
+
+        void skip() {
+
+            while(pos < text.size() && std::isspace((unsigned char) text[pos]))
+                pos++;
+
+        }
+
+
+        bool accept(const char *token) {
+
+            skip();
+
+            // compare token
+            size_t n = 0;
+            while(token[n] != '\0') {
+                if(pos + n >= text.size() || text[pos + n] != token[n])
+                    return false;
+                n++;
+            }
+
+            // don't take the first character of a two-character operator
+            if(n == 1 && pos + 1 < text.size() && text[pos + 1] == '='
+               && (token[0] == '<' || token[0] == '>' || token[0] == '!' || token[0] == '='))
+                return false;
+
+            pos += n;
+            return true;
+
+        }
+
+
+        bool identifier(std::string &name) {
+
+            skip();
+
+            // read identifier
+            size_t start = pos;
+            while(pos < text.size() && (std::isalnum((unsigned char) text[pos]) || text[pos] == '_' || text[pos] == '.'))
+                pos++;
+
+            name = text.substr(start, pos - start);
+            return !name.empty();
+
+        }
+
+
+        bool primary(Guard &out) {
+
+            skip();
+            if(pos >= text.size())
+                return false;
+
+            // parenthesis
+            if(accept("(")) {
+
+                if(++depth > EMB_GUARD_PARSE_DEPTH)
+                    return false;
+
+                auto ok = disjunction(out) && accept(")");
+                depth--;
+
+                return ok;
+
+            }
+
+            // number
+            if(std::isdigit((unsigned char) text[pos]) || text[pos] == '.') {
+
+                char *end = nullptr;
+                double value = std::strtod(text.c_str() + pos, &end);
+                if(end == text.c_str() + pos)
+                    return false;
+
+                pos = (size_t) (end - text.c_str());
+                out = Guard(value);
+
+                return true;
+
+            }
+
+            // parameter
+            if(accept("$")) {
+
+                std::string name;
+                if(!identifier(name))
+                    return false;
+
+                out = Guard::parameter(name, 0.0);
+                return true;
+
+            }
+
+            // keywords and signals
+            std::string name;
+            if(!identifier(name))
+                return false;
+
+            if(name == "true")
+                out = Guard(1.0);
+            else if(name == "false")
+                out = Guard(0.0);
+            else if(name == "time")
+                out = Guard::time();
+            else if(name == "event")
+                out = Guard::event();
+            else
+                out = Guard::signal(name);
+
+            return true;
+
+        }
+
+
+        bool unary(Guard &out) {
+
+            if(accept("!")) {
+                if(++depth > EMB_GUARD_PARSE_DEPTH || !unary(out)) return false;
+                depth--;
+                out = !out;
+                return true;
+            }
+
+            if(accept("-")) {
+                if(++depth > EMB_GUARD_PARSE_DEPTH || !unary(out)) return false;
+                depth--;
+                out = -out;
+                return true;
+            }
+
+            return primary(out);
+
+        }
+
+
+        bool product(Guard &out) {
+
+            if(!unary(out))
+                return false;
+
+            Guard right;
+            while(true) {
+                if(accept("*")) {
+                    if(!unary(right)) return false;
+                    out = out * right;
+                } else if(accept("/")) {
+                    if(!unary(right)) return false;
+                    out = out / right;
+                } else
+                    return true;
+            }
+
+        }
+
+
+        bool sum(Guard &out) {
+
+            if(!product(out))
+                return false;
+
+            Guard right;
+            while(true) {
+                if(accept("+")) {
+                    if(!product(right)) return false;
+                    out = out + right;
+                } else if(accept("-")) {
+                    if(!product(right)) return false;
+                    out = out - right;
+                } else
+                    return true;
+            }
+
+        }
+
+
+        bool comparison(Guard &out) {
+
+            if(!sum(out))
+                return false;
+
+            Guard right;
+            if(accept("<=")) {
+                if(!sum(right)) return false;
+                out = out <= right;
+            } else if(accept(">=")) {
+                if(!sum(right)) return false;
+                out = out >= right;
+            } else if(accept("==")) {
+                if(!sum(right)) return false;
+                out = out == right;
+            } else if(accept("!=")) {
+                if(!sum(right)) return false;
+                out = out != right;
+            } else if(accept("<")) {
+                if(!sum(right)) return false;
+                out = out < right;
+            } else if(accept(">")) {
+                if(!sum(right)) return false;
+                out = out > right;
+            }
+
+            return true;
+
+        }
+
+
+        bool conjunction(Guard &out) {
+
+            if(!comparison(out))
+                return false;
+
+            Guard right;
+            while(accept("&&")) {
+                if(!comparison(right)) return false;
+                out = out && right;
+            }
+
+            return true;
+
+        }
+
+
+        bool disjunction(Guard &out) {
+
+            if(!conjunction(out))
+                return false;
+
+            Guard right;
+            while(accept("||")) {
+                if(!conjunction(right)) return false;
+                out = out || right;
+            }
+
+            return true;
+
+        }
+
+    };
+
+}
+
+
+Guard::Guard() : Guard(1.0) {}
+
+
+Guard::Guard(double value) {
+
+    _constants.push_back(value);
+    _emit(GuardOp::Constant, 0);
+    _depth = 1;
+
+}
+
+
+Guard Guard::signal(const std::string &name) {
+
+    Guard g{};
+    g._constants.clear();
+    g._code.clear();
+
+    // add signal
+    g._signalNames.push_back(name);
+    g._signals.push_back(nullptr);
+    g._emit(GuardOp::Signal, 0);
+
+    return g;
+
+}
+
+
+Guard Guard::parameter(const std::string &name, double value) {
+
+    Guard g{};
+    g._constants.clear();
+    g._code.clear();
+
+    // add parameter
+    g._parameterNames.push_back(name);
+    g._parameters.push_back(value);
+    g._emit(GuardOp::Parameter, 0);
+
+    return g;
+
+}
+
+
+Guard Guard::time() {
+
+    Guard g{};
+    g._constants.clear();
+    g._code.clear();
+    g._emit(GuardOp::Time);
+
+    return g;
+
+}
+
+
+Guard Guard::event() {
+
+    Guard g{};
+    g._constants.clear();
+    g._code.clear();
+    g._emit(GuardOp::Event);
+
+    return g;
+
+}
+
+
+bool Guard::parse(const std::string &text, Guard &guard) {
+
+    // parse whole text
+    GuardParser parser{text, 0, 0};
+    Guard result{};
+    if(!parser.disjunction(result))
+        return false;
+
+    // check for trailing characters
+    parser.skip();
+    if(parser.pos != text.size())
+        return false;
+
+    guard = result;
+    return true;
+
+}
+
+
+void Guard::_emit(GuardOp op, unsigned short arg) {
+
+    _code.push_back(GuardInstruction{op, arg});
+
+}
+
+
+void Guard::_append(const Guard &other) {
+
+    // offsets for constants
+    auto constOffset = (unsigned short) _constants.size();
+    _constants.insert(_constants.end(), other._constants.begin(), other._constants.end());
+
+    // copy code and remap the table indices
+    for(auto ins : other._code) {
+
+        if(ins.op == GuardOp::Constant) {
+
+            ins.arg = (unsigned short) (ins.arg + constOffset);
+
+        } else if(ins.op == GuardOp::Signal) {
+
+            // find or add signal by name
+            auto &name = other._signalNames[ins.arg];
+            unsigned short i = 0;
+            while(i < _signalNames.size() && _signalNames[i] != name)
+                i++;
+
+            if(i == _signalNames.size()) {
+                _signalNames.push_back(name);
+                _signals.push_back(other._signals[ins.arg]);
+            }
+
+            ins.arg = i;
+
+        } else if(ins.op == GuardOp::Parameter) {
+
+            // find or add parameter by name
+            auto &name = other._parameterNames[ins.arg];
+            unsigned short i = 0;
+            while(i < _parameterNames.size() && _parameterNames[i] != name)
+                i++;
+
+            if(i == _parameterNames.size()) {
+                _parameterNames.push_back(name);
+                _parameters.push_back(other._parameters[ins.arg]);
+            }
+
+            ins.arg = i;
+
+        }
+
+        _code.push_back(ins);
+
+    }
+
+    // the result of this guard stays on the stack while the other is evaluated
+    if(other._depth + 1 > _depth)
+        _depth = other._depth + 1;
+
+}
+
+
+Guard Guard::_binary(const Guard &left, const Guard &right, GuardOp op) {
+
+    Guard g = left;
+    g._append(right);
+    g._emit(op);
+
+    return g;
+
+}
+
+
+bool Guard::bind(const std::string &name, const double *source) {
+
+    for(size_t i = 0; i < _signalNames.size(); ++i) {
+
+        if(_signalNames[i] == name) {
+            _signals[i] = source;
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+
+bool Guard::setParameter(const std::string &name, double value) {
+
+    for(size_t i = 0; i < _parameterNames.size(); ++i) {
+
+        if(_parameterNames[i] == name) {
+            _parameters[i] = value;
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+
+const std::vector<std::string> &Guard::signals() const {
+
+    return _signalNames;
+
+}
+
+
+const std::vector<std::string> &Guard::parameters() const {
+
+    return _parameterNames;
+
+}
+
+
+const std::vector<GuardInstruction> &Guard::code() const {
+
+    return _code;
+
+}
+
+
+double Guard::operand(const GuardInstruction &instruction) const {
+
+    if(instruction.op == GuardOp::Constant)
+        return _constants[instruction.arg];
+    else if(instruction.op == GuardOp::Parameter)
+        return _parameters[instruction.arg];
+
+    return std::numeric_limits<double>::quiet_NaN();
+
+}
+
+
+bool Guard::uses(GuardOp op) const {
+
+    for(auto &ins : _code) {
+        if(ins.op == op)
+            return true;
+    }
+
+    return false;
+
+}
+
+
+bool Guard::identical(const Guard &other) const {
+
+    if(_code.size() != other._code.size())
+        return false;
+
+    for(unsigned long i = 0; i < _code.size(); ++i) {
+        if(_code[i].op != other._code[i].op || _code[i].arg != other._code[i].arg)
+            return false;
+    }
+
+    return _constants == other._constants && _parameters == other._parameters
+            && _parameterNames == other._parameterNames && _signals == other._signals
+            && _signalNames == other._signalNames;
+
+}
+
+
+bool Guard::valid() const {
+
+    // check stack size
+    if(_depth > EMB_GUARD_STACK_SIZE || _code.empty())
+        return false;
+
+    // check bindings
+    for(auto s : _signals) {
+        if(s == nullptr)
+            return false;
+    }
+
+    return true;
+
+}
+
+
+double Guard::value(double time, const Event *event) const {
+
+    double stack[EMB_GUARD_STACK_SIZE];
+    unsigned int top = 0;
+
+    // refuse programs which would overflow the stack
+    if(_depth > EMB_GUARD_STACK_SIZE || _code.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+
+    for(auto &ins : _code) {
+
+        switch(ins.op) {
+
+            // operands
+            case GuardOp::Constant:
+                stack[top++] = _constants[ins.arg];
+                break;
+            case GuardOp::Parameter:
+                stack[top++] = _parameters[ins.arg];
+                break;
+            case GuardOp::Signal:
+                stack[top++] = _signals[ins.arg] != nullptr
+                        ? *_signals[ins.arg] : std::numeric_limits<double>::quiet_NaN();
+                break;
+            case GuardOp::Time:
+                stack[top++] = time;
+                break;
+            case GuardOp::Event:
+                stack[top++] = event != nullptr
+                        ? (double) event->id : std::numeric_limits<double>::quiet_NaN();
+                break;
+
+            // unary operations
+            case GuardOp::Not:
+                stack[top - 1] = stack[top - 1] == 0.0 ? 1.0 : 0.0;
+                break;
+            case GuardOp::Negate:
+                stack[top - 1] = -stack[top - 1];
+                break;
+
+            // binary operations
+            default: {
+
+                double r = stack[--top];
+                double &l = stack[top - 1];
+
+                switch(ins.op) {
+                    case GuardOp::Add:          l = l + r; break;
+                    case GuardOp::Subtract:     l = l - r; break;
+                    case GuardOp::Multiply:     l = l * r; break;
+                    case GuardOp::Divide:       l = l / r; break;
+                    case GuardOp::Less:         l = l < r ? 1.0 : 0.0; break;
+                    case GuardOp::LessEqual:    l = l <= r ? 1.0 : 0.0; break;
+                    case GuardOp::Greater:      l = l > r ? 1.0 : 0.0; break;
+                    case GuardOp::GreaterEqual: l = l >= r ? 1.0 : 0.0; break;
+                    case GuardOp::Equal:        l = l == r ? 1.0 : 0.0; break;
+                    case GuardOp::NotEqual:     l = l != r ? 1.0 : 0.0; break;
+                    case GuardOp::And:          l = (l != 0.0 && r != 0.0) ? 1.0 : 0.0; break;
+                    case GuardOp::Or:           l = (l != 0.0 || r != 0.0) ? 1.0 : 0.0; break;
+                    default: break;
+                }
+
+            }
+
+        }
+
+    }
+
+    return stack[0];
+
+}
+
+
+bool Guard::evaluate(const Transition *transition) const {
+
+    // NaN and zero are false
+    double v = value(transition->from->getTime(), transition->from->currentEvent());
+    return v != 0.0 && v == v;
+
+}
+
+
+Guard Guard::operator!() const {
+
+    Guard g = *this;
+    g._emit(GuardOp::Not);
+
+    return g;
+
+}
+
+
+Guard Guard::operator-() const {
+
+    Guard g = *this;
+    g._emit(GuardOp::Negate);
+
+    return g;
+
+}
+
+
+namespace emb {
+
+    Guard operator+(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Add); }
+    Guard operator-(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Subtract); }
+    Guard operator*(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Multiply); }
+    Guard operator/(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Divide); }
+    Guard operator<(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Less); }
+    Guard operator<=(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::LessEqual); }
+    Guard operator>(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Greater); }
+    Guard operator>=(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::GreaterEqual); }
+    Guard operator==(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Equal); }
+    Guard operator!=(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::NotEqual); }
+    Guard operator&&(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::And); }
+    Guard operator||(const Guard &left, const Guard &right) { return Guard::_binary(left, right, GuardOp::Or); }
+
+}
@@ -0,0 +1,256 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-15.
+//
+
+
+#ifndef STATE_MACHINE_GUARD_H
+#define STATE_MACHINE_GUARD_H
+
+#include <string>
+#include <vector>
+
+#ifndef EMB_GUARD_STACK_SIZE
+#define EMB_GUARD_STACK_SIZE 16
+#endif
+
+#ifndef EMB_GUARD_PARSE_DEPTH
+#define EMB_GUARD_PARSE_DEPTH 64
+#endif
+
+namespace emb {
+
+    struct Transition;   //!< Pre-definition of type transition
+    struct Event;        //!< Pre-definition of type event
+
+    /** Operation codes of the guard byte code */
+    enum class GuardOp : unsigned char {
+        Constant, Parameter, Signal, Time, Event,
+        Not, Negate,
+        Add, Subtract, Multiply, Divide,
+        Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual,
+        And, Or
+    };
+
+    struct GuardInstruction {
+
+        GuardOp op;           //!< Operation
+        unsigned short arg;   //!< Index into the constant, parameter or signal table
+
+    };
+
+
+    /**
+     * @brief Declarative transition condition.
+     * A guard is built from constants, named parameters, named signals, the state time and the current event using
+     * the usual operators, e.g. `Guard::signal("temp") > Guard::parameter("limit", 80.0) && Guard::time() > 2.0`,
+     * or parsed from text. The expression is stored as postfix byte code and evaluated by a small stack machine
+     * without allocations. Signals are bound to external variables by name.
+     */
+    class Guard {
+
+    protected:
+
+        std::vector<GuardInstruction> _code{};    //!< Postfix byte code
+        std::vector<double> _constants{};         //!< Constant pool
+        std::vector<double> _parameters{};        //!< Parameter values
+        std::vector<std::string> _parameterNames{}; //!< Parameter names
+        std::vector<const double *> _signals{};   //!< Bound signal sources
+        std::vector<std::string> _signalNames{};  //!< Signal names
+        unsigned int _depth = 0;                  //!< Maximum stack depth needed for evaluation
+
+
+        /** Appends the code of the given guard and merges its tables */
+        void _append(const Guard &other);
+
+        /** Combines two guards by the given binary operation */
+        static Guard _binary(const Guard &left, const Guard &right, GuardOp op);
+
+        /** Adds a single instruction */
+        void _emit(GuardOp op, unsigned short arg = 0);
+
+    public:
+
+        /**
+         * @brief Creates a guard which is constantly true.
+         */
+        Guard();
+
+
+        /**
+         * @brief Creates a constant guard expression (allows implicit conversion from numbers)
+         * @param value Constant value
+         */
+        Guard(double value);
+
+
+        /**
+         * @brief Creates a named signal reference. The signal must be bound before evaluation.
+         * @param name Name of the signal
+         * @return The guard expression
+         */
+        static Guard signal(const std::string &name);
+
+
+        /**
+         * @brief Creates a named parameter with a default value. Parameters can be changed after construction.
+         * @param name Name of the parameter
+         * @param value Initial value of the parameter
+         * @return The guard expression
+         */
+        static Guard parameter(const std::string &name, double value);
+
+
+        /**
+         * @brief Creates a reference to the time of the source state of the transition (in seconds)
+         * @return The guard expression
+         */
+        static Guard time();
+
+
+        /**
+         * @brief Creates a reference to the id of the current event (NaN when no event is present)
+         * @return The guard expression
+         */
+        static Guard event();
+
+
+        /**
+         * @brief Parses a guard from text.
+         * Supported are numbers, `true`, `false`, `time`, `event`, parameters (`$name`), signals (any other
+         * identifier), parentheses and the operators `! - * / + < <= > >= == != && ||` with C precedence.
+         * Parentheses and unary operators may be nested up to EMB_GUARD_PARSE_DEPTH levels.
+         * @param text Text to be parsed
+         * @param guard Guard to be written to
+         * @return Flag whether the text could be parsed
+         */
+        static bool parse(const std::string &text, Guard &guard);
+
+
+        /**
+         * @brief Binds a signal to an external source
+         * @param name Name of the signal
+         * @param source Pointer to the value to be read on evaluation
+         * @return Flag whether the signal is used by the guard
+         */
+        bool bind(const std::string &name, const double *source);
+
+
+        /**
+         * @brief Sets the value of a parameter
+         * @param name Name of the parameter
+         * @param value Value to be set
+         * @return Flag whether the parameter is used by the guard
+         */
+        bool setParameter(const std::string &name, double value);
+
+
+        /**
+         * @brief Returns the names of the signals the guard reads
+         * @return Signal names
+         */
+        const std::vector<std::string> &signals() const;
+
+
+        /**
+         * @brief Returns the names of the parameters of the guard
+         * @return Parameter names
+         */
+        const std::vector<std::string> &parameters() const;
+
+
+        /**
+         * @brief Returns the byte code of the guard
+         * @return Instructions
+         */
+        const std::vector<GuardInstruction> &code() const;
+
+
+        /**
+         * @brief Returns the value of a constant or parameter instruction
+         * @param instruction Instruction of the byte code
+         * @return The value (NaN for other instructions)
+         */
+        double operand(const GuardInstruction &instruction) const;
+
+
+        /**
+         * @brief Returns whether the guard reads the given operation (e.g. the time or the event)
+         * @param op Operation to be checked
+         * @return Flag
+         */
+        bool uses(GuardOp op) const;
+
+
+        /**
+         * @brief Returns whether both guards are the same expression (byte code, constants, parameters and signals)
+         * @param other Guard to be compared with
+         * @return Flag
+         */
+        bool identical(const Guard &other) const;
+
+
+        /**
+         * @brief Returns whether the guard can be evaluated.
+         * This is the case when all signals are bound and the stack depth fits into EMB_GUARD_STACK_SIZE.
+         * @return Flag
+         */
+        bool valid() const;
+
+
+        /**
+         * @brief Evaluates the guard
+         * @param time Time to be used for the time reference
+         * @param event Current event (or nullptr)
+         * @return The result of the expression
+         */
+        double value(double time, const Event *event) const;
+
+
+        /**
+         * @brief Evaluates the guard as transition condition
+         * @param transition Transition to be checked
+         * @return Flag whether the condition is fulfilled
+         */
+        bool evaluate(const Transition *transition) const;
+
+
+        Guard operator!() const;
+        Guard operator-() const;
+
+        friend Guard operator+(const Guard &left, const Guard &right);
+        friend Guard operator-(const Guard &left, const Guard &right);
+        friend Guard operator*(const Guard &left, const Guard &right);
+        friend Guard operator/(const Guard &left, const Guard &right);
+        friend Guard operator<(const Guard &left, const Guard &right);
+        friend Guard operator<=(const Guard &left, const Guard &right);
+        friend Guard operator>(const Guard &left, const Guard &right);
+        friend Guard operator>=(const Guard &left, const Guard &right);
+        friend Guard operator==(const Guard &left, const Guard &right);
+        friend Guard operator!=(const Guard &left, const Guard &right);
+        friend Guard operator&&(const Guard &left, const Guard &right);
+        friend Guard operator||(const Guard &left, const Guard &right);
+
+    };
+
+}
+
+#endif // STATE_MACHINE_GUARD_H
@@ -0,0 +1,746 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Json.h"
+
+using namespace emb;
+
+
+namespace {
+
+    inline bool isSpace(char c) {
+
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+
+    }
+
+
+    inline bool isDigit(char c) {
+
+        return c >= '0' && c <= '9';
+
+    }
+
+
+    inline int hexValue(char c) {
+
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+
+    }
+
+}
+
+
+bool JsonString::equals(const char *other) const {
+
+    auto n = std::strlen(other);
+    return n == size && std::memcmp(data, other, n) == 0;
+
+}
+
+
+unsigned long JsonString::unescape(char *buffer, unsigned long capacity) const {
+
+    unsigned long n = 0;
+    for(unsigned long i = 0; i < size && n + 1 < capacity; ++i) {
+
+        // plain character
+        char c = data[i];
+        if(c != '\\' || i + 1 >= size) {
+            buffer[n++] = c;
+            continue;
+        }
+
+        // escape sequence
+        c = data[++i];
+        switch(c) {
+            case 'b': buffer[n++] = '\b'; break;
+            case 'f': buffer[n++] = '\f'; break;
+            case 'n': buffer[n++] = '\n'; break;
+            case 'r': buffer[n++] = '\r'; break;
+            case 't': buffer[n++] = '\t'; break;
+            case 'u': {
+
+                // read code point (four hex digits)
+                unsigned int cp = 0;
+                auto valid = i + 4 < size;
+                for(unsigned long k = 1; valid && k <= 4; ++k) {
+                    auto h = hexValue(data[i + k]);
+                    valid = h >= 0;
+                    cp = (cp << 4u) | (unsigned int) h;
+                }
+
+                // copy invalid sequences literally
+                if(!valid) {
+                    buffer[n++] = '\\';
+                    if(n + 1 < capacity)
+                        buffer[n++] = 'u';
+                    break;
+                }
+
+                i += 4;
+
+                // encode as UTF-8 (surrogate pairs are not combined)
+                if(cp < 0x80) {
+                    buffer[n++] = (char) cp;
+                } else if(cp < 0x800 && n + 2 < capacity) {
+                    buffer[n++] = (char) (0xC0 | (cp >> 6u));
+                    buffer[n++] = (char) (0x80 | (cp & 0x3Fu));
+                } else if(n + 3 < capacity) {
+                    buffer[n++] = (char) (0xE0 | (cp >> 12u));
+                    buffer[n++] = (char) (0x80 | ((cp >> 6u) & 0x3Fu));
+                    buffer[n++] = (char) (0x80 | (cp & 0x3Fu));
+                }
+
+                break;
+
+            }
+            default: buffer[n++] = c; break;
+        }
+
+    }
+
+    // terminate
+    if(capacity > 0)
+        buffer[n] = '\0';
+
+    return n;
+
+}
+
+
+JsonReader::JsonReader(const char *data, unsigned long size) : _data(data), _size(size) {}
+
+
+char JsonReader::_peek() {
+
+    while(_pos < _size && isSpace(_data[_pos]))
+        _pos++;
+
+    return _pos < _size ? _data[_pos] : '\0';
+
+}
+
+
+void JsonReader::_valueDone() {
+
+    _expect = _depth == 0 ? Expect::Done : Expect::CommaOrEnd;
+
+}
+
+
+bool JsonReader::_readString() {
+
+    // skip quote
+    auto start = ++_pos;
+    while(_pos < _size && _data[_pos] != '"') {
+
+        // skip escaped character
+        if(_data[_pos] == '\\')
+            _pos++;
+
+        _pos++;
+
+    }
+
+    if(_pos >= _size)
+        return false;
+
+    _string = JsonString{_data + start, _pos - start};
+    _pos++;
+
+    return true;
+
+}
+
+
+bool JsonReader::_readNumber() {
+
+    auto start = _pos;
+
+    // validate number grammar
+    if(_pos < _size && _data[_pos] == '-')
+        _pos++;
+    if(_pos >= _size || !isDigit(_data[_pos]))
+        return false;
+    while(_pos < _size && isDigit(_data[_pos]))
+        _pos++;
+    if(_pos < _size && _data[_pos] == '.') {
+        _pos++;
+        if(_pos >= _size || !isDigit(_data[_pos]))
+            return false;
+        while(_pos < _size && isDigit(_data[_pos]))
+            _pos++;
+    }
+    if(_pos < _size && (_data[_pos] == 'e' || _data[_pos] == 'E')) {
+        _pos++;
+        if(_pos < _size && (_data[_pos] == '+' || _data[_pos] == '-'))
+            _pos++;
+        if(_pos >= _size || !isDigit(_data[_pos]))
+            return false;
+        while(_pos < _size && isDigit(_data[_pos]))
+            _pos++;
+    }
+
+    // fast path for small integers
+    auto length = _pos - start;
+    if(length < 16) {
+
+        bool integer = true;
+        long long value = 0;
+        for(auto i = start; i < _pos; ++i) {
+
+            if(isDigit(_data[i]))
+                value = value * 10 + (_data[i] - '0');
+            else if(i != start) {
+                integer = false;
+                break;
+            }
+
+        }
+
+        if(integer) {
+            _number = (double) (_data[start] == '-' ? -value : value);
+            return true;
+        }
+
+    }
+
+    // convert with terminated copy (the buffer might not be terminated)
+    char text[64];
+    if(length >= sizeof(text))
+        return false;
+
+    std::memcpy(text, _data + start, length);
+    text[length] = '\0';
+    _number = std::strtod(text, nullptr);
+
+    return true;
+
+}
+
+
+bool JsonReader::_readLiteral(const char *literal) {
+
+    auto n = std::strlen(literal);
+    if(_pos + n > _size || std::memcmp(_data + _pos, literal, n) != 0)
+        return false;
+
+    _pos += n;
+    return true;
+
+}
+
+
+JsonToken JsonReader::next() {
+
+    auto c = _peek();
+
+    // end of container or separator
+    if(_expect == Expect::CommaOrEnd || _expect == Expect::KeyOrEnd || _expect == Expect::ValueOrEnd) {
+
+        char open = _stack[_depth - 1];
+        if((c == '}' && open == '{' && _expect != Expect::ValueOrEnd)
+           || (c == ']' && open == '[' && _expect != Expect::KeyOrEnd)) {
+
+            _pos++;
+            _depth--;
+            _valueDone();
+
+            return open == '{' ? JsonToken::EndObject : JsonToken::EndArray;
+
+        }
+
+        if(_expect == Expect::CommaOrEnd) {
+
+            if(c != ',')
+                return JsonToken::Error;
+
+            _pos++;
+            _expect = open == '{' ? Expect::Key : Expect::Value;
+            c = _peek();
+
+        } else if(_expect == Expect::KeyOrEnd) {
+
+            _expect = Expect::Key;
+
+        } else {
+
+            _expect = Expect::Value;
+
+        }
+
+    }
+
+    // end of document
+    if(_expect == Expect::Done)
+        return c == '\0' ? JsonToken::End : JsonToken::Error;
+
+    // key
+    if(_expect == Expect::Key) {
+
+        if(c != '"' || !_readString() || _peek() != ':')
+            return JsonToken::Error;
+
+        _pos++;
+        _expect = Expect::Value;
+
+        return JsonToken::Key;
+
+    }
+
+    // values
+    switch(c) {
+
+        case '{':
+        case '[':
+
+            if(_depth >= EMB_JSON_MAX_DEPTH)
+                return JsonToken::Error;
+
+            _stack[_depth++] = c;
+            _pos++;
+            _expect = c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+
+            return c == '{' ? JsonToken::BeginObject : JsonToken::BeginArray;
+
+        case '"':
+
+            if(!_readString())
+                return JsonToken::Error;
+
+            _valueDone();
+            return JsonToken::String;
+
+        case 't':
+
+            if(!_readLiteral("true"))
+                return JsonToken::Error;
+
+            _valueDone();
+            return JsonToken::True;
+
+        case 'f':
+
+            if(!_readLiteral("false"))
+                return JsonToken::Error;
+
+            _valueDone();
+            return JsonToken::False;
+
+        case 'n':
+
+            if(!_readLiteral("null"))
+                return JsonToken::Error;
+
+            _valueDone();
+            return JsonToken::Null;
+
+        default:
+
+            if(!_readNumber())
+                return JsonToken::Error;
+
+            _valueDone();
+            return JsonToken::Number;
+
+    }
+
+}
+
+
+bool JsonReader::skip(JsonToken token) {
+
+    // simple values are already consumed
+    if(token != JsonToken::BeginObject && token != JsonToken::BeginArray)
+        return token != JsonToken::Error && token != JsonToken::End;
+
+    // read until the container is closed
+    auto depth = _depth - 1;
+    while(_depth > depth) {
+
+        auto t = next();
+        if(t == JsonToken::Error || t == JsonToken::End)
+            return false;
+
+    }
+
+    return true;
+
+}
+
+
+const JsonString &JsonReader::string() const {
+
+    return _string;
+
+}
+
+
+double JsonReader::number() const {
+
+    return _number;
+
+}
+
+
+unsigned int JsonReader::depth() const {
+
+    return _depth;
+
+}
+
+
+unsigned long JsonReader::position() const {
+
+    return _pos;
+
+}
+
+
+JsonWriter::JsonWriter(char *buffer, unsigned long capacity, JsonSinkCallback &&sink) :
+    _buffer(buffer), _capacity(capacity), _sink(std::move(sink)) {
+
+    _first[0] = true;
+
+}
+
+
+void JsonWriter::_put(char c) {
+
+    // hand full buffer to sink
+    if(_size >= _capacity)
+        flush();
+
+    if(_size < _capacity)
+        _buffer[_size++] = c;
+    else
+        _overflow = true;
+
+}
+
+
+void JsonWriter::_write(const char *data, unsigned long size) {
+
+    while(size > 0) {
+
+        // hand full buffer to sink
+        if(_size >= _capacity) {
+
+            flush();
+
+            if(_size >= _capacity) {
+                _overflow = true;
+                return;
+            }
+
+        }
+
+        // copy as much as possible
+        auto n = _capacity - _size < size ? _capacity - _size : size;
+        std::memcpy(_buffer + _size, data, n);
+        _size += n;
+        data += n;
+        size -= n;
+
+    }
+
+}
+
+
+void JsonWriter::_separate() {
+
+    // value after key
+    if(_afterKey) {
+        _afterKey = false;
+        return;
+    }
+
+    // comma between elements (beyond the maximum depth, the enclosing levels always have an element)
+    auto &first = _excess > 0 ? _excessFirst : _first[_depth];
+    if(!first)
+        _put(',');
+
+    first = false;
+
+}
+
+
+void JsonWriter::_quoted(const char *data, unsigned long size) {
+
+    _put('"');
+
+    // escape special characters
+    unsigned long start = 0;
+    for(unsigned long i = 0; i < size; ++i) {
+
+        auto c = (unsigned char) data[i];
+        if(c != '"' && c != '\\' && c >= 0x20)
+            continue;
+
+        _write(data + start, i - start);
+        start = i + 1;
+
+        char esc[8];
+        switch(c) {
+            case '"':  _write("\\\"", 2); break;
+            case '\\': _write("\\\\", 2); break;
+            case '\n': _write("\\n", 2); break;
+            case '\r': _write("\\r", 2); break;
+            case '\t': _write("\\t", 2); break;
+            default:
+                std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                _write(esc, 6);
+        }
+
+    }
+
+    _write(data + start, size - start);
+    _put('"');
+
+}
+
+
+JsonWriter &JsonWriter::beginObject() {
+
+    _separate();
+    _put('{');
+
+    // open level (deeper levels are only counted)
+    if(_depth + 1 < EMB_JSON_MAX_DEPTH) {
+        _first[++_depth] = true;
+    } else {
+        _excess++;
+        _excessFirst = true;
+    }
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::endObject() {
+
+    if(_excess > 0) {
+        _excess--;
+        _excessFirst = false;
+    } else if(_depth > 0) {
+        _depth--;
+    }
+
+    _put('}');
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::beginArray() {
+
+    _separate();
+    _put('[');
+
+    // open level (deeper levels are only counted)
+    if(_depth + 1 < EMB_JSON_MAX_DEPTH) {
+        _first[++_depth] = true;
+    } else {
+        _excess++;
+        _excessFirst = true;
+    }
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::endArray() {
+
+    if(_excess > 0) {
+        _excess--;
+        _excessFirst = false;
+    } else if(_depth > 0) {
+        _depth--;
+    }
+
+    _put(']');
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::key(const char *name) {
+
+    _separate();
+    _quoted(name, std::strlen(name));
+    _put(':');
+    _afterKey = true;
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::value(const char *text) {
+
+    return value(text, std::strlen(text));
+
+}
+
+
+JsonWriter &JsonWriter::value(const char *text, unsigned long size) {
+
+    _separate();
+    _quoted(text, size);
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::value(double number) {
+
+    _separate();
+
+    // JSON has no representation for NaN and infinity
+    if(number != number || number - number != 0.0) {
+        _write("null", 4);
+        return *this;
+    }
+
+    char text[32];
+    auto n = std::snprintf(text, sizeof(text), "%.17g", number);
+    _write(text, (unsigned long) n);
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::value(long number) {
+
+    _separate();
+
+    char text[32];
+    auto n = std::snprintf(text, sizeof(text), "%ld", number);
+    _write(text, (unsigned long) n);
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::value(unsigned long number) {
+
+    _separate();
+
+    char text[32];
+    auto n = std::snprintf(text, sizeof(text), "%lu", number);
+    _write(text, (unsigned long) n);
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::value(int number) {
+
+    return value((long) number);
+
+}
+
+
+JsonWriter &JsonWriter::value(unsigned int number) {
+
+    return value((unsigned long) number);
+
+}
+
+
+JsonWriter &JsonWriter::value(bool flag) {
+
+    _separate();
+
+    if(flag)
+        _write("true", 4);
+    else
+        _write("false", 5);
+
+    return *this;
+
+}
+
+
+JsonWriter &JsonWriter::null() {
+
+    _separate();
+    _write("null", 4);
+
+    return *this;
+
+}
+
+
+void JsonWriter::flush() {
+
+    if(!_sink || _size == 0)
+        return;
+
+    // hand buffer to sink
+    _sink(_buffer, _size);
+    _written += _size;
+    _size = 0;
+
+}
+
+
+const char *JsonWriter::data() const {
+
+    return _buffer;
+
+}
+
+
+unsigned long JsonWriter::size() const {
+
+    return _size;
+
+}
+
+
+unsigned long JsonWriter::written() const {
+
+    return _written + _size;
+
+}
+
+
+bool JsonWriter::good() const {
+
+    return !_overflow;
+
+}
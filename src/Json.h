@@ -0,0 +1,259 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+
+#ifndef STATE_MACHINE_JSON_H
+#define STATE_MACHINE_JSON_H
+
+#include <functional>
+
+#ifndef EMB_JSON_MAX_DEPTH
+#define EMB_JSON_MAX_DEPTH 32
+#endif
+
+namespace emb {
+
+    /** Tokens of the JSON reader */
+    enum class JsonToken : unsigned char {
+        BeginObject, EndObject, BeginArray, EndArray, Key, String, Number, True, False, Null, End, Error
+    };
+
+
+    struct JsonString {
+
+        const char *data;    //!< Pointer into the parsed buffer (not null-terminated, escapes are not resolved)
+        unsigned long size;  //!< Length of the string
+
+
+        /**
+         * Compares the (raw) string with a null-terminated string
+         * @param other String to compare with
+         * @return Flag whether the strings are equal
+         */
+        bool equals(const char *other) const;
+
+
+        /**
+         * @brief Writes the unescaped string into the buffer (null-terminated). Invalid `\u` sequences are copied.
+         * @param buffer Buffer to be written to
+         * @param capacity Size of the buffer
+         * @return Length of the unescaped string (without terminating null), the string is truncated when the buffer
+         * is too small
+         */
+        unsigned long unescape(char *buffer, unsigned long capacity) const;
+
+    };
+
+
+    /**
+     * @brief Pull parser for JSON.
+     * Works directly on the caller's buffer, which must stay valid while the tokens are used. Strings are returned as
+     * views into the buffer. Nothing is allocated.
+     */
+    class JsonReader {
+
+    protected:
+
+        enum class Expect : unsigned char { Value, KeyOrEnd, Key, Colon, ValueOrEnd, CommaOrEnd, Done };
+
+        const char *_data;                        //!< Buffer
+        unsigned long _size;                      //!< Size of the buffer
+        unsigned long _pos = 0;                   //!< Read position
+        char _stack[EMB_JSON_MAX_DEPTH] = {};     //!< Open containers ('{' or '[')
+        unsigned int _depth = 0;                  //!< Number of open containers
+        Expect _expect = Expect::Value;           //!< Expected next element
+        JsonString _string{nullptr, 0};           //!< Last string or key
+        double _number = 0.0;                     //!< Last number
+
+
+        /** Skips white spaces and returns the next character (or 0 at the end) */
+        char _peek();
+
+        /** Sets the expected element after a value */
+        void _valueDone();
+
+        /** Reads a string starting at the current quote */
+        bool _readString();
+
+        /** Reads a number at the current position */
+        bool _readNumber();
+
+        /** Reads a literal (true, false, null) */
+        bool _readLiteral(const char *literal);
+
+    public:
+
+        /**
+         * @brief Creates a reader for the given buffer
+         * @param data The JSON text
+         * @param size Length of the text
+         */
+        JsonReader(const char *data, unsigned long size);
+
+
+        /**
+         * @brief Reads the next token
+         * @return The token (End at the end of the document, Error on invalid input)
+         */
+        JsonToken next();
+
+
+        /**
+         * @brief Skips the value which was started with the given token (nested containers are skipped completely)
+         * @param token The last token returned by next()
+         * @return Flag whether the value could be skipped
+         */
+        bool skip(JsonToken token);
+
+
+        /**
+         * Returns the last key or string
+         * @return String view
+         */
+        const JsonString &string() const;
+
+
+        /**
+         * Returns the last number
+         * @return The number
+         */
+        double number() const;
+
+
+        /**
+         * Returns the number of open containers
+         * @return Depth
+         */
+        unsigned int depth() const;
+
+
+        /**
+         * Returns the read position in the buffer
+         * @return Position
+         */
+        unsigned long position() const;
+
+    };
+
+
+    typedef std::function<void (const char *data, unsigned long size)> JsonSinkCallback; //!< Type definition for the output of the JSON writer
+
+
+    /**
+     * @brief Streaming writer for JSON.
+     * Writes into the caller's buffer. When a sink is given, the buffer is handed to the sink whenever it is full (and
+     * on flush), so arbitrarily large documents can be written with a small buffer. Commas are set automatically.
+     */
+    class JsonWriter {
+
+    protected:
+
+        char *_buffer;                            //!< Output buffer
+        unsigned long _capacity;                  //!< Size of the buffer
+        unsigned long _size = 0;                  //!< Used size of the buffer
+        unsigned long _written = 0;               //!< Number of characters handed to the sink
+        JsonSinkCallback _sink;                   //!< Output sink (optional)
+        bool _overflow = false;                   //!< Flag whether characters got lost
+        bool _first[EMB_JSON_MAX_DEPTH] = {};     //!< Flag per level whether the next element is the first one
+        unsigned int _depth = 0;                  //!< Number of open containers
+        unsigned int _excess = 0;                 //!< Number of open containers beyond the maximum depth
+        bool _excessFirst = false;                //!< First element flag of the levels beyond the maximum depth
+        bool _afterKey = false;                   //!< Flag whether a key was written
+
+
+        /** Writes a single character */
+        void _put(char c);
+
+        /** Writes characters */
+        void _write(const char *data, unsigned long size);
+
+        /** Writes the separator before a value */
+        void _separate();
+
+        /** Writes an escaped and quoted string */
+        void _quoted(const char *data, unsigned long size);
+
+    public:
+
+        /**
+         * @brief Creates a writer
+         * @param buffer Output buffer
+         * @param capacity Size of the buffer
+         * @param sink Output sink (when not set, the document must fit into the buffer)
+         */
+        JsonWriter(char *buffer, unsigned long capacity, JsonSinkCallback &&sink = nullptr);
+
+        JsonWriter &beginObject();
+        JsonWriter &endObject();
+        JsonWriter &beginArray();
+        JsonWriter &endArray();
+        JsonWriter &key(const char *name);
+        JsonWriter &value(const char *text);
+        JsonWriter &value(const char *text, unsigned long size);
+        JsonWriter &value(double number);
+        JsonWriter &value(long number);
+        JsonWriter &value(unsigned long number);
+        JsonWriter &value(int number);
+        JsonWriter &value(unsigned int number);
+        JsonWriter &value(bool flag);
+        JsonWriter &null();
+
+
+        /**
+         * @brief Hands the buffered output to the sink
+         */
+        void flush();
+
+
+        /**
+         * Returns the buffered output
+         * @return Pointer to the buffer
+         */
+        const char *data() const;
+
+
+        /**
+         * Returns the size of the buffered output
+         * @return Number of characters in the buffer
+         */
+        unsigned long size() const;
+
+
+        /**
+         * Returns the total number of characters written (including the characters handed to the sink)
+         * @return Number of characters
+         */
+        unsigned long written() const;
+
+
+        /**
+         * Returns whether all output fitted into the buffer or was handed to the sink
+         * @return Flag
+         */
+        bool good() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_JSON_H
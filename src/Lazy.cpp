@@ -0,0 +1,139 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-08.
+//
+
+#include "Lazy.h"
+
+using namespace emb;
+
+
+void LazyState::build() {
+
+    if(_built)
+        return;
+
+    // transitions added from here on belong to the sub-tree
+    _ownTransitions = _transitions.size();
+    _built = true;
+    _builds++;
+
+    _initial = builder ? builder(this) : nullptr;
+
+}
+
+
+bool LazyState::release() {
+
+    if(!_built || _isActive())
+        return false;
+
+    // forget released states waiting for release themselves
+    _cancelRelease();
+
+    // destroy transitions of the builder and the sub-states
+    while(_transitions.size() > _ownTransitions)
+        _transitions.pop_back();
+
+    _children.clear();
+    _children.shrink_to_fit();
+    _states.clear();
+    _states.shrink_to_fit();
+
+    _currentState = nullptr;
+    _initial = nullptr;
+    _built = false;
+
+    return true;
+
+}
+
+
+bool LazyState::built() const {
+
+    return _built;
+
+}
+
+
+unsigned long LazyState::builds() const {
+
+    return _builds;
+
+}
+
+
+void LazyState::_activate() {
+
+    // build on first entry (also when initialized directly)
+    build();
+    State::_activate();
+
+}
+
+
+void LazyState::_enter(const Transition *transition) {
+
+    State::_enter(transition);
+
+    // enter the initial sub-state when this state is the target
+    if(transition->to == this && _initial != nullptr)
+        _initial->_enter(transition);
+
+}
+
+
+void LazyState::_exit(const Transition *transition) {
+
+    State::_exit(transition);
+
+    // wait for release
+    if(releaseAfter > 0.0 && _built && !_isActive()) {
+
+        _idleSince = Timer::absoluteTime();
+
+        if(!_releasePending) {
+            _releasePending = true;
+            _scheduleRelease();
+        }
+
+    }
+
+}
+
+
+bool LazyState::_release(double now) {
+
+    // entered again (registered again on exit)
+    if(_isActive()) {
+        _releasePending = false;
+        return true;
+    }
+
+    if(now - _idleSince < releaseAfter - 1e-9)
+        return false;
+
+    release();
+    _releasePending = false;
+
+    return true;
+
+}
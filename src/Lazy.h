@@ -0,0 +1,96 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-08.
+//
+
+
+#ifndef STATE_MACHINE_LAZY_H
+#define STATE_MACHINE_LAZY_H
+
+#include <functional>
+#include "State.h"
+
+namespace emb {
+
+    struct LazyState;
+
+    typedef std::function<State *(LazyState *state)> LazyBuilderCallback; //!< Type definition for sub-machine builders
+
+
+    /**
+     * @brief Composite state whose sub-states are created on first entry.
+     * The builder creates the sub-states and their transitions when the state is entered for the first time and
+     * returns the sub-state to be entered (or nullptr). With a release time, the sub-states, their transitions and
+     * the transitions added by the builder to this state are destroyed when the state has been inactive for that
+     * time, and are built again on the next entry. The builder must therefore not add transitions from states
+     * outside the sub-tree into it. Transitions added to this state before the first entry are kept.
+     */
+    struct LazyState : public State {
+
+        LazyBuilderCallback builder{};   //!< Creates the sub-states and transitions (called on entry when not built)
+        double releaseAfter = 0.0;       //!< Idle time in seconds after which the sub-states are released (0 keeps them)
+
+
+        /**
+         * @brief Builds the sub-states now (e.g. to avoid the delay on first entry)
+         */
+        void build();
+
+
+        /**
+         * @brief Destroys the sub-states (only when the state is inactive)
+         * @return Flag whether the sub-states were released
+         */
+        bool release();
+
+
+        /**
+         * Returns whether the sub-states are built
+         * @return Flag
+         */
+        bool built() const;
+
+
+        /**
+         * Returns the number of builds (including rebuilds after a release)
+         * @return Number of builds
+         */
+        unsigned long builds() const;
+
+    protected:
+
+        bool _built = false;             //!< Flag whether the sub-states are built
+        State *_initial = nullptr;       //!< Sub-state entered when the state itself is the target of a transition
+        unsigned long _ownTransitions = 0; //!< Number of transitions of this state before the build
+        unsigned long _builds = 0;       //!< Number of builds
+        double _idleSince = 0.0;         //!< Absolute time at which the state was left
+        bool _releasePending = false;    //!< Flag whether the state is registered for release at the root
+
+        void _activate() override;
+        void _enter(const Transition *transition) override;
+        void _exit(const Transition *transition) override;
+        bool _release(double now) override;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_LAZY_H
@@ -0,0 +1,69 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-31.
+//
+
+#include "Monitor.h"
+#include "State.h"
+
+using namespace emb;
+
+
+bool StateMonitor::rebind(const State &, const State &) {
+
+    // the snapshot is rewritten by the next publication
+    return true;
+
+}
+
+
+void StateMonitor::publish(const State &machine) {
+
+    StateSnapshot snapshot{};
+
+    // active path
+    const State *state = &machine;
+    while(state->currentState() != nullptr && snapshot.depth < EMB_SNAPSHOT_DEPTH) {
+        state = state->currentState();
+        snapshot.path[snapshot.depth++] = state;
+    }
+
+    snapshot.transitions = machine.getTransitionCount();
+    snapshot.time = state->getTime();
+    snapshot.stamp = Timer::absoluteTime();
+
+    _snapshot.write(snapshot);
+
+}
+
+
+unsigned long StateMonitor::read(StateSnapshot &snapshot) const {
+
+    return _snapshot.read(snapshot) / 2;
+
+}
+
+
+bool StateMonitor::tryRead(StateSnapshot &snapshot) const {
+
+    return _snapshot.tryRead(snapshot);
+
+}
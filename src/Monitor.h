@@ -0,0 +1,110 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-31.
+//
+
+
+#ifndef STATE_MACHINE_MONITOR_H
+#define STATE_MACHINE_MONITOR_H
+
+#include "Config.h"
+#include "Seqlock.h"
+
+#ifndef EMB_SNAPSHOT_DEPTH
+#define EMB_SNAPSHOT_DEPTH 8   //!< Maximum depth of the active path in a snapshot
+#endif
+
+namespace emb {
+
+    struct State;   //!< Pre-definition of type state
+
+    struct StateSnapshot {
+
+        const State *path[EMB_SNAPSHOT_DEPTH];  //!< Active states from the first sub-state of the root downwards
+        unsigned int depth;                     //!< Number of states in the path
+        unsigned long transitions;              //!< Number of transitions taken by the machine
+        double time;                            //!< Time of the innermost active state in seconds
+        double stamp;                           //!< Absolute time of the publication
+
+    };
+
+
+    /**
+     * @brief Consistent snapshot of a running machine for monitoring threads.
+     * The machine publishes the snapshot after every step (and after initialization) when the monitor is set with
+     * State::setMonitor. Readers never block the stepping thread, they retry when a publication interferes.
+     */
+    class StateMonitor {
+
+    protected:
+
+        Seqlock<StateSnapshot> _snapshot{};   //!< Published snapshot
+
+    public:
+
+        virtual ~StateMonitor() = default;
+
+#ifdef EMB_EMBEDDED
+
+        /** Monitors are not deleted through the heap, the deleting destructor doesn't refer to it */
+        static void operator delete(void *) { EMB_HEAP_USED(); }
+
+#endif
+
+
+        /**
+         * @brief Publishes the snapshot of the machine (called by the stepping thread).
+         * Can be overridden to publish the status elsewhere (e.g. into shared memory).
+         * @param machine Root state
+         */
+        virtual void publish(const State &machine);
+
+
+        /**
+         * @brief Moves the monitor to a new definition of the machine (see HotSwap, called by the stepping thread).
+         * Monitors referring to the states of the machine re-index them.
+         * @param from Replaced root state (still valid during the call)
+         * @param to Root state of the new definition
+         * @return Flag whether the monitor follows the new machine (otherwise it is detached)
+         */
+        virtual bool rebind(const State &from, const State &to);
+
+
+        /**
+         * @brief Reads the latest snapshot
+         * @param snapshot Snapshot to be written to
+         * @return Number of publications so far
+         */
+        unsigned long read(StateSnapshot &snapshot) const;
+
+
+        /**
+         * @brief Tries once to read the latest snapshot
+         * @param snapshot Snapshot to be written to
+         * @return Flag whether the snapshot is consistent
+         */
+        bool tryRead(StateSnapshot &snapshot) const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_MONITOR_H
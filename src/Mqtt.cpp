@@ -0,0 +1,132 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-23.
+//
+
+#include "Mqtt.h"
+
+using namespace emb;
+
+
+MqttBridge::MqttBridge(Bus &bus, MqttClient &client) : _bus(&bus), _client(&client) {
+
+    // publish received messages on the bus (tagged with the bridge as origin)
+    _client->onMessage = [this](const std::string &topic, const char *data, unsigned long size) {
+
+        _bus->publish(topic.c_str(), data, size, this);
+
+    };
+
+}
+
+
+MqttBridge::~MqttBridge() {
+
+    // remove subscriptions and callback
+    for(auto id : _subscriptions)
+        _bus->unsubscribe(id);
+
+    _client->onMessage = nullptr;
+
+}
+
+
+bool MqttBridge::exportTopics(const std::string &filter) {
+
+    auto id = _bus->subscribeMessages(filter, [this](const BusMessage &message) {
+
+        // don't send messages back to the broker
+        if(message.origin == this)
+            return;
+
+        _client->publish(message.topic, message.data.data(), message.data.size());
+
+    });
+
+    if(id == 0)
+        return false;
+
+    _subscriptions.push_back(id);
+    return true;
+
+}
+
+
+bool MqttBridge::importTopics(const std::string &filter) {
+
+    return _client->subscribe(filter);
+
+}
+
+
+bool LocalBroker::Client::publish(const std::string &topic, const char *data, unsigned long size) {
+
+    broker->_messages++;
+
+    // deliver to all matching clients (by index, callbacks may connect clients and add filters)
+    auto clients = broker->_clients.size();
+    for(unsigned long i = 0; i < clients; ++i) {
+
+        auto c = broker->_clients[i].get();
+        auto filters = c->filters.size();
+        for(unsigned long j = 0; j < filters; ++j) {
+
+            if(Bus::matches(c->filters[j], topic)) {
+
+                if(c->onMessage)
+                    c->onMessage(topic, data, size);
+
+                break;
+
+            }
+
+        }
+
+    }
+
+    return true;
+
+}
+
+
+bool LocalBroker::Client::subscribe(const std::string &filter) {
+
+    filters.push_back(filter);
+    return true;
+
+}
+
+
+LocalBroker::Client *LocalBroker::connect() {
+
+    _clients.emplace_back(new Client);
+    _clients.back()->broker = this;
+
+    return _clients.back().get();
+
+}
+
+
+unsigned long LocalBroker::messages() const {
+
+    return _messages;
+
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-23.
+//
+
+
+#ifndef STATE_MACHINE_MQTT_H
+#define STATE_MACHINE_MQTT_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Bus.h"
+
+namespace emb {
+
+    typedef std::function<void (const std::string &topic, const char *data, unsigned long size)> MqttMessageCallback; //!< Type definition for received MQTT messages
+
+
+    /**
+     * @brief Minimal interface of an MQTT client.
+     * Implement this for the client library of the platform to bridge a Bus to a broker.
+     */
+    struct MqttClient {
+
+        MqttMessageCallback onMessage{}; //!< Callback to be called for received messages
+
+
+        virtual ~MqttClient() = default;
+
+
+        /**
+         * @brief Publishes a message to the broker
+         * @param topic Topic
+         * @param data Content
+         * @param size Size of the content
+         * @return Flag whether the message was sent
+         */
+        virtual bool publish(const std::string &topic, const char *data, unsigned long size) = 0;
+
+
+        /**
+         * @brief Subscribes to a topic filter at the broker
+         * @param filter Topic filter
+         * @return Flag whether the subscription was sent
+         */
+        virtual bool subscribe(const std::string &filter) = 0;
+
+    };
+
+
+    /**
+     * @brief Connects a bus with an MQTT client.
+     * Local messages of exported filters are published to the broker, messages of imported filters are published on
+     * the bus. Messages received from the broker are not exported again.
+     */
+    class MqttBridge {
+
+    protected:
+
+        Bus *_bus;                          //!< The local bus
+        MqttClient *_client;                //!< The client
+        std::vector<unsigned long> _subscriptions{}; //!< Subscriptions on the bus
+
+    public:
+
+        MqttBridge(Bus &bus, MqttClient &client);
+        ~MqttBridge();
+
+        MqttBridge(const MqttBridge &) = delete;
+        MqttBridge &operator=(const MqttBridge &) = delete;
+
+
+        /**
+         * @brief Publishes local data messages matching the filter to the broker. Other payloads are skipped.
+         * @param filter Topic filter
+         * @return Flag whether the filter is valid
+         */
+        bool exportTopics(const std::string &filter);
+
+
+        /**
+         * @brief Publishes messages of the broker matching the filter on the bus
+         * @param filter Topic filter
+         * @return Flag whether the subscription was sent
+         */
+        bool importTopics(const std::string &filter);
+
+    };
+
+
+    /**
+     * @brief In-memory stand-in for an MQTT broker (e.g. for tests).
+     * Clients created by the broker deliver their messages to all clients with a matching subscription.
+     */
+    class LocalBroker {
+
+    public:
+
+        struct Client : public MqttClient {
+
+            LocalBroker *broker = nullptr;        //!< The broker
+            std::vector<std::string> filters{};   //!< Subscribed filters
+
+            bool publish(const std::string &topic, const char *data, unsigned long size) override;
+            bool subscribe(const std::string &filter) override;
+
+        };
+
+
+        /**
+         * @brief Creates a client connected to the broker
+         * @return The client (owned by the broker)
+         */
+        Client *connect();
+
+
+        /**
+         * Returns the number of messages routed by the broker
+         * @return Number of messages
+         */
+        unsigned long messages() const;
+
+    protected:
+
+        std::vector<std::unique_ptr<Client>> _clients{}; //!< Connected clients
+        unsigned long _messages = 0;                      //!< Number of routed messages
+
+    };
+
+}
+
+#endif // STATE_MACHINE_MQTT_H
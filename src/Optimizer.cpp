@@ -0,0 +1,429 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-22.
+//
+
+#include <algorithm>
+#include <typeinfo>
+#include "Guard.h"
+#include "Optimizer.h"
+
+using namespace emb;
+
+
+namespace {
+
+    // a guard reading no signal, parameter, time or event has always the same value
+    bool constant(const Guard &guard) {
+
+        return guard.valid() && !guard.uses(GuardOp::Signal) && !guard.uses(GuardOp::Parameter)
+                && !guard.uses(GuardOp::Time) && !guard.uses(GuardOp::Event);
+
+    }
+
+
+    bool truth(const Guard &guard) {
+
+        auto v = guard.value(0.0, nullptr);
+        return v != 0.0 && v == v;
+
+    }
+
+
+    bool unconditional(const Transition *transition) {
+
+        return transition->after <= 0.0 && transition->guard && constant(*transition->guard)
+                && truth(*transition->guard);
+
+    }
+
+
+    bool dead(const Transition *transition) {
+
+        return transition->guard && constant(*transition->guard) && !truth(*transition->guard);
+
+    }
+
+
+    // whether the earlier transition is always taken when the later one would be
+    bool shadows(const Transition *earlier, const Transition *later) {
+
+        if(unconditional(earlier))
+            return true;
+
+        // timeouts of the same state timer
+        if(!earlier->guard && !later->guard && earlier->after > 0.0 && later->after > 0.0)
+            return earlier->after <= later->after;
+
+        return earlier->guard && later->guard && earlier->after == later->after
+                && earlier->guard->identical(*later->guard);
+
+    }
+
+}
+
+
+GraphOptimizer::GraphOptimizer(State *machine) : _machine(machine) {
+
+}
+
+
+void GraphOptimizer::addInitial(const State *state) {
+
+    _initial.push_back(state);
+
+}
+
+
+unsigned long GraphOptimizer::analyze() {
+
+    _analyze();
+    _mapping.clear();
+
+    return _findings.size();
+
+}
+
+
+unsigned long GraphOptimizer::optimize() {
+
+    _analyze();
+
+    // target of each state in the optimized machine (nullptr if removed)
+    std::vector<const State *> targets(_states.size(), nullptr);
+    for(unsigned long i = 0; i < _states.size(); ++i) {
+
+        auto target = _resolve(_states[i]);
+        if(_reachable[_ids[target]])
+            targets[i] = target;
+
+    }
+
+    auto original = _paths;
+
+    // remove transitions which are never taken
+    for(unsigned long k = 0; k < _states.size(); ++k) {
+
+        auto state = _states[k];
+        auto &keep = _keep[k];
+        if(std::find(keep.begin(), keep.end(), false) == keep.end())
+            continue;
+
+        // new indices of the kept transitions
+        std::vector<long> indices(keep.size(), -1);
+        TransitionVector transitions{};
+        for(unsigned long i = 0; i < keep.size(); ++i) {
+
+            if(keep[i]) {
+                indices[i] = (long) transitions.size();
+                transitions.push_back(std::move(state->_transitions[i]));
+            }
+
+        }
+
+        state->_transitions = std::move(transitions);
+
+        // keep the evaluation order and the statistics of the remaining transitions
+        if(!state->_evaluationOrder.empty() || !state->_statistics.empty()) {
+
+            std::vector<unsigned int> order{};
+            for(auto i : state->_evaluationOrder) {
+                if(i < indices.size() && indices[i] >= 0)
+                    order.push_back((unsigned int) indices[i]);
+            }
+
+            std::vector<TransitionStatistics> statistics{};
+            for(unsigned long i = 0; i < state->_statistics.size() && i < keep.size(); ++i) {
+                if(keep[i])
+                    statistics.push_back(state->_statistics[i]);
+            }
+
+            state->_evaluationOrder = std::move(order);
+            state->_statistics = std::move(statistics);
+            state->_updateOrder();
+
+        }
+
+    }
+
+    // redirect transitions into folded states
+    for(auto state : _states) {
+
+        for(auto &t : state->_transitions)
+            t->to = _resolve(t->to);
+
+    }
+
+    // unreachable states below reachable ones (their sub-states are removed with them)
+    std::vector<State *> removed{};
+    for(unsigned long k = 1; k < _states.size(); ++k) {
+
+        if(!_reachable[k] && _reachable[_ids[_states[k]->_parent]])
+            removed.push_back(_states[k]);
+
+    }
+
+    auto &idle = _machine->_idleStates;
+    for(auto state : removed) {
+
+        auto parent = state->_parent;
+
+        // forget registrations for releasing resources
+        state->_cancelRelease();
+        std::replace(idle.begin(), idle.end(), state, (State *) nullptr);
+
+        parent->_children.erase(std::find(parent->_children.begin(), parent->_children.end(), state));
+
+        auto owner = std::find_if(parent->_states.begin(), parent->_states.end(),
+                                  [state](const std::unique_ptr<State> &s) { return s.get() == state; });
+
+        if(owner != parent->_states.end())
+            parent->_states.erase(owner);
+        else
+            state->_parent = nullptr;
+
+    }
+
+    // paths in the optimized machine
+    _index();
+
+    _mapping.clear();
+    for(unsigned long i = 0; i < original.size(); ++i)
+        _mapping.push_back(GraphMapping{original[i], targets[i] != nullptr ? path(targets[i]) : std::string()});
+
+    return _findings.size();
+
+}
+
+
+const std::vector<GraphFinding> &GraphOptimizer::findings() const {
+
+    return _findings;
+
+}
+
+
+const std::vector<GraphMapping> &GraphOptimizer::mapping() const {
+
+    return _mapping;
+
+}
+
+
+std::string GraphOptimizer::path(const State *state) const {
+
+    auto it = _ids.find(state);
+    return it != _ids.end() ? _paths[it->second] : std::string();
+
+}
+
+
+void GraphOptimizer::_index() {
+
+    _states.clear();
+    _ids.clear();
+    _paths.clear();
+
+    // depth-first pre-order
+    std::vector<State *> stack{_machine};
+    while(!stack.empty()) {
+
+        auto state = stack.back();
+        stack.pop_back();
+
+        auto id = _states.size();
+        _ids[state] = id;
+        _states.push_back(state);
+
+        auto name = state->name.empty() ? "#" + std::to_string(id) : state->name;
+        if(state == _machine)
+            _paths.push_back(name);
+        else if(state->_parent == _machine)
+            _paths.push_back(name);
+        else
+            _paths.push_back(_paths[_ids[state->_parent]] + "." + name);
+
+        auto &children = state->getChildren();
+        for(auto it = children.rbegin(); it != children.rend(); ++it)
+            stack.push_back(*it);
+
+    }
+
+}
+
+
+void GraphOptimizer::_analyze() {
+
+    _index();
+    _findings.clear();
+    _folds.clear();
+    _keep.assign(_states.size(), std::vector<bool>{});
+
+    // transitions which are never taken
+    for(unsigned long k = 0; k < _states.size(); ++k) {
+
+        auto &transitions = _states[k]->_transitions;
+        auto &keep = _keep[k];
+        keep.assign(transitions.size(), true);
+
+        for(unsigned long i = 0; i < transitions.size(); ++i) {
+
+            auto t = transitions[i].get();
+
+            if(dead(t)) {
+                keep[i] = false;
+                _findings.push_back(GraphFinding{GraphFindingType::Dead, _paths[k], (long) i, -1, path(t->to)});
+                continue;
+            }
+
+            // the order of mutually exclusive transitions changes
+            if(_states[k]->_order != TransitionOrder::Priority)
+                continue;
+
+            for(unsigned long j = 0; j < i; ++j) {
+
+                auto earlier = transitions[j].get();
+                if(!keep[j] || !shadows(earlier, t))
+                    continue;
+
+                auto duplicate = earlier->to == t->to && earlier->guard && t->guard
+                        && earlier->guard->identical(*t->guard);
+
+                keep[i] = false;
+                _findings.push_back(GraphFinding{duplicate ? GraphFindingType::Duplicate : GraphFindingType::Shadowed,
+                                                 _paths[k], (long) i, (long) j, path(t->to)});
+                break;
+
+            }
+
+        }
+
+    }
+
+    // pass-through states: leaves without callbacks, left unconditionally to a sibling
+    for(unsigned long k = 1; k < _states.size(); ++k) {
+
+        auto state = _states[k];
+        if(!state->_children.empty() || state->onEnter || state->onLeave || state->onStep
+                || typeid(*state) != typeid(State) || state->_isActive()
+                || std::find(_initial.begin(), _initial.end(), state) != _initial.end())
+            continue;
+
+        auto &keep = _keep[k];
+        auto first = std::find(keep.begin(), keep.end(), true) - keep.begin();
+        if(first == (long) keep.size())
+            continue;
+
+        auto t = state->_transitions[first].get();
+        if(unconditional(t) && t->to != state && t->to->_parent == state->_parent && _ids.count(t->to) > 0)
+            _folds[state] = t->to;
+
+    }
+
+    // cycles of pass-through states are kept
+    std::vector<const State *> cycles{};
+    for(auto &f : _folds) {
+
+        auto state = f.second;
+        for(unsigned long n = 0; n < _folds.size() && state != f.first; ++n) {
+            auto next = _folds.find(state);
+            if(next == _folds.end())
+                break;
+            state = next->second;
+        }
+
+        if(state == f.first)
+            cycles.push_back(f.first);
+
+    }
+
+    for(auto state : cycles)
+        _folds.erase(state);
+
+    for(unsigned long k = 1; k < _states.size(); ++k) {
+
+        if(_folds.count(_states[k]) > 0)
+            _findings.push_back(GraphFinding{GraphFindingType::Folded, _paths[k], -1, -1,
+                                             path(_resolve(_states[k]))});
+
+    }
+
+    // reachable states from the initial (or active) states
+    std::vector<const State *> queue{_initial};
+    if(queue.empty() && _machine->_currentState != nullptr) {
+        for(const State *s = _machine; s != nullptr; s = s->_currentState)
+            queue.push_back(s);
+    }
+
+    // without initial states, all states are considered reachable
+    _reachable.assign(_states.size(), queue.empty());
+
+    while(!queue.empty()) {
+
+        auto state = queue.back();
+        queue.pop_back();
+
+        auto id = _ids.find(state);
+        if(id == _ids.end() || _reachable[id->second])
+            continue;
+
+        _reachable[id->second] = true;
+
+        // the parent is active as well, the kept transitions can be taken
+        if(state->_parent != nullptr)
+            queue.push_back(state->_parent);
+
+        auto &keep = _keep[id->second];
+        for(unsigned long i = 0; i < keep.size(); ++i) {
+            if(keep[i])
+                queue.push_back(_resolve(state->_transitions[i]->to));
+        }
+
+    }
+
+    _reachable[0] = true;
+
+    for(unsigned long k = 1; k < _states.size(); ++k) {
+
+        if(!_reachable[k] && _folds.count(_states[k]) == 0)
+            _findings.push_back(GraphFinding{GraphFindingType::Unreachable, _paths[k], -1, -1, std::string()});
+
+    }
+
+}
+
+
+State *GraphOptimizer::_resolve(State *state) const {
+
+    // follow chains of folded states
+    for(unsigned long n = 0; n <= _folds.size(); ++n) {
+
+        auto next = _folds.find(state);
+        if(next == _folds.end())
+            break;
+
+        state = next->second;
+
+    }
+
+    return state;
+
+}
@@ -0,0 +1,163 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-22.
+//
+
+
+#ifndef STATE_MACHINE_OPTIMIZER_H
+#define STATE_MACHINE_OPTIMIZER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    /** Type of an optimizer finding */
+    enum class GraphFindingType : unsigned char {
+        Unreachable,   //!< State which is never entered from the initial states
+        Dead,          //!< Transition with a guard which is constantly false
+        Shadowed,      //!< Transition never taken, an earlier transition of the state is always taken first
+        Duplicate,     //!< Shadowed transition with an identical guard to the same target
+        Folded         //!< Pass-through state left unconditionally in the step after its entry
+    };
+
+
+    /**
+     * @brief Finding of the graph optimizer
+     */
+    struct GraphFinding {
+
+        GraphFindingType type;    //!< Type of the finding
+        std::string state;        //!< Path of the state (source state for transitions)
+        long transition;          //!< Index of the transition in the source state (-1 for states)
+        long related;             //!< Index of the shadowing transition (-1 otherwise)
+        std::string target;       //!< Path of the target state (of the transition or the folded state)
+
+    };
+
+
+    /**
+     * @brief Path of a state before and after the optimization
+     */
+    struct GraphMapping {
+
+        std::string original;     //!< Path of the state before the optimization
+        std::string optimized;    //!< Path of the state (or of the state it was folded into) after the optimization, empty if removed
+
+    };
+
+
+    /**
+     * @brief Analysis and optimization of the graph of a machine.
+     * The pass reports (and optimize() removes) transitions which can never be taken: guards which are constantly
+     * false, and transitions shadowed in priority order by an earlier transition which is always taken first (an
+     * unconditional guard, an identical guard or an earlier timeout). Leaf states without callbacks which are left
+     * by an unconditional transition to a sibling are folded: transitions into them are redirected to their target,
+     * which saves a step of latency. States not reachable from the initial states (by default the active states of
+     * the initialized machine) are removed together with their sub-states.
+     * States are named by their path of names below the root (unnamed states by `#` and their depth-first pre-order
+     * index, root 0). Only declarative guards and timed transitions are analysed, callback conditions are opaque.
+     * The machine must not be stepped during the optimization, and it should be optimized before it is registered
+     * elsewhere (e.g. monitors, recorders, publishers index the states).
+     */
+    class GraphOptimizer {
+
+    protected:
+
+        State *_machine = nullptr;                              //!< Root state
+        std::vector<const State *> _initial{};                  //!< Initial states
+        std::vector<State *> _states{};                         //!< States in pre-order
+        std::unordered_map<const State *, unsigned long> _ids{}; //!< Index of each state in pre-order
+        std::vector<std::string> _paths{};                      //!< Path of each state
+        std::unordered_map<const State *, State *> _folds{};    //!< Folded states and their targets
+        std::vector<std::vector<bool>> _keep{};                 //!< Flags per state and transition whether it can be taken
+        std::vector<bool> _reachable{};                         //!< Flag per state whether it is reachable
+        std::vector<GraphFinding> _findings{};                  //!< Findings of the last pass
+        std::vector<GraphMapping> _mapping{};                   //!< Mapping of the last optimization
+
+
+        /** Collects the states in pre-order and their paths */
+        void _index();
+
+        /** Analyses the machine */
+        void _analyze();
+
+        /** Returns the state a folded state is replaced by (the state itself if not folded) */
+        State *_resolve(State *state) const;
+
+    public:
+
+        /**
+         * @brief Creates the optimizer
+         * @param machine Root state of the machine
+         */
+        explicit GraphOptimizer(State *machine);
+
+
+        /**
+         * @brief Adds an initial state (replaces the active states as starting points of the reachability analysis)
+         * @param state State which is entered initially (e.g. with initialize())
+         */
+        void addInitial(const State *state);
+
+
+        /**
+         * @brief Analyses the machine without changing it
+         * @return Number of findings
+         */
+        unsigned long analyze();
+
+
+        /**
+         * @brief Analyses the machine and applies the findings
+         * @return Number of findings
+         */
+        unsigned long optimize();
+
+
+        /**
+         * Returns the findings of the last analysis
+         * @return Findings
+         */
+        const std::vector<GraphFinding> &findings() const;
+
+
+        /**
+         * Returns the mapping of the original state paths to the optimized machine (after optimize())
+         * @return Mapping
+         */
+        const std::vector<GraphMapping> &mapping() const;
+
+
+        /**
+         * Returns the path of a state of the machine as named in the findings
+         * @param state State
+         * @return Path (empty if the state is not part of the machine)
+         */
+        std::string path(const State *state) const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_OPTIMIZER_H
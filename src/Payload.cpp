@@ -0,0 +1,154 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-14.
+//
+
+#include <algorithm>
+#include "Payload.h"
+
+using namespace emb;
+
+
+namespace {
+
+    // spin lock on the free lists (only held for a few instructions)
+    class SpinLock {
+
+        std::atomic_flag &_flag;
+
+    public:
+
+        explicit SpinLock(std::atomic_flag &flag) : _flag(flag) {
+
+            while(_flag.test_and_set(std::memory_order_acquire));
+
+        }
+
+
+        ~SpinLock() {
+
+            _flag.clear(std::memory_order_release);
+
+        }
+
+    };
+
+}
+
+
+PayloadPool::PayloadPool(std::initializer_list<PayloadClass> classes) {
+
+    const auto alignment = (unsigned long) alignof(std::max_align_t);
+
+    // sort by size, round up to the alignment
+    std::vector<PayloadClass> sorted(classes);
+    std::sort(sorted.begin(), sorted.end(), [](const PayloadClass &a, const PayloadClass &b) {
+        return a.size < b.size;
+    });
+
+    unsigned long total = 0;
+    for(auto &c : sorted) {
+        c.size = (c.size + alignment - 1) / alignment * alignment;
+        total += c.size * c.count;
+    }
+
+    // allocate all blocks at once
+    _memory.reset(new std::max_align_t[total / sizeof(std::max_align_t) + 1]);
+    auto memory = reinterpret_cast<unsigned char *>(_memory.get());
+
+    for(auto &c : sorted) {
+
+        SizeClass sizeClass{c.size, memory, memory + c.size * c.count, {}};
+        sizeClass.free.reserve(c.count);
+
+        // the lowest block on top of the stack
+        for(auto i = c.count; i > 0; --i)
+            sizeClass.free.push_back(memory + (i - 1) * c.size);
+
+        memory += c.size * c.count;
+        _classes.push_back(std::move(sizeClass));
+
+    }
+
+}
+
+
+void *PayloadPool::allocate(unsigned long size) {
+
+    SpinLock lock(_lock);
+
+    // smallest class with a free block
+    for(auto &c : _classes) {
+
+        if(c.size >= size && !c.free.empty()) {
+
+            auto memory = c.free.back();
+            c.free.pop_back();
+            return memory;
+
+        }
+
+    }
+
+    _exhausted++;
+    return nullptr;
+
+}
+
+
+void PayloadPool::release(void *memory) {
+
+    SpinLock lock(_lock);
+
+    // find the class by address
+    auto block = static_cast<unsigned char *>(memory);
+    for(auto &c : _classes) {
+
+        if(block >= c.begin && block < c.end) {
+            c.free.push_back(memory);
+            return;
+        }
+
+    }
+
+}
+
+
+unsigned long PayloadPool::available(unsigned long size) {
+
+    SpinLock lock(_lock);
+
+    unsigned long count = 0;
+    for(auto &c : _classes) {
+        if(c.size >= size)
+            count += (unsigned long) c.free.size();
+    }
+
+    return count;
+
+}
+
+
+unsigned long PayloadPool::exhausted() const {
+
+    return _exhausted;
+
+}
@@ -0,0 +1,275 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-14.
+//
+
+
+#ifndef STATE_MACHINE_PAYLOAD_H
+#define STATE_MACHINE_PAYLOAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Event.h"
+#include "State.h"
+
+namespace emb {
+
+    struct PayloadClass {
+
+        unsigned long size;     //!< Size of the blocks in bytes
+        unsigned long count;    //!< Number of blocks
+
+    };
+
+
+    /**
+     * @brief Preallocated memory for event payloads, divided into size classes.
+     * All blocks are allocated on construction. A payload takes a block of the smallest free class it fits into.
+     * Payloads are created in place with make() and shared between the producer, the event queue and the consumers
+     * without copies. The block is returned to the pool when the last reference is dropped, i.e. by the machine in
+     * the step after the event was dispatched. Allocating and releasing is protected by a spin lock, so payloads may be
+     * created and dropped on other threads. The event queue is not thread-safe: payloads of other threads must be
+     * handed over to the machine's thread and posted there (as WorkerPool::deliver() does). The pool must outlive all
+     * machines holding its payloads.
+     */
+    class PayloadPool {
+
+    protected:
+
+        struct SizeClass {
+            unsigned long size;              //!< Size of the blocks
+            unsigned char *begin;            //!< First block
+            unsigned char *end;              //!< End of the blocks
+            std::vector<void *> free;        //!< Free blocks (stack, reserved for all blocks)
+        };
+
+        std::unique_ptr<std::max_align_t[]> _memory{};  //!< Memory of all blocks
+        std::vector<SizeClass> _classes{};              //!< Size classes (ascending)
+        std::atomic_flag _lock = ATOMIC_FLAG_INIT;      //!< Protects the free lists
+        unsigned long _exhausted = 0;                   //!< Number of failed allocations
+
+    public:
+
+        /**
+         * @brief Allocates the blocks
+         * @param classes Size classes, e.g. {{64, 32}, {512, 16}} (sizes are rounded up to the maximum alignment)
+         */
+        explicit PayloadPool(std::initializer_list<PayloadClass> classes);
+
+        PayloadPool(const PayloadPool &) = delete;
+        PayloadPool &operator=(const PayloadPool &) = delete;
+
+
+        /**
+         * @brief Takes a block of the smallest free class the size fits into
+         * @param size Size in bytes
+         * @return The block (nullptr when no block is free)
+         */
+        void *allocate(unsigned long size);
+
+
+        /**
+         * @brief Returns a block to the pool
+         * @param memory Block taken by allocate()
+         */
+        void release(void *memory);
+
+
+        /**
+         * @brief Returns the number of free blocks which can take the given size
+         * @param size Size in bytes
+         * @return Number of free blocks
+         */
+        unsigned long available(unsigned long size);
+
+
+        /**
+         * @brief Returns the number of allocations which failed because no block was free
+         * @return Number of failed allocations
+         */
+        unsigned long exhausted() const;
+
+
+        /**
+         * @brief Creates a payload in a block of the pool (the reference counter is stored in the same block)
+         * @param args Arguments of the constructor of T
+         * @return The payload (empty when no block is free)
+         */
+        template<typename T, typename... Args>
+        EventPayload make(Args &&... args);
+
+    };
+
+
+    /**
+     * @brief Allocator taking its memory from a payload pool (used with std::allocate_shared)
+     */
+    template<typename T>
+    struct PayloadAllocator {
+
+        typedef T value_type;
+
+        PayloadPool *pool;   //!< The pool
+
+
+        explicit PayloadAllocator(PayloadPool *pool) : pool(pool) {}
+
+        template<typename U>
+        PayloadAllocator(const PayloadAllocator<U> &other) : pool(other.pool) {}
+
+
+        T *allocate(std::size_t n) {
+
+            auto memory = pool->allocate((unsigned long) (n * sizeof(T)));
+            if(memory == nullptr)
+                throw std::bad_alloc();
+
+            return static_cast<T *>(memory);
+
+        }
+
+
+        void deallocate(T *memory, std::size_t) {
+
+            pool->release(memory);
+
+        }
+
+    };
+
+
+    template<typename T, typename U>
+    bool operator==(const PayloadAllocator<T> &a, const PayloadAllocator<U> &b) { return a.pool == b.pool; }
+
+    template<typename T, typename U>
+    bool operator!=(const PayloadAllocator<T> &a, const PayloadAllocator<U> &b) { return a.pool != b.pool; }
+
+
+    template<typename T, typename... Args>
+    EventPayload PayloadPool::make(Args &&... args) {
+
+        try {
+            return std::allocate_shared<T>(PayloadAllocator<T>(this), std::forward<Args>(args)...);
+        } catch(const std::bad_alloc &) {
+            return nullptr;
+        }
+
+    }
+
+
+    /**
+     * @brief Binds an event id to a payload type.
+     * Typed events are posted with a payload constructed in place in a payload pool. Guards and entry callbacks
+     * receive the payload by reference, e.g.
+     * `frame.addTransition(idle, [](const SensorFrame &f) { return f.level > 80; }, alarm);`.
+     */
+    template<typename T>
+    struct EventType {
+
+        unsigned int id;     //!< Identifier of the event
+
+
+        /**
+         * @brief Creates the payload in the pool and posts the event to the machine
+         * @param machine State machine (or any of its states)
+         * @param pool Payload pool
+         * @param args Arguments of the constructor of T
+         * @return Flag whether a block was free and the event could be queued
+         */
+        template<typename... Args>
+        bool post(State *machine, PayloadPool &pool, Args &&... args) const {
+
+            auto payload = pool.template make<T>(std::forward<Args>(args)...);
+            return payload && machine->post(Event{id, std::move(payload)});
+
+        }
+
+
+        /**
+         * @brief Returns the payload of the event if it is of this type
+         * @param event Event (or nullptr)
+         * @return The payload (or nullptr)
+         */
+        const T *payload(const Event *event) const {
+
+            return event != nullptr && event->id == id ? static_cast<const T *>(event->payload.get()) : nullptr;
+
+        }
+
+
+        /**
+         * @brief Returns the payload of the current event of the machine if it is of this type
+         * @param state Any state of the machine
+         * @return The payload (or nullptr)
+         */
+        const T *current(const State *state) const {
+
+            return payload(state->currentEvent());
+
+        }
+
+
+        /**
+         * @brief Adds a transition which is followed when an event of this type is present and the guard is fulfilled
+         * @param state Source state
+         * @param guard Guard receiving the payload, e.g. `[](const T &payload) { return true; }`
+         * @param targetState Target state to be reached
+         */
+        template<typename G>
+        void addTransition(State *state, G guard, State *targetState) const {
+
+            auto type = *this;
+            state->addTransition([type, guard](const Transition *transition) {
+                auto payload = type.current(transition->from);
+                return payload != nullptr && guard(*payload);
+            }, targetState);
+
+        }
+
+
+        /**
+         * @brief Creates an entry or exit callback which is called with the payload when an event of this type is
+         * present
+         * @param callback Callback, e.g. `[](const Transition *transition, const T &payload) {}`
+         * @return Callback for State::onEnter or State::onLeave
+         */
+        template<typename C>
+        StateInterfaceCallback callback(C callback) const {
+
+            auto type = *this;
+            return [type, callback](const Transition *transition) {
+                auto payload = type.current(transition->from);
+                if(payload != nullptr)
+                    callback(transition, *payload);
+            };
+
+        }
+
+    };
+
+}
+
+#endif // STATE_MACHINE_PAYLOAD_H
@@ -0,0 +1,249 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-19.
+//
+
+#include <cmath>
+#include <limits>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "Reactor.h"
+
+using namespace emb;
+
+
+Reactor::Reactor() {
+
+    // create epoll instance and timer
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    // wait for the timer
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = _timer;
+    if(_epoll >= 0 && _timer >= 0 && epoll_ctl(_epoll, EPOLL_CTL_ADD, _timer, &ev) == 0)
+        return;
+
+    // failed (see good())
+    if(_timer >= 0)
+        close(_timer);
+    if(_epoll >= 0)
+        close(_epoll);
+
+    _timer = -1;
+    _epoll = -1;
+
+}
+
+
+Reactor::~Reactor() {
+
+    if(!good())
+        return;
+
+    close(_timer);
+    close(_epoll);
+
+}
+
+
+bool Reactor::good() const {
+
+    return _epoll >= 0;
+
+}
+
+
+void Reactor::add(State *machine) {
+
+    // register
+    _index[machine] = _machines.size();
+    _machines.push_back(machine);
+    _deadlines.push_back(0.0);
+
+    // poll in next iteration
+    _queue.push(Entry{0.0, _machines.size() - 1});
+
+}
+
+
+void Reactor::wake(State *machine) {
+
+    auto it = _index.find(machine);
+    if(it != _index.end())
+        _schedule(it->second, 0.0);
+
+}
+
+
+bool Reactor::post(State *machine, const Event &event) {
+
+    // post and wake up
+    auto queued = machine->post(event);
+    wake(machine);
+
+    return queued;
+
+}
+
+
+bool Reactor::addSource(int fd, unsigned int events, SourceCallback &&callback) {
+
+    // add to epoll
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if(epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+        return false;
+
+    _sources[fd] = std::move(callback);
+    return true;
+
+}
+
+
+void Reactor::removeSource(int fd) {
+
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    _sources.erase(fd);
+
+}
+
+
+void Reactor::_schedule(unsigned long index, double deadline) {
+
+    // set deadline, entries with other deadlines are outdated
+    _deadlines[index] = deadline;
+    if(!std::isinf(deadline))
+        _queue.push(Entry{deadline, index});
+
+}
+
+
+unsigned long Reactor::_dispatch(double now) {
+
+    // collect all machines which are due (each machine is polled once per dispatch)
+    _due.clear();
+    while(!_queue.empty() && _queue.top().first <= now) {
+
+        auto entry = _queue.top();
+        _queue.pop();
+
+        // skip outdated entries
+        if(entry.first == _deadlines[entry.second]) {
+            _deadlines[entry.second] = std::numeric_limits<double>::infinity();
+            _due.push_back(entry.second);
+        }
+
+    }
+
+    // poll and schedule next deadline
+    for(auto index : _due)
+        _schedule(index, _machines[index]->poll());
+
+    return _due.size();
+
+}
+
+
+bool Reactor::_arm(double now) {
+
+    // remove outdated entries
+    while(!_queue.empty() && _queue.top().first != _deadlines[_queue.top().second])
+        _queue.pop();
+
+    itimerspec spec{};
+    if(!_queue.empty()) {
+
+        // relative time to the next deadline (at least one nanosecond, zero would disarm)
+        auto delta = _queue.top().first - now;
+        if(delta < 1e-9)
+            delta = 1e-9;
+
+        spec.it_value.tv_sec = (time_t) delta;
+        spec.it_value.tv_nsec = (long) ((delta - (double) spec.it_value.tv_sec) * 1e9);
+
+    }
+
+    timerfd_settime(_timer, 0, &spec, nullptr);
+    return !_queue.empty();
+
+}
+
+
+unsigned long Reactor::runOnce(int timeout) {
+
+    // poll due machines
+    auto count = _dispatch(Timer::absoluteTime());
+
+    // nothing to wait for (or nothing to wait with)
+    if(!good() || (!_arm(Timer::absoluteTime()) && _sources.empty() && timeout < 0))
+        return count;
+
+    // wait
+    epoll_event events[16];
+    auto n = epoll_wait(_epoll, events, 16, timeout);
+
+    for(int i = 0; i < n; ++i) {
+
+        // clear timer
+        if(events[i].data.fd == _timer) {
+            uint64_t expirations;
+            auto r = read(_timer, &expirations, sizeof(expirations));
+            (void) r;
+            continue;
+        }
+
+        // call source
+        auto it = _sources.find(events[i].data.fd);
+        if(it != _sources.end())
+            it->second(events[i].data.fd, events[i].events);
+
+    }
+
+    // poll machines which are due now
+    return count + _dispatch(Timer::absoluteTime());
+
+}
+
+
+void Reactor::run() {
+
+    _running = good();
+    while(_running) {
+
+        // stop when nothing is left to wait for
+        runOnce();
+        if(_queue.empty() && _sources.empty())
+            _running = false;
+
+    }
+
+}
+
+
+void Reactor::stop() {
+
+    _running = false;
+
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-19.
+//
+
+
+#ifndef STATE_MACHINE_REACTOR_H
+#define STATE_MACHINE_REACTOR_H
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    typedef std::function<void (int fd, unsigned int events)> SourceCallback; //!< Type definition for callbacks of file descriptor sources
+
+
+    /**
+     * @brief Single-threaded event loop for many state machines (Linux only).
+     * The machines are stepped with State::poll() when their deadline has passed or when they are woken up (e.g. by
+     * an event). Between deadlines the reactor waits with epoll on a timerfd and the registered file descriptor
+     * sources, so idle machines cost nothing.
+     */
+    class Reactor {
+
+    protected:
+
+        typedef std::pair<double, unsigned long> Entry; //!< Deadline and index of the machine
+
+        int _epoll = -1;                   //!< epoll instance
+        int _timer = -1;                   //!< timerfd to wake up at the next deadline
+        bool _running = false;             //!< Flag whether run() is active
+
+        std::vector<State *> _machines{};  //!< Registered machines
+        std::vector<double> _deadlines{};  //!< Current deadline per machine
+        std::unordered_map<const State *, unsigned long> _index{}; //!< Index of each machine
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> _queue{}; //!< Deadlines (may contain outdated entries)
+        std::unordered_map<int, SourceCallback> _sources{}; //!< File descriptor sources
+        std::vector<unsigned long> _due{}; //!< Machines to be polled in the current dispatch
+
+
+        /** Polls all machines which are due, returns the number of polled machines */
+        unsigned long _dispatch(double now);
+
+        /** Sets the deadline of a machine */
+        void _schedule(unsigned long index, double deadline);
+
+        /** Arms the timer to the next deadline, returns false if nothing is scheduled */
+        bool _arm(double now);
+
+    public:
+
+        /**
+         * @brief Creates the epoll instance and the timer (check good() for failures)
+         */
+        Reactor();
+        ~Reactor();
+
+        Reactor(const Reactor &) = delete;
+        Reactor &operator=(const Reactor &) = delete;
+
+
+        /**
+         * Returns whether the epoll instance and the timer could be created. If not, sources cannot be added, runOnce()
+         * only polls the due machines without waiting and run() returns immediately.
+         * @return Flag
+         */
+        bool good() const;
+
+
+        /**
+         * @brief Adds a machine to the reactor. The machine is polled in the next iteration.
+         * @param machine Root state of the machine
+         */
+        void add(State *machine);
+
+
+        /**
+         * @brief Wakes a machine up, so it is polled in the next iteration.
+         * @param machine Root state of the machine
+         */
+        void wake(State *machine);
+
+
+        /**
+         * @brief Posts an event to the machine and wakes it up
+         * @param machine Root state of the machine
+         * @param event Event to be posted
+         * @return Flag whether the event could be queued
+         */
+        bool post(State *machine, const Event &event);
+
+
+        /**
+         * @brief Adds a file descriptor source
+         * @param fd File descriptor
+         * @param events epoll events to wait for (e.g. EPOLLIN)
+         * @param callback Callback to be called when the file descriptor is ready
+         * @return Flag whether the source could be added
+         */
+        bool addSource(int fd, unsigned int events, SourceCallback &&callback);
+
+
+        /**
+         * @brief Removes a file descriptor source
+         * @param fd File descriptor
+         */
+        void removeSource(int fd);
+
+
+        /**
+         * @brief Runs a single iteration: polls due machines, waits for the next deadline or source and dispatches.
+         * @param timeout Maximum time to wait in milliseconds (-1 waits until something happens)
+         * @return Number of polled machines
+         */
+        unsigned long runOnce(int timeout = -1);
+
+
+        /**
+         * @brief Runs iterations until stop() is called or nothing is left to wait for
+         */
+        void run();
+
+
+        /**
+         * @brief Stops run() after the current iteration
+         */
+        void stop();
+
+    };
+
+}
+
+#endif // STATE_MACHINE_REACTOR_H
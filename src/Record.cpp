@@ -0,0 +1,471 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-27.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "Record.h"
+
+using namespace emb;
+
+#define RECORD_VERSION 1
+
+
+namespace {
+
+    const unsigned char magic[4] = {'E', 'M', 'B', 'R'};
+
+
+    void writeVarint(std::vector<unsigned char> &log, unsigned long long value) {
+
+        // 7 bits per byte, high bit marks continuation
+        while(value >= 0x80) {
+            log.push_back((unsigned char) (value | 0x80));
+            value >>= 7;
+        }
+
+        log.push_back((unsigned char) value);
+
+    }
+
+
+    void writeDouble(std::vector<unsigned char> &log, double value) {
+
+        unsigned char bytes[sizeof(double)];
+        std::memcpy(bytes, &value, sizeof(double));
+        log.insert(log.end(), bytes, bytes + sizeof(double));
+
+    }
+
+
+    struct Reader {
+
+        const unsigned char *data;
+        unsigned long size;
+        unsigned long pos;
+
+        bool varint(unsigned long long &value) {
+
+            value = 0;
+            for(unsigned int shift = 0; shift < 64; shift += 7) {
+
+                if(pos >= size)
+                    return false;
+
+                auto byte = data[pos++];
+                value |= (unsigned long long) (byte & 0x7f) << shift;
+
+                if((byte & 0x80) == 0)
+                    return true;
+
+            }
+
+            return false;
+
+        }
+
+        bool number(double &value) {
+
+            if(pos + sizeof(double) > size)
+                return false;
+
+            std::memcpy(&value, data + pos, sizeof(double));
+            pos += sizeof(double);
+
+            return true;
+
+        }
+
+    };
+
+
+    inline unsigned long long zigzag(long long value) {
+
+        return ((unsigned long long) value << 1) ^ (unsigned long long) (value >> 63);
+
+    }
+
+
+    inline long long unzigzag(unsigned long long value) {
+
+        return (long long) (value >> 1) ^ -(long long) (value & 1);
+
+    }
+
+
+    struct Entry {
+        long id;
+        unsigned long step;
+        double time;
+    };
+
+}
+
+
+RecordMachine::RecordMachine(State *machine) : _machine(machine) {
+
+    _index(machine);
+
+}
+
+
+void RecordMachine::rebind(State *machine) {
+
+    _machine = machine;
+    _states.clear();
+    _ids.clear();
+    _index(machine);
+    _leaf = _activeLeaf();
+
+}
+
+
+void RecordMachine::_index(State *state) {
+
+    _ids[state] = _states.size();
+    _states.push_back(state);
+
+    for(auto child : state->getChildren())
+        _index(child);
+
+}
+
+
+long RecordMachine::_activeLeaf() const {
+
+    // follow the active path
+    const State *state = _machine;
+    while(state->currentState() != nullptr)
+        state = state->currentState();
+
+    return state == _machine ? -1 : id(state);
+
+}
+
+
+unsigned long RecordMachine::signal(double *variable) {
+
+    _signals.push_back(variable);
+    return _signals.size() - 1;
+
+}
+
+
+long RecordMachine::id(const State *state) const {
+
+    auto it = _ids.find(state);
+    return it == _ids.end() ? -1 : (long) it->second;
+
+}
+
+
+void Recorder::begin(State *initial) {
+
+    // header
+    _start = Timer::absoluteTime();
+    _log.assign(magic, magic + sizeof(magic));
+    _log.push_back(RECORD_VERSION);
+    writeDouble(_log, _start);
+
+    // reset signals
+    _values.assign(_signals.size(), 0.0);
+    _written.assign(_signals.size(), false);
+    _clock = 0;
+
+    // initialize at the recorded time
+    Timer::setVirtualTime(_start);
+    initial->initialize();
+    Timer::resetVirtualTime();
+
+    _log.push_back((unsigned char) RecordTag::Init);
+    writeVarint(_log, (unsigned long long) id(initial));
+    _leaf = _activeLeaf();
+
+}
+
+
+bool Recorder::post(const Event &event) {
+
+    _log.push_back((unsigned char) RecordTag::Event);
+    writeVarint(_log, event.id);
+
+    return _machine->post(event);
+
+}
+
+
+double Recorder::poll() {
+
+    return poll(Timer::absoluteTime());
+
+}
+
+
+double Recorder::poll(double now) {
+
+    // changed signals (compared bitwise, so NaN is handled)
+    _values.resize(_signals.size(), 0.0);
+    _written.resize(_signals.size(), false);
+    for(unsigned long i = 0; i < _signals.size(); ++i) {
+
+        auto value = *_signals[i];
+        if(_written[i] && std::memcmp(&value, &_values[i], sizeof(double)) == 0)
+            continue;
+
+        _log.push_back((unsigned char) RecordTag::Signal);
+        writeVarint(_log, i);
+        writeDouble(_log, value);
+
+        _values[i] = value;
+        _written[i] = true;
+
+    }
+
+    // clock sample (quantized to the recorded resolution)
+    auto clock = (long long) std::llround((now - _start) * 1e6);
+    _log.push_back((unsigned char) RecordTag::Clock);
+    writeVarint(_log, zigzag(clock - _clock));
+    _clock = clock;
+
+    // poll with frozen clock
+    auto time = _start + (double) clock * 1e-6;
+    Timer::setVirtualTime(time);
+    auto deadline = _machine->poll(time);
+    Timer::resetVirtualTime();
+
+    // transition
+    auto leaf = _activeLeaf();
+    if(leaf != _leaf) {
+        _log.push_back((unsigned char) RecordTag::Transition);
+        writeVarint(_log, (unsigned long long) (leaf + 1));
+        _leaf = leaf;
+    }
+
+    return deadline;
+
+}
+
+
+const std::vector<unsigned char> &Recorder::log() const {
+
+    return _log;
+
+}
+
+
+bool Recorder::save(const char *path) const {
+
+    auto file = std::fopen(path, "wb");
+    if(file == nullptr)
+        return false;
+
+    auto written = std::fwrite(_log.data(), 1, _log.size(), file);
+    auto closed = std::fclose(file) == 0;
+
+    return written == _log.size() && closed;
+
+}
+
+
+bool Replay::run(const std::vector<unsigned char> &log) {
+
+    return run(log.data(), log.size());
+
+}
+
+
+bool Replay::run(const unsigned char *data, unsigned long size) {
+
+    std::vector<Entry> expected{}, actual{};
+    Reader reader{data, size, 0};
+    double start = 0.0, time = 0.0;
+    long long clock = 0;
+    bool ok = true;
+
+    _differences.clear();
+    _steps = 0;
+    _transitions = 0;
+
+    // header
+    if(size < sizeof(magic) + 1 || std::memcmp(data, magic, sizeof(magic)) != 0 || data[4] != RECORD_VERSION)
+        return false;
+
+    reader.pos = sizeof(magic) + 1;
+    if(!reader.number(start))
+        return false;
+
+    time = start;
+
+    // records
+    while(ok && reader.pos < size) {
+
+        auto tag = (RecordTag) data[reader.pos++];
+        unsigned long long value = 0;
+
+        switch(tag) {
+
+            case RecordTag::Init:
+
+                ok = reader.varint(value) && value < _states.size();
+                if(!ok)
+                    break;
+
+                Timer::setVirtualTime(start);
+                _states[value]->initialize();
+                _leaf = _activeLeaf();
+                break;
+
+            case RecordTag::Clock:
+
+                ok = reader.varint(value);
+                if(!ok)
+                    break;
+
+                // poll on virtual time
+                clock += unzigzag(value);
+                time = start + (double) clock * 1e-6;
+                Timer::setVirtualTime(time);
+                _machine->poll(time);
+                _steps++;
+
+                // transition
+                value = (unsigned long long) _activeLeaf();
+                if((long) value != _leaf) {
+                    _leaf = (long) value;
+                    actual.push_back(Entry{_leaf, _steps, time - start});
+                }
+
+                break;
+
+            case RecordTag::Signal: {
+
+                double signal = 0.0;
+                ok = reader.varint(value) && reader.number(signal);
+                if(ok && value < _signals.size())
+                    *_signals[value] = signal;
+
+                break;
+
+            }
+
+            case RecordTag::Event:
+
+                ok = reader.varint(value);
+                if(ok)
+                    _machine->post(Event{(unsigned int) value, nullptr});
+
+                break;
+
+            case RecordTag::Transition:
+
+                ok = reader.varint(value);
+                if(ok)
+                    expected.push_back(Entry{(long) value - 1, _steps, time - start});
+
+                break;
+
+            default:
+                ok = false;
+
+        }
+
+    }
+
+    Timer::resetVirtualTime();
+
+    // compare transition sequences
+    auto count = std::max(expected.size(), actual.size());
+    for(unsigned long i = 0; i < count; ++i) {
+
+        auto e = i < expected.size() ? expected[i].id : -1;
+        auto a = i < actual.size() ? actual[i].id : -1;
+
+        // same state in the same step
+        if(i < expected.size() && i < actual.size() && e == a && expected[i].step == actual[i].step)
+            continue;
+
+        auto t = i < expected.size() ? expected[i].time : actual[i].time;
+        if(i < actual.size() && actual[i].time < t)
+            t = actual[i].time;
+
+        _differences.push_back(ReplayDifference{i, e, a, t});
+
+    }
+
+    _transitions = actual.size();
+    _duration = time - start;
+
+    return ok;
+
+}
+
+
+const std::vector<ReplayDifference> &Replay::differences() const {
+
+    return _differences;
+
+}
+
+
+unsigned long Replay::steps() const {
+
+    return _steps;
+
+}
+
+
+unsigned long Replay::transitions() const {
+
+    return _transitions;
+
+}
+
+
+double Replay::duration() const {
+
+    return _duration;
+
+}
+
+
+bool Replay::load(const char *path, std::vector<unsigned char> &log) {
+
+    auto file = std::fopen(path, "rb");
+    if(file == nullptr)
+        return false;
+
+    // read in chunks
+    unsigned char buffer[4096];
+    log.clear();
+
+    unsigned long read;
+    while((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        log.insert(log.end(), buffer, buffer + read);
+
+    auto ok = std::ferror(file) == 0;
+    std::fclose(file);
+
+    return ok;
+
+}
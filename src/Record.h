@@ -0,0 +1,251 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-27.
+//
+
+
+#ifndef STATE_MACHINE_RECORD_H
+#define STATE_MACHINE_RECORD_H
+
+#include <unordered_map>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    /**
+     * @brief Record types of the binary input log.
+     * The log starts with the magic "EMBR", the format version and the start time (double). Every record is a tag
+     * byte followed by unsigned LEB128 integers (and raw doubles for signal values).
+     */
+    enum class RecordTag : unsigned char {
+        Init = 1,        //!< Initial state (state id)
+        Clock = 2,       //!< Poll of the machine (zig-zag time delta in microseconds)
+        Signal = 3,      //!< Signal value (signal index, double)
+        Event = 4,       //!< Posted event (event id)
+        Transition = 5   //!< Active leaf state changed (state id)
+    };
+
+
+    struct ReplayDifference {
+
+        unsigned long index;   //!< Index in the transition sequence
+        long expected;         //!< Recorded state id (or -1 if the recording ended)
+        long actual;           //!< Replayed state id (or -1 if the replay ended)
+        double time;           //!< Time since start of the first different transition
+
+    };
+
+
+    /**
+     * @brief Machine wrapper with state ids.
+     * The states get ids in depth-first order of the children, so equally constructed machines have equal ids.
+     */
+    class RecordMachine {
+
+    protected:
+
+        State *_machine = nullptr;                                //!< Root state
+        std::vector<State *> _states{};                           //!< States by id
+        std::unordered_map<const State *, unsigned long> _ids{};  //!< Ids by state
+        std::vector<double *> _signals{};                         //!< Bound signal variables
+        long _leaf = -1;                                          //!< Id of the active leaf state
+
+        /** Returns the id of the active leaf state */
+        long _activeLeaf() const;
+
+        /** Adds the state and its sub-states to the id map */
+        void _index(State *state);
+
+    public:
+
+        /**
+         * @brief Creates the wrapper. The machine must be constructed completely.
+         * @param machine Root state
+         */
+        explicit RecordMachine(State *machine);
+
+
+        /**
+         * @brief Binds a signal variable (e.g. bound to a guard or captured by a condition)
+         * @param variable Pointer to the variable
+         * @return Index of the signal (signals must be bound in the same order for recording and replay)
+         */
+        unsigned long signal(double *variable);
+
+
+        /**
+         * @brief Re-indexes the states after the definition of the machine was replaced (see HotSwap::onSwap).
+         * The bound signals are kept.
+         * @param machine Root state of the new definition
+         */
+        void rebind(State *machine);
+
+
+        /**
+         * @brief Returns the id of a state
+         * @param state State
+         * @return Id (or -1 if the state is not part of the machine)
+         */
+        long id(const State *state) const;
+
+    };
+
+
+    /**
+     * @brief Records the inputs consumed by a machine into a compact binary log.
+     * The machine is polled through the recorder. Each poll writes the clock sample and the signals which changed
+     * since the last poll; posted events are written when posted. Changes of the active leaf state are written as
+     * transition records for comparison in a replay. The clock is frozen at the sample during the poll, so the
+     * timers of the machine see exactly the recorded time. Pointer payloads of events are not recorded.
+     */
+    class Recorder : public RecordMachine {
+
+    protected:
+
+        std::vector<unsigned char> _log{};        //!< Binary log
+        std::vector<double> _values{};            //!< Last recorded signal values
+        std::vector<bool> _written{};             //!< Flag per signal whether a value was recorded
+        long long _clock = 0;                     //!< Last clock sample in microseconds since start
+        double _start = 0.0;                      //!< Start time
+
+    public:
+
+        using RecordMachine::RecordMachine;
+
+
+        /**
+         * @brief Starts the recording and initializes the machine
+         * @param initial State to be initialized
+         */
+        void begin(State *initial);
+
+
+        /**
+         * @brief Records and posts an event
+         * @param event Event to be posted
+         * @return Flag whether the event could be queued
+         */
+        bool post(const Event &event);
+
+
+        /**
+         * @brief Samples the clock, records the inputs and polls the machine
+         * @return The next deadline of the machine
+         */
+        double poll();
+
+
+        /**
+         * @brief Records the inputs and polls the machine at the given time
+         * @param now Absolute time
+         * @return The next deadline of the machine
+         */
+        double poll(double now);
+
+
+        /**
+         * @brief Returns the binary log
+         * @return Log
+         */
+        const std::vector<unsigned char> &log() const;
+
+
+        /**
+         * @brief Writes the log into a file
+         * @param path File name
+         * @return Flag whether the file could be written
+         */
+        bool save(const char *path) const;
+
+    };
+
+
+    /**
+     * @brief Feeds a recorded log through a machine on virtual time, as fast as possible.
+     * The transitions of the replay are compared with the recorded transitions: a transition differs if it leads to
+     * another state or happens in another poll.
+     */
+    class Replay : public RecordMachine {
+
+    protected:
+
+        std::vector<ReplayDifference> _differences{}; //!< Differences of the transition sequence
+        unsigned long _steps = 0;                     //!< Number of polls
+        unsigned long _transitions = 0;               //!< Number of replayed transitions
+        double _duration = 0.0;                       //!< Virtual duration of the log
+
+    public:
+
+        using RecordMachine::RecordMachine;
+
+
+        /**
+         * @brief Replays the log. The machine must be newly constructed (not initialized).
+         * @param data Log data
+         * @param size Size of the log
+         * @return Flag whether the log could be read completely
+         */
+        bool run(const unsigned char *data, unsigned long size);
+        bool run(const std::vector<unsigned char> &log);
+
+
+        /**
+         * @brief Returns the differences between the recorded and the replayed transition sequence
+         * @return Differences (empty if the replay matches)
+         */
+        const std::vector<ReplayDifference> &differences() const;
+
+
+        /**
+         * @brief Returns the number of polls of the last replay
+         * @return Number of polls
+         */
+        unsigned long steps() const;
+
+
+        /**
+         * @brief Returns the number of transitions of the last replay
+         * @return Number of transitions
+         */
+        unsigned long transitions() const;
+
+
+        /**
+         * @brief Returns the virtual duration of the last replay
+         * @return Duration in seconds
+         */
+        double duration() const;
+
+
+        /**
+         * @brief Reads a log from a file
+         * @param path File name
+         * @param log Log to be written to
+         * @return Flag whether the file could be read
+         */
+        static bool load(const char *path, std::vector<unsigned char> &log);
+
+    };
+
+}
+
+#endif // STATE_MACHINE_RECORD_H
@@ -0,0 +1,230 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-25.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "Scheduler.h"
+
+using namespace emb;
+
+
+namespace {
+
+    inline unsigned long microseconds(double seconds) {
+
+        return (unsigned long) std::llround(seconds * 1e6);
+
+    }
+
+
+    inline unsigned long gcd(unsigned long a, unsigned long b) {
+
+        while(b != 0) {
+            auto t = a % b;
+            a = b;
+            b = t;
+        }
+
+        return a;
+
+    }
+
+
+    inline double seconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+
+        return std::chrono::duration<double>(to - from).count();
+
+    }
+
+}
+
+
+unsigned long Scheduler::add(State *machine, double period) {
+
+    // the machine is stepped by the scheduler at its period
+    machine->setTimeStepSize(period);
+
+    // find group
+    auto it = std::find_if(_groups.begin(), _groups.end(), [period](const Group &g) {
+        return microseconds(g.period) == microseconds(period);
+    });
+
+    // create group (sorted by period, i.e. by priority)
+    if(it == _groups.end()) {
+
+        it = std::upper_bound(_groups.begin(), _groups.end(), period, [](double p, const Group &g) {
+            return p < g.period;
+        });
+
+        it = _groups.insert(it, Group{period, 1, {}, 0, 0.0, 0.0});
+        _update();
+
+    }
+
+    it->machines.push_back(machine);
+
+    return (unsigned long) (it - _groups.begin());
+
+}
+
+
+unsigned long Scheduler::add(State *machine) {
+
+    return add(machine, machine->getTimeStepSize());
+
+}
+
+
+void Scheduler::_update() {
+
+    // base period in microseconds
+    unsigned long base = 0;
+    for(auto &g : _groups)
+        base = gcd(base, microseconds(g.period));
+
+    if(base == 0)
+        base = 1;
+
+    _base = (double) base * 1e-6;
+
+    // dividers
+    for(auto &g : _groups)
+        g.divider = std::max(1ul, microseconds(g.period) / base);
+
+}
+
+
+double Scheduler::basePeriod() const {
+
+    return _base;
+
+}
+
+
+unsigned long Scheduler::groups() const {
+
+    return _groups.size();
+
+}
+
+
+unsigned long Scheduler::tick(double now) {
+
+    unsigned long count = 0;
+
+    // rate monotonic: groups are sorted by period
+    for(auto &g : _groups) {
+
+        if(_tick % g.divider != 0)
+            continue;
+
+        auto begin = std::chrono::steady_clock::now();
+
+        for(auto m : g.machines)
+            m->poll(now);
+
+        auto duration = seconds(begin, std::chrono::steady_clock::now());
+
+        // statistics
+        g.steps++;
+        g.busy += duration;
+        g.worst = std::max(g.worst, duration);
+        count += g.machines.size();
+
+    }
+
+    _tick++;
+    _elapsed++;
+
+    return count;
+
+}
+
+
+void Scheduler::run() {
+
+    _running = true;
+
+    // tick zero
+    auto origin = std::chrono::steady_clock::now();
+    _start = Timer::absoluteTime();
+    _tick = 0;
+
+    while(_running) {
+
+        // execute tick at its nominal time
+        auto index = _tick;
+        tick(_start + (double) index * _base);
+
+        // wait for the next tick (late ticks are executed immediately)
+        auto next = origin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((double) (index + 1) * _base));
+
+        if(std::chrono::steady_clock::now() > next)
+            _overruns++;
+        else
+            std::this_thread::sleep_until(next);
+
+    }
+
+}
+
+
+void Scheduler::stop() {
+
+    _running = false;
+
+}
+
+
+RateGroupStatistics Scheduler::statistics(unsigned long group) const {
+
+    auto &g = _groups[group];
+    auto elapsed = (double) _elapsed * _base;
+
+    return RateGroupStatistics{g.period, g.steps, g.busy, g.worst, elapsed > 0.0 ? g.busy / elapsed : 0.0};
+
+}
+
+
+unsigned long Scheduler::overruns() const {
+
+    return _overruns;
+
+}
+
+
+void Scheduler::resetStatistics() {
+
+    for(auto &g : _groups) {
+        g.steps = 0;
+        g.busy = 0.0;
+        g.worst = 0.0;
+    }
+
+    _elapsed = 0;
+    _overruns = 0;
+
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-25.
+//
+
+
+#ifndef STATE_MACHINE_SCHEDULER_H
+#define STATE_MACHINE_SCHEDULER_H
+
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    struct RateGroupStatistics {
+
+        double period;            //!< Period of the group in seconds
+        unsigned long steps;      //!< Number of executions of the group
+        double busy;              //!< Accumulated execution time in seconds
+        double worst;             //!< Longest execution time in seconds
+        double utilisation;       //!< Share of the elapsed time used by the group (busy / elapsed)
+
+    };
+
+
+    /**
+     * @brief Rate-monotonic scheduler for machines with different periods.
+     * The machines are assigned to rate groups by their period. One base clock (the greatest common divisor of all
+     * periods) drives the ticks; in each tick the due groups are executed in order of their period, the fastest
+     * first. Machines are stepped with State::poll(now), so nothing sleeps inside a step; sub-states with their own
+     * time step size are stepped at their rate within the ticks of their machine. The only wait is the one for the
+     * next base tick in run().
+     */
+    class Scheduler {
+
+    protected:
+
+        struct Group {
+            double period;                   //!< Period in seconds
+            unsigned long divider;           //!< Period in base ticks
+            std::vector<State *> machines;   //!< Machines of the group
+            unsigned long steps;             //!< Number of executions
+            double busy;                     //!< Accumulated execution time
+            double worst;                    //!< Longest execution time
+        };
+
+        std::vector<Group> _groups{};       //!< Rate groups (sorted by period)
+        double _base = 0.0;                 //!< Base period in seconds
+        double _start = 0.0;                //!< Absolute time of tick zero
+        unsigned long _tick = 0;            //!< Index of the next tick
+        unsigned long _elapsed = 0;         //!< Ticks since the statistics were reset
+        unsigned long _overruns = 0;        //!< Number of ticks which took longer than the base period
+        bool _running = false;              //!< Flag whether run() is active
+
+
+        /** Updates the base period and the dividers of the groups */
+        void _update();
+
+    public:
+
+        /**
+         * @brief Adds a machine with the given period.
+         * The time step size of the machine is set to the period. Machines with the same period share a rate group.
+         * @param machine Root state of the machine
+         * @param period Period in seconds (resolution is one microsecond)
+         * @return Index of the rate group (indices change when a faster group is added)
+         */
+        unsigned long add(State *machine, double period);
+
+
+        /**
+         * @brief Adds a machine with its own time step size as period
+         * @param machine Root state of the machine (time step size must be set)
+         * @return Index of the rate group
+         */
+        unsigned long add(State *machine);
+
+
+        /**
+         * @brief Returns the base period (the greatest common divisor of all periods)
+         * @return Base period in seconds
+         */
+        double basePeriod() const;
+
+
+        /**
+         * @brief Returns the number of rate groups
+         * @return Number of groups
+         */
+        unsigned long groups() const;
+
+
+        /**
+         * @brief Executes one base tick at the given absolute time.
+         * All groups whose period is due are executed, the fastest first.
+         * @param now Absolute time of the tick
+         * @return Number of stepped machines
+         */
+        unsigned long tick(double now);
+
+
+        /**
+         * @brief Runs ticks on the base clock until stop() is called.
+         * The tick times are derived from the start time (no drift), late ticks are executed immediately and counted
+         * as overrun.
+         */
+        void run();
+
+
+        /**
+         * @brief Stops run() after the current tick
+         */
+        void stop();
+
+
+        /**
+         * @brief Returns the statistics of a rate group
+         * @param group Index of the group
+         * @return Statistics
+         */
+        RateGroupStatistics statistics(unsigned long group) const;
+
+
+        /**
+         * @brief Returns the number of ticks in run() which took longer than the base period
+         * @return Number of overruns
+         */
+        unsigned long overruns() const;
+
+
+        /**
+         * @brief Resets the statistics of all groups
+         */
+        void resetStatistics();
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SCHEDULER_H
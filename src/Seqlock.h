@@ -0,0 +1,150 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-31.
+//
+
+
+#ifndef STATE_MACHINE_SEQLOCK_H
+#define STATE_MACHINE_SEQLOCK_H
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace emb {
+
+    /**
+     * @brief Single-writer sequence lock.
+     * The writer never waits; readers retry when the data was changed while reading. The data is stored in atomic
+     * words (relaxed), so reading concurrently to a write is not a data race. T must be trivially copyable.
+     */
+    template<typename T>
+    class Seqlock {
+
+    protected:
+
+        typedef unsigned long Word;
+        static constexpr unsigned long _words = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+        std::atomic<unsigned long> _sequence{0};   //!< Sequence number (odd while writing)
+        std::atomic<Word> _data[_words];           //!< Data
+
+
+        /** Reads the data once, returns false if a write interfered */
+        bool _read(T &value, unsigned long &sequence) const {
+
+            Word words[_words];
+
+            sequence = _sequence.load(std::memory_order_acquire);
+            if(sequence & 1ul)
+                return false;
+
+            for(unsigned long i = 0; i < _words; ++i)
+                words[i] = _data[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(_sequence.load(std::memory_order_relaxed) != sequence)
+                return false;
+
+            std::memcpy(&value, words, sizeof(T));
+            return true;
+
+        }
+
+    public:
+
+        static_assert(std::is_trivially_copyable<T>::value, "seqlock data must be trivially copyable");
+
+
+        Seqlock() {
+
+            for(auto &w : _data)
+                w.store(0, std::memory_order_relaxed);
+
+        }
+
+
+        /**
+         * @brief Writes the data (single writer only, never blocks)
+         * @param value Data to be written
+         */
+        void write(const T &value) {
+
+            Word words[_words] = {};
+            std::memcpy(words, &value, sizeof(T));
+
+            // mark as being written
+            auto sequence = _sequence.load(std::memory_order_relaxed);
+            _sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for(unsigned long i = 0; i < _words; ++i)
+                _data[i].store(words[i], std::memory_order_relaxed);
+
+            // publish
+            _sequence.store(sequence + 2, std::memory_order_release);
+
+        }
+
+
+        /**
+         * @brief Tries to read a consistent copy of the data
+         * @param value Data to be written to
+         * @return Flag whether the copy is consistent (false if a write was in progress)
+         */
+        bool tryRead(T &value) const {
+
+            unsigned long sequence;
+            return _read(value, sequence);
+
+        }
+
+
+        /**
+         * @brief Reads a consistent copy of the data (retries while a write interferes)
+         * @param value Data to be written to
+         * @return Sequence number of the copy (two per write)
+         */
+        unsigned long read(T &value) const {
+
+            unsigned long sequence;
+            while(!_read(value, sequence)) {}
+
+            return sequence;
+
+        }
+
+
+        /**
+         * @brief Returns the current sequence number
+         * @return Sequence number
+         */
+        unsigned long sequence() const {
+
+            return _sequence.load(std::memory_order_acquire);
+
+        }
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SEQLOCK_H
@@ -0,0 +1,648 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-16.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "Series.h"
+#include "Timer.h"
+
+using namespace emb;
+
+#define SERIES_VERSION 1
+
+
+namespace {
+
+    const unsigned char magic[4] = {'E', 'M', 'B', 'S'};
+
+
+    inline unsigned long long zigzag(long long value) {
+
+        return ((unsigned long long) value << 1) ^ (unsigned long long) (value >> 63);
+
+    }
+
+
+    inline long long unzigzag(unsigned long long value) {
+
+        return (long long) (value >> 1) ^ -(long long) (value & 1);
+
+    }
+
+
+    void writeVarint(std::vector<unsigned char> &data, unsigned long long value) {
+
+        // 7 bits per byte, high bit marks continuation
+        while(value >= 0x80) {
+            data.push_back((unsigned char) (value | 0x80));
+            value >>= 7;
+        }
+
+        data.push_back((unsigned char) value);
+
+    }
+
+
+    template<typename T>
+    void writeRaw(std::vector<unsigned char> &data, T value) {
+
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+
+    }
+
+
+    template<typename T>
+    bool readRaw(std::FILE *file, T &value) {
+
+        return std::fread(&value, sizeof(T), 1, file) == 1;
+
+    }
+
+
+    struct ColumnDecoder {
+
+        const unsigned char *data;
+        unsigned long size;
+        unsigned long pos;
+        unsigned char order;
+        long long previous;
+        long long delta;
+        long long value;
+        unsigned long run;
+        unsigned long count;
+
+        bool varint(unsigned long long &result) {
+
+            result = 0;
+            for(unsigned int shift = 0; shift < 64; shift += 7) {
+
+                if(pos >= size)
+                    return false;
+
+                auto byte = data[pos++];
+                result |= (unsigned long long) (byte & 0x7f) << shift;
+
+                if((byte & 0x80) == 0)
+                    return true;
+
+            }
+
+            return false;
+
+        }
+
+        bool next(long long &result) {
+
+            // next run
+            if(run == 0) {
+
+                unsigned long long v, r;
+                if(!varint(v) || !varint(r) || r == 0)
+                    return false;
+
+                value = unzigzag(v);
+                run = (unsigned long) r;
+
+            }
+
+            run--;
+
+            // undo the transformation
+            if(order == 0) {
+                result = value;
+            } else if(count == 0) {
+                result = previous;
+            } else {
+                auto d = order == 2 ? delta + value : value;
+                result = previous + d;
+                delta = d;
+            }
+
+            previous = result;
+            count++;
+
+            return true;
+
+        }
+
+    };
+
+}
+
+
+SeriesColumn::SeriesColumn(unsigned char order) : _order(order) {
+
+}
+
+
+void SeriesColumn::append(long long value) {
+
+    long long x = value;
+
+    // transform
+    if(_order > 0) {
+
+        if(_count == 0) {
+            _first = value;
+            x = 0;
+        } else {
+            auto d = value - _previous;
+            x = _order == 2 ? d - _delta : d;
+            _delta = d;
+        }
+
+    } else if(_count == 0) {
+
+        _first = value;
+
+    }
+
+    _previous = value;
+    _count++;
+
+    // run-length encoding
+    if(_run > 0 && x == _value) {
+        _run++;
+        return;
+    }
+
+    flush();
+    _value = x;
+    _run = 1;
+
+}
+
+
+void SeriesColumn::flush() {
+
+    if(_run == 0)
+        return;
+
+    writeVarint(_data, zigzag(_value));
+    writeVarint(_data, _run);
+    _run = 0;
+
+}
+
+
+void SeriesColumn::reset() {
+
+    _data.clear();
+    _count = 0;
+    _first = 0;
+    _previous = 0;
+    _delta = 0;
+    _value = 0;
+    _run = 0;
+
+}
+
+
+void SeriesColumn::reserve(unsigned long samples) {
+
+    // a run of n values takes at most 10 bytes for the value and n bytes for the length
+    _data.reserve(11 * samples);
+
+}
+
+
+const std::vector<unsigned char> &SeriesColumn::data() const {
+
+    return _data;
+
+}
+
+
+long long SeriesColumn::first() const {
+
+    return _first;
+
+}
+
+
+SeriesRecorder::~SeriesRecorder() {
+
+    close();
+
+}
+
+
+void SeriesRecorder::addSignal(const std::string &name, const double *variable, double resolution) {
+
+    _signals.push_back(Signal{name, variable, resolution > 0.0 ? resolution : 1.0});
+
+}
+
+
+void SeriesRecorder::setBlockSize(unsigned long samples) {
+
+    _blockSize = samples > 0 ? samples : 1;
+
+}
+
+
+bool SeriesRecorder::open(const char *path, unsigned long maxFileSize, unsigned int files) {
+
+    close();
+
+    _path = path;
+    _maxFileSize = maxFileSize;
+    _files = files > 0 ? files : 1;
+
+    // time (delta of delta), state (values), signals (deltas)
+    _columns.clear();
+    _columns.emplace_back(2);
+    _columns.emplace_back(0);
+    for(unsigned long i = 0; i < _signals.size(); ++i)
+        _columns.emplace_back(1);
+
+    // reserve the buffers for a block
+    for(auto &c : _columns) {
+        c.reset();
+        c.reserve(_blockSize);
+    }
+
+    _header.reserve(20 + 12 * _columns.size());
+
+    _samples = 0;
+    _file = std::fopen(path, "wb");
+
+    return _file != nullptr && _writeHeader();
+
+}
+
+
+void SeriesRecorder::record() {
+
+    record(Timer::absoluteTime());
+
+}
+
+
+void SeriesRecorder::record(double now) {
+
+    if(_file == nullptr)
+        return;
+
+    // time stamp in microseconds (monotonic within the file)
+    auto time = (long long) std::llround(now * 1e6);
+    if(_samples > 0 && time < _lastTime)
+        time = _lastTime;
+
+    _columns[0].append(time);
+    _columns[1].append(_activeLeaf());
+
+    for(unsigned long i = 0; i < _signals.size(); ++i)
+        _columns[i + 2].append((long long) std::llround(*_signals[i].source / _signals[i].resolution));
+
+    _lastTime = time;
+    _samples++;
+    _recorded++;
+
+    // block complete
+    if(_samples >= _blockSize)
+        flush();
+
+}
+
+
+bool SeriesRecorder::flush() {
+
+    if(_file == nullptr || _samples == 0)
+        return true;
+
+    auto begin = std::chrono::steady_clock::now();
+    auto ok = _writeBlock();
+
+    // next block
+    for(auto &c : _columns)
+        c.reset();
+
+    _samples = 0;
+
+    // rotate
+    if(ok && _maxFileSize > 0 && _fileSize >= _maxFileSize)
+        ok = _rotate();
+
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    _worstFlush = std::max(_worstFlush, duration);
+
+    return ok;
+
+}
+
+
+void SeriesRecorder::close() {
+
+    if(_file == nullptr)
+        return;
+
+    flush();
+    std::fclose(_file);
+    _file = nullptr;
+
+}
+
+
+unsigned long SeriesRecorder::written() const {
+
+    return _written;
+
+}
+
+
+unsigned long SeriesRecorder::recorded() const {
+
+    return _recorded;
+
+}
+
+
+double SeriesRecorder::worstFlush() const {
+
+    return _worstFlush;
+
+}
+
+
+bool SeriesRecorder::_writeHeader() {
+
+    // magic, version, signals (name length, name, resolution)
+    _header.resize(sizeof(magic));
+    std::memcpy(_header.data(), magic, sizeof(magic));
+    _header.push_back(SERIES_VERSION);
+    writeRaw<unsigned int>(_header, (unsigned int) _signals.size());
+
+    for(auto &s : _signals) {
+        writeRaw<unsigned int>(_header, (unsigned int) s.name.size());
+        _header.insert(_header.end(), s.name.begin(), s.name.end());
+        writeRaw<double>(_header, s.resolution);
+    }
+
+    _fileSize = std::fwrite(_header.data(), 1, _header.size(), _file);
+    _written += _fileSize;
+
+    return _fileSize == _header.size();
+
+}
+
+
+bool SeriesRecorder::_writeBlock() {
+
+    for(auto &c : _columns)
+        c.flush();
+
+    // samples, time range, first value and size of each column
+    _header.clear();
+    writeRaw<unsigned int>(_header, (unsigned int) _samples);
+    writeRaw<long long>(_header, _columns[0].first());
+    writeRaw<long long>(_header, _lastTime);
+
+    for(auto &c : _columns) {
+        writeRaw<long long>(_header, c.first());
+        writeRaw<unsigned int>(_header, (unsigned int) c.data().size());
+    }
+
+    auto size = std::fwrite(_header.data(), 1, _header.size(), _file);
+    auto ok = size == _header.size();
+
+    for(auto &c : _columns) {
+        auto n = std::fwrite(c.data().data(), 1, c.data().size(), _file);
+        ok = ok && n == c.data().size();
+        size += n;
+    }
+
+    // keep the block on a crash
+    std::fflush(_file);
+
+    _fileSize += size;
+    _written += size;
+
+    return ok;
+
+}
+
+
+bool SeriesRecorder::_rotate() {
+
+    std::fclose(_file);
+    _file = nullptr;
+
+    // path.<n-2> -> path.<n-1>, ..., path -> path.1
+    for(auto i = _files - 1; i > 0; --i) {
+
+        auto from = i > 1 ? _path + "." + std::to_string(i - 1) : _path;
+        auto to = _path + "." + std::to_string(i);
+        std::remove(to.c_str());
+        std::rename(from.c_str(), to.c_str());
+
+    }
+
+    _file = std::fopen(_path.c_str(), "wb");
+
+    return _file != nullptr && _writeHeader();
+
+}
+
+
+bool SeriesReader::open(const char *path, unsigned int files) {
+
+    _files.clear();
+    _names.clear();
+    _resolutions.clear();
+
+    // oldest file first
+    for(auto i = files > 0 ? files - 1 : 0; ; --i) {
+
+        auto name = i > 0 ? std::string(path) + "." + std::to_string(i) : std::string(path);
+        auto file = std::fopen(name.c_str(), "rb");
+
+        if(file != nullptr) {
+
+            // read the header
+            unsigned char head[5];
+            unsigned int count = 0;
+            auto ok = std::fread(head, 1, 5, file) == 5 && std::memcmp(head, magic, 4) == 0
+                    && head[4] == SERIES_VERSION && readRaw(file, count);
+
+            std::vector<std::string> names{};
+            std::vector<double> resolutions{};
+            for(unsigned int s = 0; ok && s < count; ++s) {
+
+                unsigned int length = 0;
+                double resolution = 0.0;
+                ok = readRaw(file, length) && length < 4096;
+
+                std::string n(ok ? length : 0, '\0');
+                ok = ok && (length == 0 || std::fread(&n[0], 1, length, file) == length) && readRaw(file, resolution);
+
+                names.push_back(n);
+                resolutions.push_back(resolution);
+
+            }
+
+            std::fclose(file);
+
+            // all files must have the same signals
+            if(ok && (_files.empty() || names == _names)) {
+                _names = names;
+                _resolutions = resolutions;
+                _files.push_back(name);
+            }
+
+        }
+
+        if(i == 0)
+            break;
+
+    }
+
+    return !_files.empty();
+
+}
+
+
+const std::vector<std::string> &SeriesReader::signals() const {
+
+    return _names;
+
+}
+
+
+long SeriesReader::query(double from, double to, const SeriesCallback &callback) {
+
+    auto begin = (long long) std::llround(from * 1e6);
+    auto end = (long long) std::llround(to * 1e6);
+    auto columns = _names.size() + 2;
+
+    std::vector<long long> firsts(columns);
+    std::vector<unsigned int> sizes(columns);
+    std::vector<unsigned char> data{};
+    std::vector<double> values(_names.size());
+    std::vector<ColumnDecoder> decoders(columns);
+    long count = 0;
+
+    _blocks = 0;
+    _decoded = 0;
+
+    for(auto &name : _files) {
+
+        auto file = std::fopen(name.c_str(), "rb");
+        if(file == nullptr)
+            return -1;
+
+        // skip the header
+        unsigned char head[5];
+        unsigned int signals = 0;
+        auto ok = std::fread(head, 1, 5, file) == 5 && readRaw(file, signals);
+        for(unsigned int s = 0; ok && s < signals; ++s) {
+            unsigned int length = 0;
+            ok = readRaw(file, length) && std::fseek(file, (long) (length + sizeof(double)), SEEK_CUR) == 0;
+        }
+
+        // blocks (a truncated block at the end, e.g. after a crash, ends the file)
+        unsigned int samples;
+        while(ok && readRaw(file, samples)) {
+
+            long long first = 0, last = 0;
+            unsigned long total = 0;
+            auto complete = readRaw(file, first) && readRaw(file, last);
+
+            for(unsigned long c = 0; complete && c < columns; ++c) {
+                complete = readRaw(file, firsts[c]) && readRaw(file, sizes[c]);
+                total += sizes[c];
+            }
+
+            if(!complete)
+                break;
+
+            _blocks++;
+
+            // skip blocks outside of the range without reading them
+            if(last < begin || first > end) {
+                ok = std::fseek(file, (long) total, SEEK_CUR) == 0;
+                continue;
+            }
+
+            data.resize(total);
+            if(total > 0 && std::fread(data.data(), 1, total, file) != total)
+                break;
+
+            _decoded++;
+
+            // decoders of the columns (time: delta of delta, state: values, signals: deltas)
+            unsigned long offset = 0;
+            for(unsigned long c = 0; c < columns; ++c) {
+                auto order = (unsigned char) (c == 0 ? 2 : (c == 1 ? 0 : 1));
+                decoders[c] = ColumnDecoder{data.data() + offset, sizes[c], 0, order, firsts[c], 0, 0, 0, 0};
+                offset += sizes[c];
+            }
+
+            for(unsigned int i = 0; ok && i < samples; ++i) {
+
+                long long time = 0, state = 0, value = 0;
+                ok = decoders[0].next(time) && decoders[1].next(state);
+
+                for(unsigned long s = 0; ok && s < values.size(); ++s) {
+                    ok = decoders[s + 2].next(value);
+                    if(ok)
+                        values[s] = (double) value * _resolutions[s];
+                }
+
+                if(ok && time >= begin && time <= end) {
+                    callback(SeriesSample{(double) time * 1e-6, (long) state, values.data()});
+                    count++;
+                }
+
+            }
+
+        }
+
+        std::fclose(file);
+
+        if(!ok)
+            return -1;
+
+    }
+
+    return count;
+
+}
+
+
+unsigned long SeriesReader::blocks() const {
+
+    return _blocks;
+
+}
+
+
+unsigned long SeriesReader::decoded() const {
+
+    return _decoded;
+
+}
@@ -0,0 +1,314 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-16.
+//
+
+
+#ifndef STATE_MACHINE_SERIES_H
+#define STATE_MACHINE_SERIES_H
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Record.h"
+
+namespace emb {
+
+    /**
+     * @brief Encoder of one column of a series block.
+     * The values are optionally transformed into deltas or deltas of deltas and then run-length encoded as pairs of
+     * zig-zag LEB128 integers (value, run length). Regular time stamps and constant or linearly changing signals
+     * therefore take a few bytes per block.
+     */
+    class SeriesColumn {
+
+    protected:
+
+        std::vector<unsigned char> _data{};  //!< Encoded runs
+        unsigned char _order = 0;            //!< 0: values, 1: deltas, 2: deltas of deltas
+        unsigned long _count = 0;            //!< Number of values in the block
+        long long _first = 0;                //!< First value of the block
+        long long _previous = 0;             //!< Last value
+        long long _delta = 0;                //!< Last delta
+        long long _value = 0;                //!< Value of the current run
+        unsigned long _run = 0;              //!< Length of the current run
+
+    public:
+
+        /**
+         * @brief Creates the encoder
+         * @param order 0: values, 1: deltas, 2: deltas of deltas
+         */
+        explicit SeriesColumn(unsigned char order = 0);
+
+
+        /**
+         * @brief Appends a value
+         * @param value The value
+         */
+        void append(long long value);
+
+
+        /**
+         * @brief Ends the current run
+         */
+        void flush();
+
+
+        /**
+         * @brief Starts a new block
+         */
+        void reset();
+
+
+        /**
+         * @brief Reserves the data for the worst case of a block, so appending does not allocate
+         * @param samples Samples per block
+         */
+        void reserve(unsigned long samples);
+
+
+        /**
+         * Returns the encoded data (complete after flush)
+         * @return Data
+         */
+        const std::vector<unsigned char> &data() const;
+
+
+        /**
+         * Returns the first value of the block
+         * @return First value
+         */
+        long long first() const;
+
+    };
+
+
+    /**
+     * @brief Sample handed to the callback of a series query
+     */
+    struct SeriesSample {
+
+        double time;              //!< Time stamp (absolute time in seconds, microsecond resolution)
+        long state;               //!< Id of the active leaf state (see RecordMachine, -1 if none)
+        const double *values;     //!< Signal values (quantized to their resolution)
+
+    };
+
+    typedef std::function<void (const SeriesSample &sample)> SeriesCallback; //!< Type definition for series queries
+
+
+    /**
+     * @brief Flight recorder for signals and the active state of a machine.
+     * Every call of record() adds a sample: the time stamp (Timer::absoluteTime), the id of the active leaf state and
+     * the values of the signals, quantized to their resolution. Samples are encoded column by column while recording
+     * (time stamps as deltas of deltas, signals as deltas, the state as values, all run-length encoded), so the cost
+     * per sample is constant. Full blocks are appended to the file with their time range and the sizes of their
+     * columns. With a maximum file size, files are rotated (`path`, `path.1`, ... `path.<n-1>`), which bounds the
+     * storage. The file format uses the byte order of the host. A block truncated by a crash is ignored by the reader.
+     * Writing is done on the thread calling record(): the sample completing a block writes and flushes it, and when
+     * the file is full also closes, renames and opens the files. This file-system I/O has no upper bound on a slow or
+     * loaded storage (see worstFlush() and SeriesBenchmark). On a control thread with tight deadlines, call flush()
+     * at points where a delay is acceptable (e.g. in an idle state) before the block is full.
+     */
+    class SeriesRecorder : public RecordMachine {
+
+    protected:
+
+        struct Signal {
+            std::string name;          //!< Name of the signal
+            const double *source;      //!< Variable
+            double resolution;         //!< Quantization step
+        };
+
+        std::vector<Signal> _signals{};          //!< Signals
+        std::vector<SeriesColumn> _columns{};    //!< Time, state and signal columns
+        unsigned long _blockSize = 1024;         //!< Samples per block
+        unsigned long _samples = 0;              //!< Samples in the current block
+        long long _lastTime = 0;                 //!< Time stamp of the last sample in microseconds
+
+        std::FILE *_file = nullptr;              //!< Output file
+        std::string _path{};                     //!< Path of the current file
+        unsigned long _maxFileSize = 0;          //!< Size after which the file is rotated (0: no rotation)
+        unsigned int _files = 1;                 //!< Number of files kept
+        unsigned long _fileSize = 0;             //!< Size of the current file
+        unsigned long _written = 0;              //!< Total number of bytes written
+        unsigned long _recorded = 0;             //!< Total number of samples
+        double _worstFlush = 0.0;                //!< Longest flush in seconds
+
+        std::vector<unsigned char> _header{};    //!< Buffer for headers
+
+
+        /** Writes the file header */
+        bool _writeHeader();
+
+        /** Writes the current block */
+        bool _writeBlock();
+
+        /** Closes the current file, shifts the older files and opens a new one */
+        bool _rotate();
+
+    public:
+
+        using RecordMachine::RecordMachine;
+
+
+        /**
+         * @brief Closes the file
+         */
+        ~SeriesRecorder();
+
+
+        /**
+         * @brief Adds a signal (before open)
+         * @param name Name of the signal
+         * @param variable Variable to be sampled
+         * @param resolution Quantization step of the values
+         */
+        void addSignal(const std::string &name, const double *variable, double resolution);
+
+
+        /**
+         * @brief Sets the number of samples per block (before open)
+         * @param samples Samples per block
+         */
+        void setBlockSize(unsigned long samples);
+
+
+        /**
+         * @brief Opens the output file
+         * @param path File name
+         * @param maxFileSize Size in bytes after which the file is rotated (0: no rotation)
+         * @param files Number of files kept when rotating
+         * @return Flag whether the file could be opened
+         */
+        bool open(const char *path, unsigned long maxFileSize = 0, unsigned int files = 2);
+
+
+        /**
+         * @brief Records a sample at the current time (writes the block when it is complete)
+         */
+        void record();
+
+
+        /**
+         * @brief Records a sample at the given time
+         * @param now Absolute time
+         */
+        void record(double now);
+
+
+        /**
+         * @brief Writes the current (incomplete) block
+         * @return Flag whether the block could be written
+         */
+        bool flush();
+
+
+        /**
+         * @brief Writes the current block and closes the file
+         */
+        void close();
+
+
+        /**
+         * Returns the total number of bytes written
+         * @return Number of bytes
+         */
+        unsigned long written() const;
+
+
+        /**
+         * Returns the total number of recorded samples
+         * @return Number of samples
+         */
+        unsigned long recorded() const;
+
+
+        /**
+         * Returns the longest duration of a flush (writing a block and rotating the files)
+         * @return Duration in seconds
+         */
+        double worstFlush() const;
+
+    };
+
+
+    /**
+     * @brief Reads series files. Queries only decode the blocks overlapping the requested time range.
+     */
+    class SeriesReader {
+
+    protected:
+
+        std::vector<std::string> _files{};        //!< Files in chronological order
+        std::vector<std::string> _names{};        //!< Signal names
+        std::vector<double> _resolutions{};       //!< Signal resolutions
+        unsigned long _blocks = 0;                //!< Blocks visited by the last query
+        unsigned long _decoded = 0;               //!< Blocks decoded by the last query
+
+    public:
+
+        /**
+         * @brief Opens a recording (with its rotated files)
+         * @param path File name given to the recorder
+         * @param files Number of rotated files
+         * @return Flag whether at least one valid file was found
+         */
+        bool open(const char *path, unsigned int files = 1);
+
+
+        /**
+         * @brief Returns the signal names
+         * @return Names
+         */
+        const std::vector<std::string> &signals() const;
+
+
+        /**
+         * @brief Calls the callback for every sample within the time range
+         * @param from Start of the range (absolute time, inclusive)
+         * @param to End of the range (absolute time, inclusive)
+         * @param callback Callback
+         * @return Number of samples (or -1 if a file is corrupt)
+         */
+        long query(double from, double to, const SeriesCallback &callback);
+
+
+        /**
+         * Returns the number of blocks visited by the last query
+         * @return Number of blocks
+         */
+        unsigned long blocks() const;
+
+
+        /**
+         * Returns the number of blocks decoded by the last query
+         * @return Number of blocks
+         */
+        unsigned long decoded() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SERIES_H
@@ -0,0 +1,300 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_map>
+#include "ShmPublisher.h"
+
+using namespace emb;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && sizeof(std::atomic<std::uint64_t>) == 8,
+              "shared-memory status needs lock-free 64-bit atomics");
+
+
+namespace {
+
+    inline std::uint64_t pack(std::uint64_t low, std::uint64_t high) {
+
+        return (low & 0xffffffffu) | (high << 32);
+
+    }
+
+
+    inline std::uint64_t bits(double value) {
+
+        std::uint64_t word;
+        std::memcpy(&word, &value, sizeof(word));
+
+        return word;
+
+    }
+
+}
+
+
+/**
+ * @brief Monitor writing the status of one machine into its slot
+ */
+class ShmPublisher::Slot : public StateMonitor {
+
+public:
+
+    State *machine;                          //!< Root state (nullptr when detached by a swap)
+    std::atomic<std::uint64_t> *words;       //!< Slot in the segment
+    unsigned long states;                    //!< State capacity
+    std::vector<const State *> ids{};        //!< States by id
+    std::unordered_map<const State *, unsigned long> lookup{}; //!< Ids by state
+    std::vector<std::uint64_t> entries{};    //!< Entries per state id
+    std::vector<std::uint64_t> path{};       //!< Active path of the last publication
+    std::vector<std::uint64_t> buffer{};     //!< Data words to be written
+    std::uint64_t publications = 0;          //!< Number of publications
+
+
+    Slot(State *machine, std::atomic<std::uint64_t> *words, unsigned long states) :
+        machine(machine), words(words), states(states) {
+
+        index(machine);
+        entries.assign(ids.size(), 0);
+        path.assign(EMB_SNAPSHOT_DEPTH, ShmInvalidId);
+        buffer.assign(ShmSlotFixedWords - 5 + 2 * EMB_SNAPSHOT_DEPTH + states, 0);
+
+    }
+
+
+    void index(const State *state) {
+
+        lookup[state] = ids.size();
+        ids.push_back(state);
+        for(auto child : state->getChildren())
+            index(child);
+
+    }
+
+
+    static unsigned long count(const State *state) {
+
+        unsigned long n = 1;
+        for(auto child : state->getChildren())
+            n += count(child);
+
+        return n;
+
+    }
+
+
+    bool rebind(const State &from, const State &to) override {
+
+        if(&from != machine)
+            return false;
+
+        // the new definition doesn't fit, the slot keeps its last publication and is dropped
+        if(count(&to) > states) {
+            machine = nullptr;
+            return false;
+        }
+
+        // ids of the new definition, entries start again
+        machine = const_cast<State *>(&to);
+        ids.clear();
+        lookup.clear();
+        index(machine);
+        entries.assign(ids.size(), 0);
+        path.assign(EMB_SNAPSHOT_DEPTH, ShmInvalidId);
+
+        return true;
+
+    }
+
+
+    unsigned long id(const State *state) const {
+
+        auto it = lookup.find(state);
+        return it != lookup.end() ? it->second : ShmInvalidId;
+
+    }
+
+
+    void publish(const State &root) override {
+
+        // active path and entries of newly active states
+        unsigned long depth = 0;
+        bool changed = false;
+        const State *state = &root;
+        auto times = buffer.data() + 4 + EMB_SNAPSHOT_DEPTH;
+
+        while(state->currentState() != nullptr && depth < EMB_SNAPSHOT_DEPTH) {
+
+            state = state->currentState();
+            auto current = id(state);
+
+            // everything below a changed level is entered
+            changed = changed || current != path[depth];
+            if(changed && current < entries.size())
+                entries[current]++;
+
+            path[depth] = current;
+            times[depth] = bits(state->getTime());
+            depth++;
+
+        }
+
+        for(auto d = depth; d < EMB_SNAPSHOT_DEPTH; ++d) {
+            path[d] = ShmInvalidId;
+            times[d] = 0;
+        }
+
+        // data words (slot words 5..)
+        buffer[0] = pack(ids.size(), depth);
+        buffer[1] = root.getTransitionCount();
+        buffer[2] = ++publications;
+        buffer[3] = bits(Timer::absoluteTime());
+        std::copy(path.begin(), path.end(), buffer.begin() + 4);
+        std::copy(entries.begin(), entries.end(), buffer.begin() + 4 + 2 * EMB_SNAPSHOT_DEPTH);
+
+        // seqlock write
+        auto sequence = words[0].load(std::memory_order_relaxed);
+        words[0].store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for(unsigned long i = 0; i < buffer.size(); ++i)
+            words[5 + i].store(buffer[i], std::memory_order_relaxed);
+
+        words[0].store(sequence + 2, std::memory_order_release);
+
+    }
+
+};
+
+
+ShmPublisher::ShmPublisher() = default;
+
+
+ShmPublisher::~ShmPublisher() {
+
+    close();
+
+}
+
+
+bool ShmPublisher::open(const char *name, unsigned long machines, unsigned long states) {
+
+    close();
+
+    // size of the segment
+    auto slotWords = ShmSlotFixedWords + 2 * EMB_SNAPSHOT_DEPTH + states;
+    auto size = (ShmHeaderWords + machines * slotWords) * sizeof(std::uint64_t);
+
+    // create a new segment, readers of an old one keep their mapping
+    shm_unlink(name);
+    auto fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0)
+        return false;
+
+    if(ftruncate(fd, (off_t) size) != 0) {
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(memory == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+
+    _name = name;
+    _words = static_cast<std::atomic<std::uint64_t> *>(memory);
+    _size = size;
+    _machines = machines;
+    _states = states;
+
+    // header (the segment is zeroed by ftruncate)
+    _words[0].store(pack(EMB_SHM_MAGIC, EMB_SHM_VERSION), std::memory_order_relaxed);
+    _words[1].store(pack(ShmHeaderWords, slotWords), std::memory_order_relaxed);
+    _words[2].store(pack(machines, states), std::memory_order_relaxed);
+    _words[3].store(EMB_SNAPSHOT_DEPTH, std::memory_order_relaxed);
+    _words[4].store(0, std::memory_order_release);
+
+    return true;
+
+}
+
+
+void ShmPublisher::close() {
+
+    if(_words == nullptr)
+        return;
+
+    // detach machines (slots detached by a swap don't refer to a machine anymore)
+    for(auto &slot : _slots) {
+        if(slot->machine != nullptr)
+            slot->machine->setMonitor(nullptr);
+    }
+
+    _slots.clear();
+
+    munmap(_words, _size);
+    shm_unlink(_name.c_str());
+    _words = nullptr;
+    _size = 0;
+
+}
+
+
+long ShmPublisher::add(State *machine, const char *label) {
+
+    if(_words == nullptr || _slots.size() >= _machines)
+        return -1;
+
+    // slot
+    auto slotWords = ShmSlotFixedWords + 2 * EMB_SNAPSHOT_DEPTH + _states;
+    auto words = _words + ShmHeaderWords + _slots.size() * slotWords;
+    std::unique_ptr<Slot> slot(new Slot(machine, words, _states));
+
+    if(slot->ids.size() > _states)
+        return -1;
+
+    // label
+    char text[EMB_SHM_LABEL_SIZE] = {};
+    std::strncpy(text, label, EMB_SHM_LABEL_SIZE - 1);
+    for(unsigned long i = 0; i < EMB_SHM_LABEL_SIZE / 8; ++i) {
+        std::uint64_t word;
+        std::memcpy(&word, text + 8 * i, 8);
+        words[1 + i].store(word, std::memory_order_relaxed);
+    }
+
+    // first publication, then make the slot visible
+    slot->publish(*machine);
+    machine->setMonitor(slot.get());
+    _slots.emplace_back(std::move(slot));
+    _words[4].store(_slots.size(), std::memory_order_release);
+
+    return (long) _slots.size() - 1;
+
+}
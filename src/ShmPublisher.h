@@ -0,0 +1,97 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+
+#ifndef STATE_MACHINE_SHM_PUBLISHER_H
+#define STATE_MACHINE_SHM_PUBLISHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ShmReader.h"
+#include "State.h"
+
+namespace emb {
+
+    /**
+     * @brief Publishes the status of machines into a POSIX shared-memory segment (Linux only).
+     * Every added machine gets a slot which is updated in place after every step of the machine (the publisher sets
+     * itself as monitor of the machine). Each slot is protected by a seqlock, so other processes read it lock-free
+     * and the stepping thread never waits. When a HotSwap replaces the machine by a definition with too many states,
+     * the slot is detached and keeps its last publication.
+     */
+    class ShmPublisher {
+
+    protected:
+
+        class Slot;
+
+        std::string _name{};                         //!< Name of the segment
+        std::atomic<std::uint64_t> *_words = nullptr; //!< Mapped segment
+        unsigned long _size = 0;                     //!< Size of the mapping in bytes
+        unsigned long _machines = 0;                 //!< Machine capacity
+        unsigned long _states = 0;                   //!< State capacity per machine
+        std::vector<std::unique_ptr<Slot>> _slots{}; //!< Slots of the added machines
+
+    public:
+
+        ShmPublisher();
+        ~ShmPublisher();
+
+        ShmPublisher(const ShmPublisher &) = delete;
+        ShmPublisher &operator=(const ShmPublisher &) = delete;
+
+
+        /**
+         * @brief Creates (or replaces) the segment
+         *
+         * An existing segment of the same name is unlinked, readers which mapped it keep the old data.
+         * @param name Name of the segment (e.g. "/machines")
+         * @param machines Maximum number of machines
+         * @param states Maximum number of states per machine
+         * @return Flag whether the segment could be created
+         */
+        bool open(const char *name, unsigned long machines, unsigned long states);
+
+
+        /**
+         * @brief Unmaps the segment and removes it. The machines are detached.
+         */
+        void close();
+
+
+        /**
+         * @brief Adds a machine. The machine is published after each step from now on.
+         * @param machine Root state of the machine (must be constructed completely)
+         * @param label Label of the machine
+         * @return Index of the slot (or -1 if the segment is full or the machine has too many states)
+         */
+        long add(State *machine, const char *label);
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SHM_PUBLISHER_H
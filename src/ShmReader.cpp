@@ -0,0 +1,183 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ShmReader.h"
+
+using namespace emb;
+
+
+namespace {
+
+    inline std::uint64_t pack(std::uint64_t low, std::uint64_t high) {
+
+        return (low & 0xffffffffu) | (high << 32);
+
+    }
+
+
+    inline double number(std::uint64_t word) {
+
+        double value;
+        std::memcpy(&value, &word, sizeof(value));
+
+        return value;
+
+    }
+
+}
+
+
+ShmReader::~ShmReader() {
+
+    close();
+
+}
+
+
+bool ShmReader::open(const char *name) {
+
+    close();
+
+    auto fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0)
+        return false;
+
+    // map whole segment
+    struct stat info{};
+    if(fstat(fd, &info) != 0 || (unsigned long) info.st_size < ShmHeaderWords * sizeof(std::uint64_t)) {
+        ::close(fd);
+        return false;
+    }
+
+    auto memory = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(memory == MAP_FAILED)
+        return false;
+
+    _words = static_cast<const std::atomic<std::uint64_t> *>(memory);
+    _size = (unsigned long) info.st_size;
+
+    // check layout
+    if(_words[0].load(std::memory_order_relaxed) != pack(EMB_SHM_MAGIC, EMB_SHM_VERSION)) {
+        close();
+        return false;
+    }
+
+    return true;
+
+}
+
+
+void ShmReader::close() {
+
+    if(_words == nullptr)
+        return;
+
+    munmap(const_cast<std::atomic<std::uint64_t> *>(_words), _size);
+    _words = nullptr;
+    _size = 0;
+
+}
+
+
+unsigned long ShmReader::machines() const {
+
+    return _words == nullptr ? 0 : (unsigned long) _words[4].load(std::memory_order_acquire);
+
+}
+
+
+bool ShmReader::read(unsigned long index, ShmStatus &status) const {
+
+    if(index >= machines())
+        return false;
+
+    // layout
+    auto header = _words[1].load(std::memory_order_relaxed);
+    auto headerWords = (unsigned long) (header & 0xffffffffu);
+    auto slotWords = (unsigned long) (header >> 32);
+    auto states = (unsigned long) (_words[2].load(std::memory_order_relaxed) >> 32);
+    auto depth = (unsigned long) _words[3].load(std::memory_order_relaxed);
+    auto total = _size / sizeof(std::uint64_t);
+
+    // the segment is written by another process, check the layout before using it
+    if(headerWords < ShmHeaderWords || headerWords > total || depth > total || states > total
+       || slotWords != ShmSlotFixedWords + 2 * depth + states || index >= (total - headerWords) / slotWords)
+        return false;
+
+    auto slot = _words + headerWords + index * slotWords;
+
+    // label
+    char text[EMB_SHM_LABEL_SIZE];
+    for(unsigned long i = 0; i < EMB_SHM_LABEL_SIZE / 8; ++i) {
+        auto word = slot[1 + i].load(std::memory_order_relaxed);
+        std::memcpy(text + 8 * i, &word, 8);
+    }
+
+    text[EMB_SHM_LABEL_SIZE - 1] = '\0';
+    status.label = text;
+
+    // consistent copy of the data words
+    std::vector<std::uint64_t> data(slotWords - 5);
+    std::uint64_t sequence;
+
+    do {
+
+        sequence = slot[0].load(std::memory_order_acquire);
+        if(sequence & 1u)
+            continue;
+
+        for(unsigned long i = 0; i < data.size(); ++i)
+            data[i] = slot[5 + i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+    } while((sequence & 1u) || slot[0].load(std::memory_order_relaxed) != sequence);
+
+    // decode
+    auto count = (unsigned long) (data[0] & 0xffffffffu);
+    auto active = (unsigned long) (data[0] >> 32);
+    if(active > depth)
+        return false;
+
+    status.transitions = data[1];
+    status.publications = data[2];
+    status.stamp = number(data[3]);
+
+    status.path.assign(data.begin() + 4, data.begin() + 4 + (long) active);
+    status.times.resize(active);
+    for(unsigned long d = 0; d < active; ++d)
+        status.times[d] = number(data[4 + depth + d]);
+
+    status.entries.assign(data.begin() + 4 + 2 * (long) depth, data.begin() + 4 + 2 * (long) depth + (long) std::min(count, states));
+
+    return true;
+
+}
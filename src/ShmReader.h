@@ -0,0 +1,132 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+
+#ifndef STATE_MACHINE_SHM_READER_H
+#define STATE_MACHINE_SHM_READER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define EMB_SHM_MAGIC 0x534d4245u   //!< "EMBS"
+#define EMB_SHM_VERSION 1u          //!< Version of the layout
+#define EMB_SHM_LABEL_SIZE 32       //!< Size of a machine label including the terminating zero
+
+namespace emb {
+
+    /**
+     * @brief Layout of the shared-memory segment (all entries are 64-bit words).
+     *
+     * Header (ShmHeaderWords words):
+     *   0: magic (low 32 bit), version (high 32 bit)
+     *   1: header words (low), slot words (high)
+     *   2: machine capacity (low), state capacity per machine (high)
+     *   3: path depth
+     *   4: number of published machines (written with release order after the slot is set up)
+     *
+     * Slot per machine (slot words):
+     *   0: sequence (seqlock, odd while writing)
+     *   1..4: label (zero terminated, written once)
+     *   5: number of states (low), depth of the active path (high)
+     *   6: number of transitions
+     *   7: number of publications
+     *   8: time stamp of the publication (double)
+     *   9..: ids of the active path (depth words), times of the active states (double, depth words), number of
+     *        entries per state id (state capacity words)
+     *
+     * State ids are assigned in depth-first order of the children, the root has id 0.
+     */
+    constexpr unsigned long ShmHeaderWords = 8;        //!< Number of words of the header
+    constexpr unsigned long ShmSlotFixedWords = 9;     //!< Number of words of a slot before the path
+    constexpr unsigned long ShmInvalidId = 0xffffffff; //!< Id of unused path entries
+
+
+    struct ShmStatus {
+
+        std::string label{};                   //!< Label of the machine
+        std::vector<unsigned long> path{};     //!< Ids of the active states (root excluded)
+        std::vector<double> times{};           //!< Times of the active states in seconds
+        std::vector<unsigned long> entries{};  //!< Number of entries per state id
+        unsigned long transitions = 0;         //!< Number of transitions
+        unsigned long publications = 0;        //!< Number of publications (steps)
+        double stamp = 0.0;                    //!< Absolute time of the last publication
+
+    };
+
+
+    /**
+     * @brief Reads the status of machines from a shared-memory segment written by ShmPublisher (Linux only).
+     * Does not depend on the state library, so it can be linked into monitoring processes (library state_status).
+     */
+    class ShmReader {
+
+    protected:
+
+        const std::atomic<std::uint64_t> *_words = nullptr; //!< Mapped segment
+        unsigned long _size = 0;                           //!< Size of the mapping in bytes
+
+    public:
+
+        ShmReader() = default;
+        ~ShmReader();
+
+        ShmReader(const ShmReader &) = delete;
+        ShmReader &operator=(const ShmReader &) = delete;
+
+
+        /**
+         * @brief Maps the segment read-only and checks the layout version
+         * @param name Name of the segment
+         * @return Flag whether the segment could be opened
+         */
+        bool open(const char *name);
+
+
+        /**
+         * @brief Unmaps the segment
+         */
+        void close();
+
+
+        /**
+         * @brief Returns the number of published machines
+         * @return Number of machines
+         */
+        unsigned long machines() const;
+
+
+        /**
+         * @brief Reads a consistent status of a machine (retries while the machine is being published)
+         * @param index Index of the machine
+         * @param status Status to be written to
+         * @return Flag whether the machine exists
+         */
+        bool read(unsigned long index, ShmStatus &status) const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SHM_READER_H
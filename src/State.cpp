@@ -21,12 +21,76 @@
 // Created by Jens Klimke on 2021-05-08
 //
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include "State.h"
+#include "Trace.h"
 
 using namespace emb;
 
 #define TIME_ACCURACY_FACTOR 0.1
+#define TIME_EPSILON 1e-6
+
+#define ORDER_UPDATE_INTERVAL 64     // checks between two reorderings
+#define ORDER_SAMPLE_INTERVAL 8      // checks between two guard cost measurements
+#define ORDER_COST_WEIGHT 0.125      // weight of a new cost sample
+#define ORDER_MIN_COST 1e-9          // cost floor, so the hit rate decides for unmeasured guards
+#define ORDER_MAX_EVALUATIONS 65536  // counters are halved beyond, so older observations fade
+
+
+namespace {
+
+#ifndef EMB_EMBEDDED
+    inline const char *traceName(const State *state) {
+
+        return state->name.empty() ? "state" : state->name.c_str();
+
+    }
+#endif
+
+
+    inline bool fulfilled(const Transition *transition) {
+
+        EMB_TRACE_SCOPE(traceName(transition->from), "guard");
+
+#ifdef EMB_EMBEDDED
+        return transition->condition(transition);
+#else
+        // declarative guard replaces the condition callback
+        return transition->guard ? transition->guard->evaluate(transition) : transition->condition(transition);
+#endif
+
+    }
+
+
+#ifndef EMB_EMBEDDED
+
+    // checking mutually exclusive conditions by ascending cost per hit minimizes the expected cost of a check
+    inline double rank(const TransitionStatistics &statistics) {
+
+        auto probability = ((double) statistics.hits + 1.0) / ((double) statistics.evaluations + 2.0);
+        return (statistics.cost + ORDER_MIN_COST) / probability;
+
+    }
+
+#endif
+
+
+#ifdef EMB_EMBEDDED
+
+    BlockPool<sizeof(State) + EMB_STATE_EXTRA_SIZE, EMB_STATE_POOL_SIZE> statePool{};   // NOLINT
+    BlockPool<sizeof(Transition), EMB_TRANSITION_POOL_SIZE> transitionPool{};           // NOLINT
+
+    void releaseTransition(void *memory) {
+
+        transitionPool.release(memory);
+
+    }
+
+#endif
+
+}
 
 
 Timer * State::getTimer() {
@@ -43,14 +107,28 @@ double State::getTime() const {
 }
 
 
+const TickTimer *State::getTickTimer() const {
+
+    return &_tickTimer;
+
+}
+
+
 void State::_activate() {
 
     // set this to current
     if(_parent != nullptr)
         _parent->_currentState = this;
 
-    // start timer
+    // start timers
     _timer.start();
+    _tickTimer.start();
+
+    // step at next poll
+    _nextStep = 0.0;
+
+    // residency starts on entry and on initialization
+    EMB_TRACE_BEGIN(traceName(this), "state", this);
 
 }
 
@@ -66,41 +144,218 @@ void State::_deactivate() {
 
 void State::_enter(const Transition *transition) {
 
-    // activate parent
-    if(_parent != nullptr && _parent != transition->from->getParent())
+    // activate parent (if it was left or never entered)
+    if(_parent != nullptr && !_parent->_isActive())
         _parent->_enter(transition);
 
     // activate the state
     _activate();
 
     // run user defined entry function
-    if(onEnter)
+    if(onEnter) {
+        EMB_TRACE_SCOPE(traceName(this), "enter");
         onEnter(transition);
+    }
 
 }
 
 
 void State::step() {
 
-    // create step timer
+    // create step timer (integer timer for integer step sizes)
     Timer stepTimer{};
-    stepTimer.start();
+    auto stepStart = TickTimer::now();
+    if(_timeStepTicks == 0)
+        stepTimer.start();
+
+    // take the next event (root only)
+    if(_parent == nullptr)
+        _takeEvent();
+
+#ifndef EMB_EMBEDDED
+
+    // release idle resources (root only)
+    if(_parent == nullptr && !_idleStates.empty())
+        _releaseIdle(Timer::absoluteTime());
+
+#endif
 
     // check transitions
-    if(_checkTransitions())
+    if(_checkTransitions()) {
+        _publish();
         return;
+    }
 
     // run step
-    if(onStep)
-        onStep(this);
+    _run();
 
     // perform sub-step
     if(_currentState)
         _currentState->step();
 
+    // publish snapshot (root only)
+    _publish();
+
     // delay
-    while(stepTimer.time() < _timeStepSize * (1.0 - TIME_ACCURACY_FACTOR * 0.5))
-        Timer::delay(TIME_ACCURACY_FACTOR * _timeStepSize);
+    if(_timeStepTicks > 0) {
+
+        auto delay = _timeStepTicks / 10 > 0 ? _timeStepTicks / 10 : 1;
+        while(TickTimer::elapsed(stepStart, TickTimer::now()) < _timeStepTicks - _timeStepTicks / 20)
+            TickTimer::delay(delay);
+
+    } else {
+
+        while(stepTimer.time() < _timeStepSize * (1.0 - TIME_ACCURACY_FACTOR * 0.5))
+            Timer::delay(TIME_ACCURACY_FACTOR * _timeStepSize);
+
+    }
+
+}
+
+
+double State::poll() {
+
+    return poll(Timer::absoluteTime());
+
+}
+
+
+double State::poll(double now) {
+
+    auto deadline = _poll(now);
+    _publish();
+
+    return deadline;
+
+}
+
+
+double State::_poll(double now) {
+
+    // not due yet (with tolerance for periods given as multiples of a base tick)
+    if(now < _nextStep - TIME_EPSILON)
+        return _deadline(now);
+
+    // schedule next step
+    _nextStep = now + _timeStepSize;
+
+    // take the next event (root only)
+    if(_parent == nullptr)
+        _takeEvent();
+
+#ifndef EMB_EMBEDDED
+
+    // release idle resources (root only)
+    if(_parent == nullptr && !_idleStates.empty())
+        _releaseIdle(now);
+
+#endif
+
+    // check transitions, step again without delay after a transition
+    if(_checkTransitions()) {
+        _nextStep = now;
+        return _deadline(now);
+    }
+
+    // run step
+    _run();
+
+    // perform sub-step
+    if(_currentState)
+        _currentState->_poll(now);
+
+    // pending events are processed immediately
+    if(_parent == nullptr && _events.size() > 0)
+        return now;
+
+    return _deadline(now);
+
+}
+
+
+void State::_takeEvent() {
+
+    _hasEvent = _events.pop(_event);
+
+#ifndef EMB_EMBEDDED
+
+    // don't keep the payload (e.g. a pool block) until the next event
+    if(!_hasEvent)
+        _event.payload = nullptr;
+
+#endif
+
+}
+
+
+const Transition *State::_prepareStep() {
+
+    // first fulfilled transition from the root down the active path (as checked by step)
+    for(auto state = this; state != nullptr; state = state->_currentState) {
+
+        auto transition = state->_findTransition();
+        if(transition != nullptr)
+            return transition;
+
+    }
+
+    return nullptr;
+
+}
+
+
+void State::_commitStep(const Transition *transition) {
+
+#ifndef EMB_EMBEDDED
+
+    // release idle resources
+    if(!_idleStates.empty())
+        _releaseIdle(Timer::absoluteTime());
+
+#endif
+
+    // the states above the source of the transition perform their step
+    for(auto state = this; state != nullptr; state = state->_currentState) {
+
+        if(transition != nullptr && state == transition->from) {
+            state->_takeTransition(transition);
+            break;
+        }
+
+        state->_run();
+
+    }
+
+    _publish();
+
+}
+
+
+double State::_deadline(double now) const {
+
+    // with a time step size, the state is stepped regularly
+    if(_timeStepSize > 0.0)
+        return _nextStep;
+
+    // earliest timed transition
+    auto deadline = std::numeric_limits<double>::infinity();
+    for(auto &t : _transitions) {
+
+        if(t->after > 0.0 && now - getTime() + t->after < deadline)
+            deadline = now - getTime() + t->after;
+
+    }
+
+    // sub-state
+    if(_currentState) {
+
+        auto sub = _currentState->_deadline(now);
+        if(sub < deadline)
+            deadline = sub;
+
+    }
+
+    return deadline;
 
 }
 
@@ -108,14 +363,17 @@ void State::step() {
 void State::_exit(const Transition *transition) {
 
     // run user defined exit state
-    if(onLeave)
+    if(onLeave) {
+        EMB_TRACE_SCOPE(traceName(this), "leave");
         onLeave(transition);
+    }
 
     // deactivate state
     _deactivate();
+    EMB_TRACE_END(traceName(this), "state", this);
 
-    // deactivate parent
-    if(_parent != nullptr && _parent != transition->to->getParent())
+    // deactivate parent (up to the common ancestor of source and target)
+    if(_parent != nullptr && !_parent->_contains(transition->to))
         _parent->_exit(transition);
 
 }
@@ -123,48 +381,331 @@ void State::_exit(const Transition *transition) {
 
 bool State::_checkTransitions() {
 
+    auto transition = _findTransition();
+    if(transition == nullptr)
+        return false;
+
+    _takeTransition(transition);
+    return true;
+
+}
+
+
+const Transition *State::_findTransition() {
+
+#ifndef EMB_EMBEDDED
+
+    // mutually exclusive transitions are checked in the optimized order
+    if(_order != TransitionOrder::Priority)
+        return _findOrderedTransition();
+
+#endif
+
     // iterate over transitions
     for(auto &t : _transitions) {
 
-        if(t->condition(t.get())) {
+        // check declarative guard or condition callback
+        if(fulfilled(t.get()))
+            return t.get();
 
-            // leave current
-            _exit(t.get());
+    }
 
-            // enter new one
-            t->to->_enter(t.get());
+    // no transition active
+    return nullptr;
 
-            // return with true
-            return true;
+}
+
+
+void State::_takeTransition(const Transition *transition) {
+
+    // leave current
+    _exit(transition);
+
+    // enter new one
+    transition->to->_enter(transition);
+    _root()->_transitionCount++;
+
+}
+
+
+#ifndef EMB_EMBEDDED
+
+const Transition *State::_findOrderedTransition() {
+
+    using clock = std::chrono::steady_clock;
+
+    // transitions added after the order was set
+    if(_evaluationOrder.size() != _transitions.size())
+        _updateOrder();
+
+    // reorder regularly
+    auto adaptive = _order == TransitionOrder::Adaptive;
+    if(adaptive && ++_checks % ORDER_UPDATE_INTERVAL == 0)
+        _sortTransitions();
+
+    // the guard cost is only measured in every n-th check
+    auto sample = adaptive && _checks % ORDER_SAMPLE_INTERVAL == 0;
+
+    for(auto index : _evaluationOrder) {
+
+        auto t = _transitions[index].get();
+        auto &statistics = _statistics[index];
+        bool hit;
+
+        if(sample) {
+
+            auto t0 = clock::now();
+            hit = fulfilled(t);
+            auto cost = std::chrono::duration<double>(clock::now() - t0).count();
+
+            // moving average
+            statistics.cost = statistics.cost == 0.0 ? cost
+                    : statistics.cost + (cost - statistics.cost) * ORDER_COST_WEIGHT;
+
+        } else {
+
+            hit = fulfilled(t);
+
+        }
 
+        if(adaptive) {
+            statistics.evaluations++;
+            statistics.hits += hit ? 1 : 0;
         }
 
+        if(hit)
+            return t;
+
     }
 
     // no transition active
-    return false;
+    return nullptr;
+
+}
+
+
+void State::_updateOrder() {
+
+    // drop removed transitions
+    auto size = (unsigned int) _transitions.size();
+    _evaluationOrder.erase(std::remove_if(_evaluationOrder.begin(), _evaluationOrder.end(), [size](unsigned int i) {
+        return i >= size;
+    }), _evaluationOrder.end());
+
+    // keep the order of the known transitions, append new ones
+    for(auto i = (unsigned int) _evaluationOrder.size(); i < _transitions.size(); ++i)
+        _evaluationOrder.push_back(i);
+
+    _statistics.resize(_transitions.size(), TransitionStatistics{0, 0, 0.0});
+
+}
+
+
+void State::_sortTransitions() {
+
+    // fade older observations
+    for(auto &s : _statistics) {
+
+        if(s.evaluations > ORDER_MAX_EVALUATIONS) {
+            s.evaluations /= 2;
+            s.hits /= 2;
+        }
+
+    }
+
+    // stable insertion sort (the order is mostly sorted already, std::stable_sort allocates a buffer)
+    for(unsigned long i = 1; i < _evaluationOrder.size(); ++i) {
+
+        auto index = _evaluationOrder[i];
+        auto r = rank(_statistics[index]);
+
+        auto j = i;
+        for(; j > 0 && r < rank(_statistics[_evaluationOrder[j - 1]]); --j)
+            _evaluationOrder[j] = _evaluationOrder[j - 1];
+
+        _evaluationOrder[j] = index;
+
+    }
+
+}
+
+
+void State::setTransitionOrder(TransitionOrder order) {
+
+    _order = order;
+    _updateOrder();
+
+}
+
+
+TransitionOrder State::getTransitionOrder() const {
+
+    return _order;
+
+}
+
+
+const std::vector<TransitionStatistics> &State::getTransitionStatistics() const {
+
+    return _statistics;
+
+}
+
+
+bool State::setTransitionStatistics(const std::vector<TransitionStatistics> &statistics) {
+
+    if(statistics.size() != _transitions.size())
+        return false;
+
+    // restart from the insertion order
+    _statistics = statistics;
+    _evaluationOrder.clear();
+    _updateOrder();
+    _sortTransitions();
+
+    return true;
+
+}
+
+
+const std::vector<unsigned int> &State::getEvaluationOrder() const {
+
+    return _evaluationOrder;
+
+}
+
+
+void State::_releaseIdle(double now) {
+
+    // entries of released sub-trees are set to nullptr meanwhile
+    for(auto &s : _idleStates) {
+        if(s != nullptr && s->_release(now))
+            s = nullptr;
+    }
+
+    _idleStates.erase(std::remove(_idleStates.begin(), _idleStates.end(), nullptr), _idleStates.end());
+
+}
+
+
+void State::_scheduleRelease() {
+
+    _root()->_idleStates.push_back(this);
+
+}
+
+
+void State::_cancelRelease() {
+
+    for(auto &s : _root()->_idleStates) {
+        if(s != nullptr && s != this && _contains(s))
+            s = nullptr;
+    }
+
+}
+
+
+bool State::_release(double) {
+
+    // nothing to release
+    return true;
+
+}
+
+#endif
+
+
+void State::_run() {
+
+    // run user defined step function
+    if(onStep) {
+        EMB_TRACE_SCOPE(traceName(this), "step");
+        onStep(this);
+    }
+
+}
+
+
+void State::_createTransition(State *targetState, TransitionConditionCallback &&condition, double after) {
+
+#ifdef EMB_EMBEDDED
+
+    // take transition from the pool
+    auto memory = transitionPool.allocate(sizeof(Transition));
+    if(memory == nullptr) {
+        EMB_CAPACITY_EXCEEDED();
+        return;
+    }
+
+    _transitions.emplace_back(new(memory) Transition{this, targetState, std::move(condition), after},
+            PoolDeleter{&releaseTransition});
+
+#else
+
+    // create and add transition
+    _transitions.emplace_back(std::unique_ptr<Transition>(
+            new Transition{this, targetState, std::move(condition), nullptr, after}
+    ));
+
+#endif
 
 }
 
 
 void State::addTransition(TransitionConditionCallback &&condition, State *targetState) {
 
+    _createTransition(targetState, std::move(condition), 0.0);
+
+}
+
+
+#ifndef EMB_EMBEDDED
+
+void State::addTransition(const Guard &guard, State *targetState) {
+
     // create and add transition
     _transitions.emplace_back(std::unique_ptr<Transition>(
-            new Transition{this, targetState, std::move(condition)}
+            new Transition{this, targetState, nullptr, std::unique_ptr<Guard>(new Guard(guard)), 0.0}
     ));
 
 }
 
+#endif
+
+
+void State::addEventTransition(unsigned int event, State *targetState) {
+
+#ifdef EMB_EMBEDDED
+    _createTransition(targetState, [event](const Transition *transition) {
+        auto current = transition->from->currentEvent();
+        return current != nullptr && current->id == event;
+    }, 0.0);
+#else
+    addTransition(Guard::event() == (double) event, targetState);
+#endif
+
+}
+
 
 void State::addTimedTransition(double after, State *targetState) {
 
     // create transition
-    _transitions.emplace_back(std::unique_ptr<Transition>(
-            new Transition{this, targetState, [this, after](const Transition *transition) {
-                return this->getTime() >= after;
-            }}
-    ));
+    _createTransition(targetState, [this, after](const Transition *) {
+        return this->getTime() >= after - TIME_EPSILON;
+    }, after);
+
+}
+
+
+void State::addTimedTransition(std::chrono::microseconds after, State *targetState) {
+
+    // milliseconds, rounded up
+    auto ticks = (Ticks) ((after.count() + 999) / 1000);
+
+    // create transition
+    _createTransition(targetState, [this, ticks](const Transition *) {
+        return this->_tickTimer.milliseconds() >= ticks;
+    }, (double) ticks * 1e-3);
 
 }
 
@@ -177,27 +718,40 @@ void State::initialize() {
 
     // activate state
     this->_activate();
+    _root()->_publish();
 
 }
 
 
 State *State::createState() {
 
-    // create state and add to vector
-    _states.emplace_back(std::unique_ptr<State>(new State));
+    return createState<State>();
+
+}
+
+
+#ifdef EMB_EMBEDDED
+
+void *State::_allocateState(unsigned long size) {
+
+    return statePool.allocate(size);
+
+}
+
 
-    // set parent
-    _states.back()->_parent = this;
+void State::_releaseState(void *memory) {
 
-    // return state
-    return _states.back().get();
+    statePool.release(memory);
 
 }
 
+#endif
+
 
 void State::addState(State *state) {
 
     state->_parent = this;
+    _children.push_back(state);
 
 }
 
@@ -216,8 +770,134 @@ const State * State::getParent() const {
 }
 
 
+const StateList &State::getChildren() const {
+
+    return _children;
+
+}
+
+
+const TransitionVector &State::getTransitions() const {
+
+    return _transitions;
+
+}
+
+
 void State::setTimeStepSize(double timeStepSize) {
 
     _timeStepSize = timeStepSize;
+    _timeStepTicks = 0;
+
+}
+
+
+void State::setTimeStepSize(std::chrono::microseconds timeStepSize) {
+
+    _timeStepTicks = (Ticks) ((timeStepSize.count() + 999) / 1000);
+    _timeStepSize = (double) _timeStepTicks * 1e-3;
+
+}
+
+
+double State::getTimeStepSize() const {
+
+    return _timeStepSize;
+
+}
+
+
+bool State::post(const Event &event) {
+
+    return getEventQueue()->push(event);
+
+}
+
+
+const Event *State::currentEvent() const {
+
+    // find root
+    auto root = this;
+    while(root->_parent != nullptr)
+        root = root->_parent;
+
+    return root->_hasEvent ? &root->_event : nullptr;
+
+}
 
-}
\ No newline at end of file
+
+EventQueue *State::getEventQueue() {
+
+    // find root
+    auto root = this;
+    while(root->_parent != nullptr)
+        root = root->_parent;
+
+    return &root->_events;
+
+}
+
+
+void State::setMonitor(StateMonitor *monitor) {
+
+    _monitor = monitor;
+
+}
+
+
+unsigned long State::getTransitionCount() const {
+
+    return _transitionCount;
+
+}
+
+
+State *State::_root() {
+
+    auto root = this;
+    while(root->_parent != nullptr)
+        root = root->_parent;
+
+    return root;
+
+}
+
+
+bool State::_isActive() const {
+
+    return _parent == nullptr || (_parent->_currentState == this && _parent->_isActive());
+
+}
+
+
+bool State::_contains(const State *state) const {
+
+    // this state or one of its ancestors
+    for(auto s = state; s != nullptr; s = s->_parent) {
+        if(s == this)
+            return true;
+    }
+
+    return false;
+
+}
+
+
+void State::_publish() {
+
+    if(_parent == nullptr && _monitor != nullptr)
+        _monitor->publish(*this);
+
+}
+
+
+const EventQueue *State::getEventQueue() const {
+
+    // find root
+    auto root = this;
+    while(root->_parent != nullptr)
+        root = root->_parent;
+
+    return &root->_events;
+
+}
@@ -25,22 +25,68 @@
 #ifndef STATE_MACHINE_STATE_H
 #define STATE_MACHINE_STATE_H
 
-#include <functional>
+#include <chrono>
 #include <memory>
-#include <vector>
-#include <iostream>
+#include "Config.h"
+#include "Event.h"
+#include "Monitor.h"
 #include "Timer.h"
 
+#ifdef EMB_EMBEDDED
+#include "Fixed.h"
+#else
+#include <functional>
+#include <string>
+#include <vector>
+#include "Guard.h"
+#endif
+
 namespace emb {
 
     struct State;        //!< Pre-definition of type state
     struct Transition;   //!< Pre-definition of type transition
 
+#ifdef EMB_EMBEDDED
+
+    // embedded profile: fixed capacities, states and transitions are taken from static pools
+    typedef FixedFunction<bool (const Transition *transition), EMB_CALLBACK_SIZE> TransitionConditionCallback; //!< Type definition for transition condition callbacks
+    typedef FixedFunction<void (const Transition *transition), EMB_CALLBACK_SIZE> StateInterfaceCallback;      //!< Type definition for callbacks when entering or leaving state
+    typedef FixedFunction<void (State *state), EMB_CALLBACK_SIZE> StateStepCallback;                           //!< Type definition for callbacks within state
+    typedef FixedVector<std::unique_ptr<Transition, PoolDeleter>, EMB_MAX_TRANSITIONS> TransitionVector;      //!< Type definition for transition vector
+    typedef FixedVector<std::unique_ptr<State, PoolDeleter>, EMB_MAX_STATES> StateVector;                     //!< Type definition for state vector
+    typedef FixedVector<State *, EMB_MAX_STATES> StateList;                                                    //!< Type definition for sub-state list
+    typedef const char *StateName;                                                                             //!< Type definition for state names
+
+#else
+
     typedef std::function<bool (const Transition *transition)> TransitionConditionCallback; //!< Type definition for transition condition callbacks
     typedef std::function<void (const Transition *transition)> StateInterfaceCallback;      //!< Type definition for callbacks when entering or leaving state
     typedef std::function<void (State *state)> StateStepCallback;                           //!< Type definition for callbacks within state
     typedef std::vector<std::unique_ptr<Transition>> TransitionVector;                      //!< Type definition for transition vector
     typedef std::vector<std::unique_ptr<State>> StateVector;                                //!< Type definition for state vector
+    typedef std::vector<State *> StateList;                                                 //!< Type definition for sub-state list
+    typedef std::string StateName;                                                          //!< Type definition for state names
+
+#endif
+
+#ifndef EMB_EMBEDDED
+
+    /** Evaluation order of the transitions of a state */
+    enum class TransitionOrder : unsigned char {
+        Priority,    //!< Insertion order, the first fulfilled transition is taken (default)
+        Exclusive,   //!< Conditions are mutually exclusive, checked in the order of the statistics (e.g. a profile)
+        Adaptive     //!< Conditions are mutually exclusive, the order is adapted online by hit rate and guard cost
+    };
+
+    struct TransitionStatistics {
+
+        unsigned long evaluations; //!< Number of evaluations of the condition
+        unsigned long hits;        //!< Number of evaluations in which the condition was fulfilled
+        double cost;               //!< Mean duration of an evaluation in seconds (sampled)
+
+    };
+
+#endif
 
     struct Transition {
 
@@ -48,6 +94,10 @@ namespace emb {
         State *to;            //!< End node of the transition
 
         TransitionConditionCallback condition; //!< Condition to follow the transition
+#ifndef EMB_EMBEDDED
+        std::unique_ptr<Guard> guard;          //!< Declarative condition (replaces the callback when set)
+#endif
+        double after;                          //!< Time after which a timed transition is followed (0 otherwise)
 
     };
 
@@ -57,6 +107,21 @@ namespace emb {
         StateInterfaceCallback onLeave{}; //!< Callback to be called on exit
         StateStepCallback onStep{};       //!< Callback to be called every performStep
 
+        StateName name{};                 //!< Name of the state (for diagnostics)
+
+
+        /**
+         * Destructor
+         */
+        virtual ~State() = default;
+
+#ifdef EMB_EMBEDDED
+
+        /** States are not deleted through the heap, the deleting destructor doesn't refer to it */
+        static void operator delete(void *) { EMB_HEAP_USED(); }
+
+#endif
+
 
         /**
          * The performStep function for the state
@@ -64,6 +129,25 @@ namespace emb {
         virtual void step();
 
 
+        /**
+         * @brief Performs a step without delaying.
+         * The step is only performed when the time step size has passed since the last step. Sub-states are stepped
+         * the same way. Never sleeps.
+         * @return The absolute time (see Timer::absoluteTime) at which poll should be called next (infinity if
+         * nothing is scheduled, i.e. the machine only needs to be polled on new events or inputs)
+         */
+        virtual double poll();
+
+
+        /**
+         * @brief Performs a step without delaying at the given absolute time.
+         * Same as poll(), but the time is given by the caller (e.g. the tick time of a scheduler or a virtual time).
+         * @param now Absolute time
+         * @return The absolute time at which poll should be called next
+         */
+        double poll(double now);
+
+
         /**
          * Returns the timer of the state
          * @return The timer of the state
@@ -78,6 +162,13 @@ namespace emb {
         virtual double getTime() const;
 
 
+        /**
+         * Returns the integer timer of the state (started on activation)
+         * @return The integer timer
+         */
+        const TickTimer *getTickTimer() const;
+
+
         /**
          * Adds a transition to the target state
          * @param condition Condition callback to be checked
@@ -85,6 +176,25 @@ namespace emb {
          */
         virtual void addTransition(TransitionConditionCallback &&condition, State *targetState);
 
+#ifndef EMB_EMBEDDED
+
+        /**
+         * Adds a transition with a declarative guard to the target state
+         * @param guard Guard to be evaluated
+         * @param targetState Target state to be reached
+         */
+        virtual void addTransition(const Guard &guard, State *targetState);
+
+#endif
+
+
+        /**
+         * Adds a transition which is followed when the given event is present
+         * @param event Id of the event
+         * @param targetState Target state to be reached
+         */
+        virtual void addEventTransition(unsigned int event, State *targetState);
+
 
         /**
          * Creates a transition to target state with the condition that given time (after) has passed
@@ -94,6 +204,16 @@ namespace emb {
         virtual void addTimedTransition(double after, State *targetState);
 
 
+        /**
+         * @brief Creates a timed transition with an integer duration.
+         * The condition is evaluated with the integer TickTimer (no floating point arithmetic, wrap-around safe).
+         * The resolution is one millisecond, shorter durations are rounded up.
+         * @param after Duration, e.g. std::chrono::milliseconds(500)
+         * @param targetState Target state to be reached
+         */
+        void addTimedTransition(std::chrono::microseconds after, State *targetState);
+
+
         /**
          * Sets this state to current state
          */
@@ -107,6 +227,42 @@ namespace emb {
         virtual State *createState();
 
 
+        /**
+         * Creates a state of a derived type in the state machine
+         * @return The created state
+         */
+        template<typename T>
+        T *createState() {
+
+#ifdef EMB_EMBEDDED
+
+            // take state from the pool
+            static_assert(sizeof(T) <= sizeof(State) + EMB_STATE_EXTRA_SIZE, "state type exceeds the pool block size (see EMB_STATE_EXTRA_SIZE)");
+            auto memory = _allocateState(sizeof(T));
+            if(memory == nullptr) {
+                EMB_CAPACITY_EXCEEDED();
+                return nullptr;
+            }
+
+            auto state = new(memory) T;
+            _states.emplace_back(state, PoolDeleter{&_releaseState});
+
+#else
+
+            // create state and add to vector
+            auto state = new T;
+            _states.emplace_back(std::unique_ptr<State>(state));
+
+#endif
+
+            // set parent
+            addState(state);
+
+            return state;
+
+        }
+
+
         /**
          * Adds a state to the state machine
          * @param state State to be added
@@ -128,6 +284,20 @@ namespace emb {
         virtual const State *getParent() const;
 
 
+        /**
+         * Returns the sub-states (created or added)
+         * @return Sub-states
+         */
+        virtual const StateList &getChildren() const;
+
+
+        /**
+         * Returns the transitions starting from this state
+         * @return Transitions
+         */
+        virtual const TransitionVector &getTransitions() const;
+
+
         /**
          * @brief Sets the time step size for each step.
          * Delays the step function until the time step size is reached. Also takes into account the run-time of the
@@ -137,17 +307,134 @@ namespace emb {
         virtual void setTimeStepSize(double timeStepSize);
 
 
+        /**
+         * @brief Sets the time step size with an integer duration.
+         * The delay in step() is then calculated with the integer TickTimer. The resolution is one millisecond.
+         * @param timeStepSize Duration, e.g. std::chrono::milliseconds(10)
+         */
+        void setTimeStepSize(std::chrono::microseconds timeStepSize);
+
+
+        /**
+         * Returns the time step size (the period of the state)
+         * @return Time step size
+         */
+        double getTimeStepSize() const;
+
+
+        /**
+         * @brief Posts an event to the state machine.
+         * The event is queued in the root state machine. Each step of the root takes one event from the queue, which
+         * is then valid for exactly this step.
+         * @param event Event to be posted
+         * @return Flag whether the event could be queued
+         */
+        virtual bool post(const Event &event);
+
+
+        /**
+         * Returns the event which is valid in the current step of the state machine
+         * @return The current event (or nullptr)
+         */
+        virtual const Event *currentEvent() const;
+
+
+        /**
+         * Returns the event queue of the state machine
+         * @return The event queue of the root state
+         */
+        virtual EventQueue *getEventQueue();
+        virtual const EventQueue *getEventQueue() const;
+
+
+        /**
+         * @brief Sets the monitor to which the machine publishes a snapshot after each step
+         * @param monitor Monitor (or nullptr)
+         */
+        void setMonitor(StateMonitor *monitor);
+
+
+        /**
+         * Returns the number of transitions taken by the machine
+         * @return Number of transitions (counted on the root state)
+         */
+        unsigned long getTransitionCount() const;
+
+#ifndef EMB_EMBEDDED
+
+        /**
+         * @brief Sets the evaluation order of the transitions of this state.
+         * With Priority (default), the transitions are checked in insertion order and the first fulfilled one is
+         * taken. With Exclusive or Adaptive, the state declares that at most one condition is fulfilled at a time, so
+         * the transitions are checked by ascending cost per hit (mean guard cost divided by hit rate). Adaptive
+         * counts the hits, samples the guard cost and reorders regularly. Exclusive uses the statistics as they are,
+         * e.g. loaded from a profile.
+         * @param order Evaluation order
+         */
+        void setTransitionOrder(TransitionOrder order);
+
+
+        /**
+         * Returns the evaluation order of the transitions of this state
+         * @return Evaluation order
+         */
+        TransitionOrder getTransitionOrder() const;
+
+
+        /**
+         * @brief Returns the statistics of the transitions (indexed as getTransitions())
+         * @return Statistics (empty as long as the state is priority-ordered)
+         */
+        const std::vector<TransitionStatistics> &getTransitionStatistics() const;
+
+
+        /**
+         * @brief Sets the statistics of the transitions (e.g. from a saved profile) and reorders the transitions
+         * @param statistics Statistics, one per transition (indexed as getTransitions())
+         * @return Flag whether the number of statistics matches the number of transitions
+         */
+        bool setTransitionStatistics(const std::vector<TransitionStatistics> &statistics);
+
+
+        /**
+         * @brief Returns the indices of the transitions in the order they are checked (unless priority-ordered)
+         * @return Transition indices
+         */
+        const std::vector<unsigned int> &getEvaluationOrder() const;
+
+#endif
+
+
     protected:
 
 
         Timer _timer{};                  //!< The timer (is started with entry)
         double _timeStepSize = 0.0;      //!< The time step size of a step (is just delayed)
+        TickTimer _tickTimer{};          //!< Integer timer (is started with entry)
+        Ticks _timeStepTicks = 0;        //!< Integer time step size in milliseconds (0 uses the time step size)
+        double _nextStep = 0.0;          //!< Absolute time of the next step when polled
 
         State *_parent = nullptr;        //!< The parent state machine
 
         StateVector _states{};           //!< Vector of states for memory purposes
+        StateList _children{};           //!< All sub-states
         TransitionVector _transitions{}; //!< All transitions
 
+        EventQueue _events{};            //!< Queued events (used by the root state only)
+        Event _event{};                  //!< Event of the current step
+        bool _hasEvent = false;          //!< Flag whether an event is valid in the current step
+
+        StateMonitor *_monitor = nullptr; //!< Monitor to publish snapshots to (used by the root state only)
+        unsigned long _transitionCount = 0; //!< Number of transitions taken (used by the root state only)
+
+#ifndef EMB_EMBEDDED
+        TransitionOrder _order = TransitionOrder::Priority;    //!< Evaluation order of the transitions
+        std::vector<unsigned int> _evaluationOrder{};         //!< Transition indices in evaluation order
+        std::vector<TransitionStatistics> _statistics{};      //!< Statistics per transition (unless priority-ordered)
+        unsigned long _checks = 0;                            //!< Number of transition checks (adaptive only)
+        std::vector<State *> _idleStates{};                   //!< States waiting to release resources (root only)
+#endif
+
 
         /** Activates the state */
         virtual void _activate();
@@ -161,10 +448,91 @@ namespace emb {
         /** Call exit function */
         virtual void _exit(const Transition *transition);
 
-        /** Check the transitions */
+        /** Check the transitions and takes the first fulfilled one */
         virtual bool _checkTransitions();
 
+        /** Returns the first fulfilled transition of this state (nullptr if none) without taking it */
+        virtual const Transition *_findTransition();
+
+        /** Leaves this state and enters the target of the transition */
+        void _takeTransition(const Transition *transition);
+
+#ifndef EMB_EMBEDDED
+
+        /** Returns the first fulfilled mutually exclusive transition in evaluation order (measured when adaptive) */
+        const Transition *_findOrderedTransition();
+
+        /** Adds transitions added after the order was set to the evaluation order and statistics */
+        void _updateOrder();
+
+        /** Sorts the evaluation order by ascending cost per hit */
+        void _sortTransitions();
+
+        /** Lets the waiting states release their resources (root only) */
+        void _releaseIdle(double now);
+
+        /** Registers the state at the root to be asked to release its resources in the following steps */
+        void _scheduleRelease();
+
+        /** Removes the sub-states of this state from the root's release list (before they are destroyed) */
+        void _cancelRelease();
+
+        /** Releases resources of the inactive state, returns whether the state can be removed from the release list */
+        virtual bool _release(double now);
+
+#endif
+
+        /** Takes the next event of the queue, the payload of the last event is released when there is none (root only) */
+        void _takeEvent();
+
+        /** Run the step function */
+        virtual void _run();
+
+        /** Performs a non-blocking step at the given absolute time, returns the next deadline */
+        virtual double _poll(double now);
+
+        /** Returns the earliest absolute time at which the state or its active sub-states need to be stepped */
+        virtual double _deadline(double now) const;
+
+        /** Returns the transition to be taken on the active path without changing the machine, the event must have been taken (root only) */
+        const Transition *_prepareStep();
+
+        /** Runs the step callbacks down to the source of the transition and takes it (root only) */
+        void _commitStep(const Transition *transition);
+
+        /** Returns the root state */
+        State *_root();
+
+        /** Returns whether the state is on the active path */
+        bool _isActive() const;
+
+        /** Returns whether the given state is this state or one of its sub-states (recursively) */
+        bool _contains(const State *state) const;
+
+        /** Publishes the snapshot to the monitor (root only) */
+        void _publish();
+
+        /** Adds a transition to the transition vector */
+        void _createTransition(State *targetState, TransitionConditionCallback &&condition, double after);
+
+#ifdef EMB_EMBEDDED
+
+        /** Takes a state block from the static pool (nullptr if exhausted or too small) */
+        static void *_allocateState(unsigned long size);
+
+        /** Returns a state block to the static pool */
+        static void _releaseState(void *memory);
+
+#endif
+
         State *_currentState = nullptr;
+
+#ifndef EMB_EMBEDDED
+        friend struct LazyState;          // enters its initial sub-state
+        friend class MachineGroup;        // steps machines in two phases
+        friend class GraphOptimizer;      // removes transitions and states
+        friend class HotSwap;             // moves the active path to a new definition
+#endif
     };
 
 }
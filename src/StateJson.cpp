@@ -0,0 +1,353 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+#include <cmath>
+#include <limits>
+#include "StateJson.h"
+
+using namespace emb;
+
+
+namespace {
+
+    // converts a JSON number to an unsigned integer, fails if it is not integral, negative or too large
+    template<typename T>
+    bool toUnsigned(double number, T &value) {
+
+        if(!(number >= 0.0) || number != std::floor(number)
+           || number >= std::ldexp(1.0, std::numeric_limits<T>::digits))
+            return false;
+
+        value = (T) number;
+        return true;
+
+    }
+
+
+    long configure(State &state, const JsonString &name, double value) {
+
+        long count = 0;
+
+        // set parameter of the own transitions
+        for(auto &t : state.getTransitions()) {
+
+            if(!t->guard)
+                continue;
+
+            // find parameter without allocating a string
+            for(auto &p : t->guard->parameters()) {
+
+                if(p.size() == name.size && p.compare(0, p.size(), name.data, name.size) == 0) {
+                    t->guard->setParameter(p, value);
+                    count++;
+                }
+
+            }
+
+        }
+
+        // sub-states
+        for(auto s : state.getChildren())
+            count += configure(*s, name, value);
+
+        return count;
+
+    }
+
+
+    void writeProfile(JsonWriter &writer, const State &state, unsigned long &index) {
+
+        auto &statistics = state.getTransitionStatistics();
+        if(!statistics.empty()) {
+
+            writer.beginObject();
+            writer.key("state").value(index);
+            writer.key("name").value(state.name.c_str(), state.name.size());
+            writer.key("transitions").beginArray();
+
+            for(auto &s : statistics)
+                writer.beginArray().value(s.evaluations).value(s.hits).value(s.cost).endArray();
+
+            writer.endArray();
+            writer.endObject();
+
+        }
+
+        // sub-states in pre-order
+        index++;
+        for(auto s : state.getChildren())
+            writeProfile(writer, *s, index);
+
+    }
+
+
+    State *findState(State &state, unsigned long target, unsigned long &index) {
+
+        if(index++ == target)
+            return &state;
+
+        for(auto s : state.getChildren()) {
+
+            auto found = findState(*s, target, index);
+            if(found != nullptr)
+                return found;
+
+        }
+
+        return nullptr;
+
+    }
+
+
+    // reads the transitions of a profile entry after the opening bracket
+    bool readStatistics(JsonReader &reader, std::vector<TransitionStatistics> &statistics) {
+
+        JsonToken token;
+        while((token = reader.next()) == JsonToken::BeginArray) {
+
+            // [evaluations, hits, cost]
+            double values[3];
+            for(auto &v : values) {
+
+                if(reader.next() != JsonToken::Number)
+                    return false;
+
+                v = reader.number();
+
+            }
+
+            if(reader.next() != JsonToken::EndArray)
+                return false;
+
+            TransitionStatistics entry{0, 0, values[2]};
+            if(!toUnsigned(values[0], entry.evaluations) || !toUnsigned(values[1], entry.hits))
+                return false;
+
+            statistics.push_back(entry);
+
+        }
+
+        return token == JsonToken::EndArray;
+
+    }
+
+}
+
+
+void emb::writeSnapshot(JsonWriter &writer, const State &machine) {
+
+    writer.beginObject();
+    writer.key("name").value(machine.name.c_str(), machine.name.size());
+    writer.key("time").value(machine.getTime());
+    writer.key("events").value(machine.getEventQueue()->size());
+
+    // active path
+    writer.key("active").beginArray();
+    for(auto s = machine.currentState(); s != nullptr; s = s->currentState()) {
+
+        writer.beginObject();
+        writer.key("name").value(s->name.c_str(), s->name.size());
+        writer.key("time").value(s->getTime());
+        writer.endObject();
+
+    }
+
+    writer.endArray();
+    writer.endObject();
+
+}
+
+
+long emb::configureGuards(State &machine, const char *data, unsigned long size) {
+
+    JsonReader reader(data, size);
+    long count = 0;
+
+    // must be an object
+    if(reader.next() != JsonToken::BeginObject)
+        return -1;
+
+    while(true) {
+
+        // read key
+        auto token = reader.next();
+        if(token == JsonToken::EndObject)
+            break;
+        else if(token != JsonToken::Key)
+            return -1;
+
+        auto name = reader.string();
+
+        // read value
+        if(reader.next() != JsonToken::Number)
+            return -1;
+
+        count += configure(machine, name, reader.number());
+
+    }
+
+    return reader.next() == JsonToken::End ? count : -1;
+
+}
+
+
+void emb::writeTransitionProfile(JsonWriter &writer, const State &machine) {
+
+    unsigned long index = 0;
+
+    writer.beginArray();
+    writeProfile(writer, machine, index);
+    writer.endArray();
+
+}
+
+
+long emb::loadTransitionProfile(State &machine, const char *data, unsigned long size) {
+
+    JsonReader reader(data, size);
+    std::vector<TransitionStatistics> statistics{};
+    long count = 0;
+
+    // must be an array of objects
+    if(reader.next() != JsonToken::BeginArray)
+        return -1;
+
+    JsonToken token;
+    while((token = reader.next()) == JsonToken::BeginObject) {
+
+        double index = -1.0;
+        JsonString name{nullptr, 0};
+        statistics.clear();
+
+        // members in any order
+        while((token = reader.next()) == JsonToken::Key) {
+
+            auto key = reader.string();
+            token = reader.next();
+
+            if(key.equals("state") && token == JsonToken::Number)
+                index = reader.number();
+            else if(key.equals("name") && token == JsonToken::String)
+                name = reader.string();
+            else if(key.equals("transitions") && token == JsonToken::BeginArray) {
+                if(!readStatistics(reader, statistics))
+                    return -1;
+            } else if(!reader.skip(token))
+                return -1;
+
+        }
+
+        if(token != JsonToken::EndObject)
+            return -1;
+
+        // find the state and check its name
+        unsigned long counter = 0, position = 0;
+        auto state = toUnsigned(index, position) ? findState(machine, position, counter) : nullptr;
+        if(state == nullptr || name.data == nullptr || state->name.size() != name.size
+           || state->name.compare(0, name.size, name.data, name.size) != 0)
+            continue;
+
+        if(state->setTransitionStatistics(statistics))
+            count++;
+
+    }
+
+    if(token != JsonToken::EndArray || reader.next() != JsonToken::End)
+        return -1;
+
+    return count;
+
+}
+
+
+void JsonEventMap::add(const std::string &name, unsigned int id) {
+
+    _events.emplace_back(name, id);
+
+}
+
+
+bool JsonEventMap::read(const char *data, unsigned long size, Event &event) const {
+
+    JsonReader reader(data, size);
+
+    // must be an object
+    if(reader.next() != JsonToken::BeginObject)
+        return false;
+
+    while(true) {
+
+        // read key
+        if(reader.next() != JsonToken::Key)
+            return false;
+
+        // skip other members
+        if(!reader.string().equals("event")) {
+
+            if(!reader.skip(reader.next()))
+                return false;
+
+            continue;
+
+        }
+
+        // event by id
+        auto token = reader.next();
+        if(token == JsonToken::Number) {
+
+            unsigned int id;
+            if(!toUnsigned(reader.number(), id))
+                return false;
+
+            event = Event{id, nullptr};
+            return true;
+
+        }
+
+        // event by name
+        if(token != JsonToken::String)
+            return false;
+
+        auto &name = reader.string();
+        for(auto &e : _events) {
+
+            if(e.first.size() == name.size && e.first.compare(0, e.first.size(), name.data, name.size) == 0) {
+                event = Event{e.second, nullptr};
+                return true;
+            }
+
+        }
+
+        return false;
+
+    }
+
+}
+
+
+bool JsonEventMap::post(State &machine, const char *data, unsigned long size) const {
+
+    Event event{0};
+    return read(data, size, event) && machine.post(event);
+
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+
+#ifndef STATE_MACHINE_STATE_JSON_H
+#define STATE_MACHINE_STATE_JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "Json.h"
+#include "State.h"
+
+namespace emb {
+
+    /**
+     * @brief Writes a snapshot of the machine: name, time and queued events of the root and the active state path.
+     * @param writer Writer to be written to
+     * @param machine Root state of the machine
+     */
+    void writeSnapshot(JsonWriter &writer, const State &machine);
+
+
+    /**
+     * @brief Sets the guard parameters of all transitions of the machine from a JSON object.
+     * Every member of the object (e.g. `{"limit": 80, "delay": 2.5}`) is set to the parameters of the same name.
+     * @param machine Root state of the machine
+     * @param data JSON text
+     * @param size Length of the text
+     * @return Number of parameters set (or -1 if the text is not a valid object of numbers)
+     */
+    long configureGuards(State &machine, const char *data, unsigned long size);
+
+
+    /**
+     * @brief Writes the transition statistics of all states which are not priority-ordered (see
+     * State::setTransitionOrder), e.g. `[{"state": 3, "name": "Heating", "transitions": [[1200, 14, 2.5e-07]]}]`.
+     * States are identified by their index in depth-first pre-order (root 0) and their name. Each transition is
+     * written as [evaluations, hits, cost].
+     * @param writer Writer to be written to
+     * @param machine Root state of the machine
+     */
+    void writeTransitionProfile(JsonWriter &writer, const State &machine);
+
+
+    /**
+     * @brief Loads transition statistics written by writeTransitionProfile and reorders the transitions.
+     * Entries whose state index, name or number of transitions do not match the machine are skipped.
+     * @param machine Root state of the machine
+     * @param data JSON text
+     * @param size Length of the text
+     * @return Number of states loaded (or -1 if the text is not a valid profile)
+     */
+    long loadTransitionProfile(State &machine, const char *data, unsigned long size);
+
+
+    /**
+     * @brief Maps JSON messages to events.
+     * A message is an object with the member `event` holding the name or the id of the event,
+     * e.g. `{"event": "pumpOn"}`. Other members are ignored.
+     */
+    class JsonEventMap {
+
+    protected:
+
+        std::vector<std::pair<std::string, unsigned int>> _events{}; //!< Names and ids of the events
+
+    public:
+
+        /**
+         * @brief Adds an event name
+         * @param name Name of the event
+         * @param id Id of the event
+         */
+        void add(const std::string &name, unsigned int id);
+
+
+        /**
+         * @brief Reads the event from the message
+         * @param data JSON text
+         * @param size Length of the text
+         * @param event Event to be written to
+         * @return Flag whether the message contained a known event
+         */
+        bool read(const char *data, unsigned long size, Event &event) const;
+
+
+        /**
+         * @brief Reads the event from the message and posts it to the machine
+         * @param machine State machine
+         * @param data JSON text
+         * @param size Length of the text
+         * @return Flag whether the message contained a known event and it was queued
+         */
+        bool post(State &machine, const char *data, unsigned long size) const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_STATE_JSON_H
@@ -0,0 +1,298 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-24.
+//
+
+#include <algorithm>
+#include "Monitor.h"
+#include "Swap.h"
+
+using namespace emb;
+
+
+namespace {
+
+    // path of names (index among the sub-states for unnamed states)
+    std::string namePath(const State *state) {
+
+        std::string path{};
+        for(auto s = state; s->getParent() != nullptr; s = s->getParent()) {
+
+            auto &siblings = s->getParent()->getChildren();
+            auto name = s->name.empty()
+                    ? "#" + std::to_string(std::find(siblings.begin(), siblings.end(), s) - siblings.begin())
+                    : s->name;
+
+            path = path.empty() ? name : name + "." + path;
+
+        }
+
+        return path;
+
+    }
+
+
+    void collect(State *state, std::vector<State *> &states) {
+
+        states.push_back(state);
+        for(auto s : state->getChildren())
+            collect(s, states);
+
+    }
+
+}
+
+
+StateMapping emb::mapByName(State *machine) {
+
+    auto paths = std::make_shared<std::unordered_map<std::string, State *>>();
+
+    std::vector<State *> states{};
+    collect(machine, states);
+    for(auto s : states)
+        (*paths)[namePath(s)] = s;
+
+    return [paths](const State *state) -> State * {
+        auto it = paths->find(namePath(state));
+        return it != paths->end() ? it->second : nullptr;
+    };
+
+}
+
+
+HotSwap::HotSwap(std::unique_ptr<State> machine)
+        : _active(new Definition{std::shared_ptr<State>(std::move(machine)), nullptr, {}}) {
+
+    _current = _active->machine;
+
+}
+
+
+State *HotSwap::machine() const {
+
+    return _active->machine.get();
+
+}
+
+
+std::shared_ptr<State> HotSwap::acquire() const {
+
+    return std::atomic_load(&_current);
+
+}
+
+
+bool HotSwap::prepare(std::unique_ptr<State> machine, const StateMapping &mapping, std::string *error) {
+
+    auto fail = [error](const std::string &message) {
+        if(error != nullptr)
+            *error = message;
+        return false;
+    };
+
+    if(!machine)
+        return fail("no machine");
+
+    // the base stays alive during the validation
+    auto base = acquire();
+    std::unique_ptr<Definition> next{new Definition{std::shared_ptr<State>(std::move(machine)), base.get(), {}}};
+    auto root = next->machine.get();
+
+    std::vector<State *> states{};
+    collect(root, states);
+    std::unordered_map<const State *, bool> known{};
+    for(auto s : states)
+        known[s] = true;
+
+    // map the states of the base (parents first)
+    states.clear();
+    collect(base.get(), states);
+    next->map[base.get()] = root;
+
+    for(unsigned long i = 1; i < states.size(); ++i) {
+
+        auto state = states[i];
+        auto target = mapping(state);
+
+        if(target == nullptr || known.count(target) == 0 || target == root)
+            return fail("state " + namePath(state) + " is not mapped to a state of the new machine");
+
+        // the mapping of the parent must contain the target
+        auto parent = next->map[state->getParent()];
+        auto ancestor = target->getParent();
+        while(ancestor != nullptr && ancestor != parent)
+            ancestor = ancestor->getParent();
+
+        if(ancestor == nullptr)
+            return fail("state " + namePath(state) + " is not mapped below the mapping of its parent");
+
+        next->map[state] = target;
+
+    }
+
+    // hand over (a replaced pending definition is destroyed outside of the lock)
+    std::lock_guard<std::mutex> lock(_mutex);
+    _retired.reserve(_retired.size() + 2);
+    std::swap(_pending, next);
+
+    return true;
+
+}
+
+
+bool HotSwap::update() {
+
+    // never wait for the builder
+    std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+    if(!lock.owns_lock() || !_pending)
+        return false;
+
+    std::unique_ptr<Definition> next{};
+    std::swap(next, _pending);
+
+    // validated against the running definition
+    if(next->base != _active->machine.get() || !_transfer(_active->machine.get(), *next)) {
+        _retired.push_back(std::move(next));
+        _rejected++;
+        return false;
+    }
+
+    // publish, the replaced definition is destroyed by reclaim()
+    std::atomic_store(&_current, next->machine);
+    _retired.push_back(std::move(_active));
+    _active = std::move(next);
+    _swaps++;
+
+    // everything else referring to the replaced definition moves now
+    if(onSwap)
+        onSwap(_retired.back()->machine.get(), _active->machine.get());
+
+    return true;
+
+}
+
+
+void HotSwap::step() {
+
+    update();
+    _active->machine->step();
+
+}
+
+
+double HotSwap::poll(double now) {
+
+    update();
+    return _active->machine->poll(now);
+
+}
+
+
+unsigned long HotSwap::reclaim() {
+
+    std::vector<std::unique_ptr<Definition>> unused{};
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // referenced by the retired list only
+        for(auto &d : _retired) {
+            if(d->machine.use_count() == 1)
+                unused.push_back(std::move(d));
+        }
+
+        _retired.erase(std::remove(_retired.begin(), _retired.end(), nullptr), _retired.end());
+    }
+
+    return unused.size();
+
+}
+
+
+unsigned long HotSwap::swaps() const {
+
+    return _swaps;
+
+}
+
+
+unsigned long HotSwap::rejected() const {
+
+    return _rejected;
+
+}
+
+
+bool HotSwap::_transfer(State *from, Definition &to) {
+
+    auto root = to.machine.get();
+
+    // active leaf of the running machine
+    auto leaf = from;
+    while(leaf->_currentState != nullptr)
+        leaf = leaf->_currentState;
+
+    auto target = to.map.find(leaf);
+    if(target == to.map.end())
+        return false;
+
+    // clear an active path of the new definition
+    for(auto s = root; s != nullptr; ) {
+        auto next = s->_currentState;
+        s->_currentState = nullptr;
+        s = next;
+    }
+
+    // activate the path to the mapped leaf (states without counterpart start their timers)
+    for(auto s = target->second; s != root; s = s->_parent) {
+        s->_parent->_currentState = s;
+        s->_timer.start();
+        s->_tickTimer.start();
+        s->_nextStep = 0.0;
+    }
+
+    // keep the timers of the mapped states (the deeper state wins when states are merged)
+    for(auto s = from; s != nullptr; s = s->_currentState) {
+
+        auto mapped = to.map.find(s);
+        if(mapped == to.map.end() || !mapped->second->_isActive())
+            continue;
+
+        mapped->second->_timer = s->_timer;
+        mapped->second->_tickTimer = s->_tickTimer;
+        mapped->second->_nextStep = s->_nextStep;
+
+    }
+
+    // the event queue (with its events, policies and counters) and the counters of the root
+    std::swap(from->_events, root->_events);
+
+    root->_transitionCount = from->_transitionCount;
+
+    // the monitor follows only if it can re-index the new definition
+    auto monitor = from->_monitor;
+    from->_monitor = nullptr;
+    root->_monitor = monitor != nullptr && monitor->rebind(*from, *root) ? monitor : nullptr;
+    root->_publish();
+
+    return true;
+
+}
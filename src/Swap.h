@@ -0,0 +1,176 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-24.
+//
+
+
+#ifndef STATE_MACHINE_SWAP_H
+#define STATE_MACHINE_SWAP_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    typedef std::function<State *(const State *state)> StateMapping; //!< Type definition for mappings of the states of a running machine to a new definition
+    typedef std::function<void (State *from, State *to)> SwapCallback; //!< Type definition for callbacks after a swap
+
+
+    /**
+     * @brief Creates a mapping to the states of the given machine with the same path of names.
+     * Unnamed states are identified by their index among the sub-states of their parent.
+     * @param machine Root state of the new definition
+     * @return Mapping
+     */
+    StateMapping mapByName(State *machine);
+
+
+    /**
+     * @brief Exchange of a machine definition at runtime (read-copy-update).
+     * A new definition is built on another thread and handed over with prepare(), which validates it against the
+     * running definition with a state mapping (every state must be mapped into the new machine, below the mapping of
+     * its parent) and builds the lookup table. The control thread calls update() at a tick boundary (step() and
+     * poll() do it before stepping): the active path is moved to the mapped states keeping their timers, the event
+     * queue (with the queued events) and the transition counter are moved to the new root, and the new definition is
+     * published. No state callbacks are run. update() neither blocks (a pending definition is taken on the next tick
+     * when the lock is busy) nor allocates or destroys anything (apart from a monitor re-indexing the states), so a
+     * swap costs a few table lookups. Replaced definitions are retired and destroyed by reclaim() on another thread
+     * once no reader (acquire()) references them anymore.
+     * The monitor of the machine is asked to follow the new definition (StateMonitor::rebind, a ShmPublisher slot
+     * re-indexes the states) and is detached from the replaced one. Everything else referring to the replaced root
+     * (e.g. a Recorder or SeriesRecorder, see RecordMachine::rebind) must be moved in onSwap, since the replaced
+     * definition is destroyed by reclaim().
+     * The structure of the running definition must not change while a new one is prepared (e.g. by a LazyState).
+     */
+    class HotSwap {
+
+    protected:
+
+        struct Definition {
+            std::shared_ptr<State> machine;                   //!< Root state
+            const State *base;                                //!< Definition the mapping was validated against
+            std::unordered_map<const State *, State *> map;   //!< States of the base mapped to this definition
+        };
+
+        std::unique_ptr<Definition> _active;                  //!< Running definition (control thread)
+        std::shared_ptr<State> _current{};                    //!< Running definition for readers (atomic access)
+        std::unique_ptr<Definition> _pending{};               //!< Definition waiting for the swap
+        std::vector<std::unique_ptr<Definition>> _retired{};  //!< Replaced definitions waiting for reclamation
+        std::mutex _mutex{};                                  //!< Protects the pending and retired definitions
+
+        unsigned long _swaps = 0;                             //!< Number of swaps
+        unsigned long _rejected = 0;                          //!< Number of definitions rejected at the swap
+
+
+        /** Moves the active path, timers and events of the running machine to the new definition */
+        static bool _transfer(State *from, Definition &to);
+
+    public:
+
+        SwapCallback onSwap{};    //!< Callback to be called on the control thread after a swap (replaced and new root)
+
+
+        /**
+         * @brief Takes over the machine
+         * @param machine Root state of the initial definition
+         */
+        explicit HotSwap(std::unique_ptr<State> machine);
+
+        HotSwap(const HotSwap &) = delete;
+        HotSwap &operator=(const HotSwap &) = delete;
+
+
+        /**
+         * Returns the running machine (control thread, changes with update())
+         * @return Root state
+         */
+        State *machine() const;
+
+
+        /**
+         * @brief Returns the running definition for other threads, kept alive while the pointer is held
+         * @return Root state
+         */
+        std::shared_ptr<State> acquire() const;
+
+
+        /**
+         * @brief Validates a new definition and hands it over for the next update (replaces a pending one)
+         * @param machine Root state of the new definition
+         * @param mapping Mapping of the states of the running definition to states of the new one
+         * @param error Description of the first validation error (optional)
+         * @return Flag whether the definition is valid
+         */
+        bool prepare(std::unique_ptr<State> machine, const StateMapping &mapping, std::string *error = nullptr);
+
+
+        /**
+         * @brief Switches to the pending definition (control thread, at a tick boundary)
+         * @return Flag whether the definition was switched
+         */
+        bool update();
+
+
+        /**
+         * @brief Switches to a pending definition and steps the machine
+         */
+        void step();
+
+
+        /**
+         * @brief Switches to a pending definition and polls the machine
+         * @param now Absolute time
+         * @return The next deadline
+         */
+        double poll(double now);
+
+
+        /**
+         * @brief Destroys retired definitions which are not referenced anymore (not on the control thread)
+         * @return Number of destroyed definitions
+         */
+        unsigned long reclaim();
+
+
+        /**
+         * Returns the number of swaps
+         * @return Number of swaps
+         */
+        unsigned long swaps() const;
+
+
+        /**
+         * Returns the number of definitions rejected at the swap (validated against a replaced definition or the
+         * active state was not known at validation)
+         * @return Number of rejected definitions
+         */
+        unsigned long rejected() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_SWAP_H
@@ -24,12 +24,46 @@
 #include "Framework.h"
 #include "Timer.h"
 
+#ifdef EMB_EMBEDDED
+#define EMB_THREAD_LOCAL
+#else
+#define EMB_THREAD_LOCAL thread_local
+#endif
+
+
+namespace {
+
+    EMB_THREAD_LOCAL bool virtualClock = false;
+    EMB_THREAD_LOCAL double virtualTime = 0.0;
+
+}
+
+
 double emb::Timer::absoluteTime() {
 
+    // virtual time
+    if(virtualClock)
+        return virtualTime;
+
     return (double) Framework::getMilliseconds() * 1e-3;
 
 }
 
+
+void emb::Timer::setVirtualTime(double time) {
+
+    virtualClock = true;
+    virtualTime = time;
+
+}
+
+
+void emb::Timer::resetVirtualTime() {
+
+    virtualClock = false;
+
+}
+
 void emb::Timer::start() {
 
     // resume, when paused
@@ -95,4 +129,110 @@ void emb::Timer::delay(double seconds) {
 
     Framework::delay((long long int) (seconds * 1000.0));
 
-}
\ No newline at end of file
+}
+
+
+emb::Ticks emb::TickTimer::now() {
+
+    // virtual time
+    if(virtualClock)
+        return (Ticks) (long long) (virtualTime * 1000.0 + 0.5);
+
+    return (Ticks) Framework::getMilliseconds();
+
+}
+
+
+emb::Ticks emb::TickTimer::elapsed(Ticks from, Ticks to) {
+
+    // modulo arithmetic handles the wrap-around
+    return (Ticks) (to - from);
+
+}
+
+
+bool emb::TickTimer::reached(Ticks now, Ticks deadline) {
+
+    // the difference is below half the range when the deadline has passed
+    return (Ticks) (now - deadline) < (Ticks) ((Ticks) ~(Ticks) 0 / 2 + 1);
+
+}
+
+
+void emb::TickTimer::delay(Ticks milliseconds) {
+
+    Framework::delay((long long int) milliseconds);
+
+}
+
+
+void emb::TickTimer::start() {
+
+    // resume, when paused
+    if(_paused)
+        return resume();
+
+    startWithOffset(0);
+
+}
+
+
+void emb::TickTimer::startWithOffset(Ticks offset) {
+
+    _startTicks = (Ticks) (now() - offset);
+    _paused = false;
+
+}
+
+
+void emb::TickTimer::stop() {
+
+    _startTicks = 0;
+    _pauseTicks = 0;
+    _paused = false;
+
+}
+
+
+void emb::TickTimer::pause() {
+
+    _pauseTicks = now();
+    _paused = true;
+
+}
+
+
+void emb::TickTimer::resume() {
+
+    // restart with time-at-pause as offset
+    startWithOffset(elapsed(_startTicks, _pauseTicks));
+
+}
+
+
+emb::Ticks emb::TickTimer::milliseconds() const {
+
+    return milliseconds(_paused ? _pauseTicks : now());
+
+}
+
+
+emb::Ticks emb::TickTimer::milliseconds(Ticks clock) const {
+
+    return elapsed(_startTicks, _paused ? _pauseTicks : clock);
+
+}
+
+
+unsigned long long emb::TickTimer::microseconds() const {
+
+    return (unsigned long long) milliseconds() * 1000ull;
+
+}
+
+
+bool emb::TickTimer::isPaused() const {
+
+    return _paused;
+
+}
@@ -27,6 +27,8 @@
 
 namespace emb {
 
+    typedef unsigned long Ticks; //!< Milliseconds of the framework clock (wraps around, e.g. after 49 days on 32 bit)
+
     class Timer {
 
     protected:
@@ -44,6 +46,21 @@ namespace emb {
         static double absoluteTime();
 
 
+        /**
+         * @brief Freezes the absolute time of the calling thread at the given value.
+         * Used to run machines on a virtual time (e.g. when replaying a recording). Timers started and read on this
+         * thread use the virtual time until resetVirtualTime() is called.
+         * @param time Virtual absolute time in seconds
+         */
+        static void setVirtualTime(double time);
+
+
+        /**
+         * @brief Switches the calling thread back to the clock framework.
+         */
+        static void resetVirtualTime();
+
+
         /**
          * @brief Starts the timer.
          * Sets the local timer time origin to the current actual time. The timer can be reset by calling this method
@@ -104,6 +121,117 @@ namespace emb {
 
     };
 
+
+    /**
+     * @brief Timer in integer milliseconds (no floating point arithmetic).
+     * Uses the millisecond clock of the framework. All differences are calculated with unsigned (modulo) arithmetic,
+     * so the timer is correct across a wrap-around of the clock as long as a measured duration is shorter than the
+     * range of Ticks.
+     */
+    class TickTimer {
+
+    protected:
+
+        Ticks _startTicks = 0;   //!< Clock at start
+        Ticks _pauseTicks = 0;   //!< Clock at pause
+        bool _paused = false;    //!< Flag whether the timer is paused
+
+    public:
+
+        /**
+         * @brief Returns the clock of the framework (or the virtual time, see Timer::setVirtualTime)
+         * @return Clock in milliseconds
+         */
+        static Ticks now();
+
+
+        /**
+         * @brief Returns the duration between two clock values (wrap-around safe)
+         * @param from Earlier clock value
+         * @param to Later clock value
+         * @return Duration in milliseconds
+         */
+        static Ticks elapsed(Ticks from, Ticks to);
+
+
+        /**
+         * @brief Returns whether the deadline is reached (wrap-around safe, the deadline must be less than half the
+         * range of Ticks ahead)
+         * @param now Clock value
+         * @param deadline Deadline
+         * @return Flag
+         */
+        static bool reached(Ticks now, Ticks deadline);
+
+
+        /**
+         * @brief Delays the execution
+         * @param milliseconds Delay in milliseconds
+         */
+        static void delay(Ticks milliseconds);
+
+
+        /**
+         * @brief Starts the timer (resumes when paused)
+         */
+        void start();
+
+
+        /**
+         * @brief Starts the timer with an initial offset
+         * @param offset Offset in milliseconds
+         */
+        void startWithOffset(Ticks offset);
+
+
+        /**
+         * @brief Stops the timer
+         */
+        void stop();
+
+
+        /**
+         * @brief Pauses the timer
+         */
+        void pause();
+
+
+        /**
+         * @brief Resumes the paused timer
+         */
+        void resume();
+
+
+        /**
+         * @brief Returns the time since start
+         * @return Time in milliseconds
+         */
+        Ticks milliseconds() const;
+
+
+        /**
+         * @brief Returns the time since start at the given clock value
+         * @param clock Clock value
+         * @return Time in milliseconds
+         */
+        Ticks milliseconds(Ticks clock) const;
+
+
+        /**
+         * @brief Returns the time since start
+         * @return Time in microseconds (millisecond resolution)
+         */
+        unsigned long long microseconds() const;
+
+
+        /**
+         * @brief Returns whether the timer is paused
+         * @return Pause flag
+         */
+        bool isPaused() const;
+
+    };
+
 }
 
 #endif // STATE_MACHINE_TIMER_H
@@ -0,0 +1,288 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-29.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Trace.h"
+
+using namespace emb;
+
+
+namespace {
+
+    struct Buffer {
+
+        std::vector<TraceRecord> records;
+        unsigned long head;
+        unsigned long count;
+        unsigned long dropped;
+        unsigned long thread;
+        const char *name;
+        std::unordered_set<std::string> names;               // interned names (stable, never removed)
+        std::unordered_map<const char *, const char *> cache; // interned name by the last pointer it was passed with
+
+        const char *intern(const char *text) {
+
+            if(text == nullptr)
+                return nullptr;
+
+            // the pointer may have been freed and reused for another name
+            auto it = cache.find(text);
+            if(it != cache.end() && std::strcmp(it->second, text) == 0)
+                return it->second;
+
+            auto interned = names.emplace(text).first->c_str();
+            cache[text] = interned;
+
+            return interned;
+
+        }
+
+        void push(const TraceRecord &record) {
+
+            // overwrite the oldest record when full
+            if(count == records.size()) {
+                records[head] = record;
+                head = (head + 1) % records.size();
+                dropped++;
+                return;
+            }
+
+            records[(head + count) % records.size()] = record;
+            count++;
+
+        }
+
+    };
+
+
+    std::atomic<bool> active{true};
+    std::mutex registryMutex{};
+    std::vector<std::unique_ptr<Buffer>> registry{};
+    thread_local Buffer *local = nullptr;
+
+
+    Buffer *buffer() {
+
+        // register the buffer of this thread once
+        if(local == nullptr) {
+
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.emplace_back(new Buffer{std::vector<TraceRecord>(EMB_TRACE_BUFFER_SIZE), 0, 0, 0,
+                                             registry.size() + 1, nullptr, {}, {}});
+            local = registry.back().get();
+
+        }
+
+        return local;
+
+    }
+
+
+    inline void record(const char *name, const char *category, const void *id, double start, double duration,
+                       char phase) {
+
+        if(!active.load(std::memory_order_relaxed))
+            return;
+
+        auto b = buffer();
+        b->push(TraceRecord{b->intern(name), category, id, start, duration, phase});
+
+    }
+
+}
+
+
+void Trace::enable(bool flag) {
+
+    active = flag;
+
+}
+
+
+bool Trace::enabled() {
+
+    return active;
+
+}
+
+
+double Trace::now() {
+
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+
+
+void Trace::span(const char *name, const char *category, double start, double end) {
+
+    record(name, category, nullptr, start, end - start, 'X');
+
+}
+
+
+void Trace::begin(const char *name, const char *category, const void *id) {
+
+    record(name, category, id, now(), 0.0, 'b');
+
+}
+
+
+void Trace::end(const char *name, const char *category, const void *id) {
+
+    record(name, category, id, now(), 0.0, 'e');
+
+}
+
+
+void Trace::setThreadName(const char *name) {
+
+    auto b = buffer();
+    b->name = b->intern(name);
+
+}
+
+
+unsigned long Trace::size() {
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    unsigned long size = 0;
+    for(auto &b : registry)
+        size += b->count;
+
+    return size;
+
+}
+
+
+unsigned long Trace::dropped() {
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    unsigned long dropped = 0;
+    for(auto &b : registry)
+        dropped += b->dropped;
+
+    return dropped;
+
+}
+
+
+void Trace::clear() {
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    for(auto &b : registry) {
+        b->head = 0;
+        b->count = 0;
+        b->dropped = 0;
+    }
+
+}
+
+
+void Trace::write(JsonWriter &writer) {
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    char id[32];
+
+    writer.beginObject().key("displayTimeUnit").value("ms").key("traceEvents").beginArray();
+
+    for(auto &b : registry) {
+
+        // thread name
+        if(b->name != nullptr) {
+            writer.beginObject().key("name").value("thread_name").key("ph").value("M");
+            writer.key("pid").value(1).key("tid").value(b->thread);
+            writer.key("args").beginObject().key("name").value(b->name).endObject().endObject();
+        }
+
+        for(unsigned long i = 0; i < b->count; ++i) {
+
+            auto &r = b->records[(b->head + i) % b->records.size()];
+            char phase[2] = {r.phase, '\0'};
+
+            writer.beginObject();
+            writer.key("name").value(r.name != nullptr ? r.name : "").key("cat").value(r.category);
+            writer.key("ph").value(phase).key("ts").value(r.start);
+            writer.key("pid").value(1).key("tid").value(b->thread);
+
+            if(r.phase == 'X')
+                writer.key("dur").value(r.duration);
+
+            if(r.id != nullptr) {
+                std::snprintf(id, sizeof(id), "%p", r.id);
+                writer.key("id").value(id);
+            }
+
+            writer.endObject();
+
+        }
+
+    }
+
+    writer.endArray().endObject();
+
+}
+
+
+bool Trace::save(const char *path) {
+
+    auto file = std::fopen(path, "w");
+    if(file == nullptr)
+        return false;
+
+    // stream through a small buffer
+    bool ok = true;
+    char buffer[4096];
+    JsonWriter writer(buffer, sizeof(buffer), [file, &ok](const char *data, unsigned long size) {
+        ok = std::fwrite(data, 1, size, file) == size && ok;
+    });
+
+    write(writer);
+    writer.flush();
+
+    ok = writer.good() && ok;
+    return std::fclose(file) == 0 && ok;
+
+}
+
+
+TraceScope::TraceScope(const char *name, const char *category) :
+    _name(name), _category(category), _start(Trace::now()) {}
+
+
+TraceScope::~TraceScope() {
+
+    Trace::span(_name, _category, _start, Trace::now());
+
+}
@@ -0,0 +1,191 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-29.
+//
+
+
+#ifndef STATE_MACHINE_TRACE_H
+#define STATE_MACHINE_TRACE_H
+
+#ifndef EMB_TRACE_BUFFER_SIZE
+#define EMB_TRACE_BUFFER_SIZE 65536   //!< Number of records per thread (the oldest records are overwritten)
+#endif
+
+// the hooks in the library compile to nothing unless EMB_TRACE is defined (cmake option ENABLE_TRACE)
+#if defined(EMB_TRACE) && !defined(EMB_EMBEDDED)
+#define EMB_TRACE_SCOPE(name, category) emb::TraceScope _embTraceScope(name, category)
+#define EMB_TRACE_BEGIN(name, category, id) emb::Trace::begin(name, category, id)
+#define EMB_TRACE_END(name, category, id) emb::Trace::end(name, category, id)
+#else
+#define EMB_TRACE_SCOPE(name, category)
+#define EMB_TRACE_BEGIN(name, category, id)
+#define EMB_TRACE_END(name, category, id)
+#endif
+
+// not available in the embedded profile
+#ifndef EMB_EMBEDDED
+
+#include "Json.h"
+
+namespace emb {
+
+    struct TraceRecord {
+
+        const char *name;       //!< Name (interned by the trace)
+        const char *category;   //!< Category (must outlive the export, e.g. a literal)
+        const void *id;         //!< Id of an asynchronous span
+        double start;           //!< Start time in microseconds
+        double duration;        //!< Duration in microseconds (complete spans only)
+        char phase;             //!< Chrome trace phase ('X' complete, 'b' async begin, 'e' async end)
+
+    };
+
+
+    /**
+     * @brief Collects trace records in per-thread buffers and exports them as Chrome trace-event JSON.
+     * The JSON can be opened in chrome://tracing and the Perfetto UI. Callbacks and guard evaluations are recorded
+     * as complete spans on the thread, state residencies as asynchronous spans (one track per state). Recording takes
+     * no lock; the export must not run while threads are recording. Names are copied into a string table of the
+     * recording thread on first use, so states may be destroyed before the export.
+     */
+    class Trace {
+
+    public:
+
+        /**
+         * @brief Enables or disables recording at run-time
+         * @param flag Flag
+         */
+        static void enable(bool flag);
+
+
+        /**
+         * @brief Returns whether recording is enabled
+         * @return Flag
+         */
+        static bool enabled();
+
+
+        /**
+         * @brief Returns the trace clock
+         * @return Time in microseconds (monotonic)
+         */
+        static double now();
+
+
+        /**
+         * @brief Records a complete span
+         * @param name Name
+         * @param category Category
+         * @param start Start time (see now())
+         * @param end End time (see now())
+         */
+        static void span(const char *name, const char *category, double start, double end);
+
+
+        /**
+         * @brief Records the begin of an asynchronous span
+         * @param name Name
+         * @param category Category
+         * @param id Id to match begin and end
+         */
+        static void begin(const char *name, const char *category, const void *id);
+
+
+        /**
+         * @brief Records the end of an asynchronous span
+         * @param name Name
+         * @param category Category
+         * @param id Id to match begin and end
+         */
+        static void end(const char *name, const char *category, const void *id);
+
+
+        /**
+         * @brief Sets the name of the calling thread in the export
+         * @param name Name (copied)
+         */
+        static void setThreadName(const char *name);
+
+
+        /**
+         * @brief Returns the number of buffered records of all threads
+         * @return Number of records
+         */
+        static unsigned long size();
+
+
+        /**
+         * @brief Returns the number of overwritten records of all threads
+         * @return Number of records
+         */
+        static unsigned long dropped();
+
+
+        /**
+         * @brief Removes all records
+         */
+        static void clear();
+
+
+        /**
+         * @brief Writes the records as Chrome trace-event JSON object
+         * @param writer JSON writer
+         */
+        static void write(JsonWriter &writer);
+
+
+        /**
+         * @brief Writes the records into a JSON file
+         * @param path File name
+         * @return Flag whether the file could be written
+         */
+        static bool save(const char *path);
+
+    };
+
+
+    /**
+     * @brief Records a complete span from construction to destruction
+     */
+    class TraceScope {
+
+    protected:
+
+        const char *_name;       //!< Name
+        const char *_category;   //!< Category
+        double _start;           //!< Start time
+
+    public:
+
+        TraceScope(const char *name, const char *category);
+        ~TraceScope();
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    };
+
+}
+
+#endif // EMB_EMBEDDED
+
+#endif // STATE_MACHINE_TRACE_H
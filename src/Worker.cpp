@@ -0,0 +1,216 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-12.
+//
+
+#include <utility>
+#include "Worker.h"
+
+using namespace emb;
+
+
+WorkerPool::WorkerPool(unsigned int threads, unsigned long capacity) : _jobs(capacity > 0 ? capacity : 1) {
+
+    // reserve the completions for all queued and running jobs, so workers never allocate under the lock
+    _completions.reserve(_jobs.size() + threads);
+    _delivering.reserve(_jobs.size() + threads);
+
+    for(unsigned int i = 0; i < threads; ++i)
+        _threads.emplace_back(&WorkerPool::_work, this);
+
+}
+
+
+WorkerPool::~WorkerPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _wake.notify_all();
+    for(auto &t : _threads)
+        t.join();
+
+}
+
+
+bool WorkerPool::submit(WorkerJob &&work, State *machine, unsigned int event) {
+
+    {
+        // workers hold the lock only for bookkeeping without allocations
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // queued, running and undelivered jobs are bounded, so the completions never outgrow their reserve
+        auto outstanding = _size + _running.load() + _completions.size();
+        if(_size < _jobs.size() && outstanding < _jobs.size() + _threads.size()) {
+
+            // add to the end of the ring
+            auto &job = _jobs[(_head + _size) % _jobs.size()];
+            job.work = std::move(work);
+            job.machine = machine;
+            job.event = event;
+            _size++;
+
+            _wake.notify_one();
+            return true;
+
+        }
+    }
+
+    // skipped, the machine must not wait for it
+    _rejected++;
+    machine->post(Event{event, nullptr});
+
+    return false;
+
+}
+
+
+unsigned long WorkerPool::deliver() {
+
+    // never wait for the workers
+    {
+        std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+        if(!lock.owns_lock() || _completions.empty())
+            return 0;
+
+        _completions.swap(_delivering);
+    }
+
+    for(auto &c : _delivering)
+        c.machine->post(Event{c.event, nullptr});
+
+    auto count = (unsigned long) _delivering.size();
+    _delivering.clear();
+
+    return count;
+
+}
+
+
+StateInterfaceCallback WorkerPool::action(WorkerJob work, unsigned int event) {
+
+    return [this, work, event](const Transition *transition) {
+        auto copy = work;
+        submit(std::move(copy), transition->to, event);
+    };
+
+}
+
+
+StateStepCallback WorkerPool::stepAction(WorkerJob work, unsigned int event) {
+
+    auto busy = std::make_shared<std::atomic<bool>>(false);
+
+    return [this, work, event, busy](State *state) {
+
+        // previous run not completed yet
+        if(busy->exchange(true))
+            return;
+
+        auto queued = submit([work, busy] {
+
+            // also released when the action fails
+            try {
+                work();
+            } catch(...) {
+                busy->store(false);
+                throw;
+            }
+
+            busy->store(false);
+
+        }, state, event);
+
+        if(!queued)
+            busy->store(false);
+
+    };
+
+}
+
+
+unsigned long WorkerPool::pending() {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _size + _running.load();
+
+}
+
+
+unsigned long WorkerPool::completed() const {
+
+    return _completed.load();
+
+}
+
+
+unsigned long WorkerPool::failed() const {
+
+    return _failed.load();
+
+}
+
+
+unsigned long WorkerPool::rejected() const {
+
+    return _rejected;
+
+}
+
+
+void WorkerPool::_work() {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while(true) {
+
+        _wake.wait(lock, [this] { return _stop || _size > 0; });
+        if(_stop)
+            return;
+
+        // take the oldest job
+        auto job = std::move(_jobs[_head]);
+        _jobs[_head].work = nullptr;
+        _head = (_head + 1) % _jobs.size();
+        _size--;
+        _running++;
+
+        // run without the lock
+        lock.unlock();
+
+        try {
+            job.work();
+        } catch(...) {
+            _failed++;
+        }
+
+        job.work = nullptr;
+        lock.lock();
+
+        _completions.push_back(Completion{job.machine, job.event});
+        _running--;
+        _completed++;
+
+    }
+
+}
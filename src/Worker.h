@@ -0,0 +1,174 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-12.
+//
+
+
+#ifndef STATE_MACHINE_WORKER_H
+#define STATE_MACHINE_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "State.h"
+
+namespace emb {
+
+    typedef std::function<void ()> WorkerJob; //!< Type definition for jobs of the worker pool
+
+
+    /**
+     * @brief Bounded pool of worker threads for slow actions (logging, flash writes, network publishes).
+     * Actions are queued without blocking the control thread and run on the workers. When an action has finished,
+     * its completion event is collected and posted to the machine by deliver(), which the control thread calls
+     * before stepping (the event queues of the machines are not thread-safe). A machine holds in a state until the
+     * action has completed with an event transition on the completion event. When the queue is full, the action is
+     * skipped and the completion event is posted immediately, so a machine never waits for an action which does not
+     * run. Completions which are not delivered yet count as queued. The workers hold the lock only to take a job or
+     * add a completion (without allocations), which bounds the wait of the control thread.
+     */
+    class WorkerPool {
+
+    protected:
+
+        struct Job {
+            WorkerJob work;          //!< The action
+            State *machine;          //!< Machine (or any of its states) to post the completion event to
+            unsigned int event;      //!< Completion event
+        };
+
+        struct Completion {
+            State *machine;          //!< Machine to post the event to
+            unsigned int event;      //!< Completion event
+        };
+
+        std::vector<Job> _jobs;                  //!< Ring buffer of queued jobs
+        unsigned long _head = 0;                 //!< Index of the oldest job
+        unsigned long _size = 0;                 //!< Number of queued jobs
+        std::vector<Completion> _completions{};  //!< Completions waiting for delivery
+        std::vector<Completion> _delivering{};   //!< Completions being delivered (swapped with the above)
+
+        std::mutex _mutex{};                     //!< Protects the jobs and the completions
+        std::condition_variable _wake{};         //!< Wakes the workers
+        std::vector<std::thread> _threads{};     //!< Worker threads
+        bool _stop = false;                      //!< Flag to stop the workers
+
+        std::atomic<unsigned long> _running{0};  //!< Number of running jobs
+        std::atomic<unsigned long> _completed{0}; //!< Number of completed jobs
+        std::atomic<unsigned long> _failed{0};   //!< Number of jobs which threw an exception
+        unsigned long _rejected = 0;             //!< Number of jobs rejected on a full queue (control thread)
+
+
+        /** Runs the jobs (worker thread) */
+        void _work();
+
+    public:
+
+        /**
+         * @brief Starts the workers
+         * @param threads Number of worker threads
+         * @param capacity Maximum number of queued jobs
+         */
+        explicit WorkerPool(unsigned int threads = 1, unsigned long capacity = 16);
+
+
+        /**
+         * @brief Stops the workers after their running jobs (queued jobs are discarded)
+         */
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+
+        /**
+         * @brief Queues a job. Never waits for running jobs, only for the short bookkeeping of the workers.
+         * @param work The action
+         * @param machine Machine (or any of its states) to which the completion event is posted
+         * @param event Completion event
+         * @return Flag whether the job was queued (when not, the completion event is posted immediately)
+         */
+        bool submit(WorkerJob &&work, State *machine, unsigned int event);
+
+
+        /**
+         * @brief Posts the events of the completed jobs to their machines (called by the control thread).
+         * Does not wait when a worker holds the lock, the completions are then delivered on the next call.
+         * @return Number of delivered events
+         */
+        unsigned long deliver();
+
+
+        /**
+         * @brief Creates an entry or exit callback which runs the action on the pool
+         * @param work The action
+         * @param event Completion event
+         * @return Callback for State::onEnter or State::onLeave
+         */
+        StateInterfaceCallback action(WorkerJob work, unsigned int event);
+
+
+        /**
+         * @brief Creates a step callback which runs the action on the pool. The action is only queued again when the
+         * previous run has completed.
+         * @param work The action
+         * @param event Completion event
+         * @return Callback for State::onStep
+         */
+        StateStepCallback stepAction(WorkerJob work, unsigned int event);
+
+
+        /**
+         * Returns the number of queued and running jobs
+         * @return Number of pending jobs
+         */
+        unsigned long pending();
+
+
+        /**
+         * Returns the number of completed jobs
+         * @return Number of jobs
+         */
+        unsigned long completed() const;
+
+
+        /**
+         * Returns the number of jobs which threw an exception (their completion event is posted anyway)
+         * @return Number of jobs
+         */
+        unsigned long failed() const;
+
+
+        /**
+         * Returns the number of jobs rejected on a full queue
+         * @return Number of jobs
+         */
+        unsigned long rejected() const;
+
+    };
+
+}
+
+#endif // STATE_MACHINE_WORKER_H
@@ -0,0 +1,172 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-17.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <State.h>
+#include <Activity.h>
+
+using namespace emb;
+
+class ActivityTest : public ::testing::Test, public State {
+
+};
+
+
+TEST_F(ActivityTest, Sequence) {
+
+    // process values
+    bool valveOpen = false;
+    double pressure = 0.0;
+    unsigned int attempts = 0;
+    bool done = false;
+
+    // create states
+    auto start = createState();
+    auto filling = createState<ActivityState>();
+    auto end = createState();
+
+    // open valve, wait, check pressure, retry three times
+    filling->activity.body = [&](Activity &a) {
+
+        EMB_ACTIVITY_BEGIN(a);
+
+        for(attempts = 0; attempts < 3; attempts++) {
+
+            valveOpen = true;
+            EMB_AWAIT_TIME(a, 0.05);
+            valveOpen = false;
+
+            if(pressure > 1.0)
+                break;
+
+            EMB_YIELD(a);
+
+        }
+
+        EMB_AWAIT_EVENT(a, 5);
+        done = true;
+
+        EMB_ACTIVITY_END(a);
+
+    };
+
+    // transitions
+    start->addTransition([](const Transition *) { return true; }, filling);
+    filling->addTransition([&done](const Transition *) { return done; }, end);
+
+    // run
+    start->initialize();
+    step();
+    EXPECT_EQ(filling, currentState());
+
+    // the valve is opened and the machine is not blocked
+    Timer timer{};
+    timer.start();
+    step();
+    EXPECT_TRUE(valveOpen);
+    EXPECT_LT(timer.time(), 0.04);
+
+    // wait for the second attempt
+    while(attempts == 0)
+        step();
+
+    // increase pressure in the second attempt
+    EXPECT_TRUE(valveOpen);
+    pressure = 2.0;
+    while(valveOpen)
+        step();
+
+    EXPECT_EQ(1, attempts);
+    EXPECT_FALSE(filling->activity.finished());
+
+    // wait for event
+    step();
+    EXPECT_FALSE(done);
+    post(Event{5});
+    step();
+    EXPECT_TRUE(done);
+    EXPECT_TRUE(filling->activity.finished());
+
+    // leave state
+    step();
+    EXPECT_EQ(end, currentState());
+    EXPECT_FALSE(filling->activity.running());
+
+}
+
+
+TEST_F(ActivityTest, CancelOnExit) {
+
+    unsigned int counter = 0;
+    bool leave = false;
+
+    // create states
+    auto active = createState<ActivityState>();
+    auto other = createState();
+
+    // count steps endlessly
+    active->activity.body = [&counter](Activity &a) {
+
+        EMB_ACTIVITY_BEGIN(a);
+        counter = 0;
+
+        while(true) {
+            counter++;
+            EMB_YIELD(a);
+        }
+
+        EMB_ACTIVITY_END(a);
+
+    };
+
+    // transitions
+    active->addTransition([&leave](const Transition *) { return leave; }, other);
+    other->addTransition([&leave](const Transition *) { return !leave; }, active);
+
+    // run
+    active->initialize();
+    step();
+    step();
+    step();
+    EXPECT_EQ(3, counter);
+
+    // leave and come back
+    leave = true;
+    step();
+    EXPECT_FALSE(active->activity.running());
+    leave = false;
+    step();
+    EXPECT_TRUE(active->activity.running());
+
+    // restarted from the beginning
+    step();
+    EXPECT_EQ(1, counter);
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,174 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-10.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <State.h>
+#include "NoAlloc.h"
+
+using namespace emb;
+
+namespace {
+
+    unsigned long reported = 0;
+    unsigned long reportedSize = 0;
+
+    void countViolation(unsigned long size) {
+
+        reported++;
+        reportedSize = size;
+
+    }
+
+
+    /** Allocates through a call the optimizer cannot remove (unlike paired new and delete expressions) */
+    void allocate(unsigned long size) {
+
+        void *volatile memory = ::operator new(size);
+        ::operator delete(memory);
+
+    }
+
+}
+
+class AuditTest : public ::testing::Test, public State {
+
+protected:
+
+    StateMonitor _auditMonitor{};
+
+
+    void SetUp() override {
+
+        reported = 0;
+        reportedSize = 0;
+        AllocationAudit::setViolationHandler(&countViolation);
+
+    }
+
+
+    void TearDown() override {
+
+        AllocationAudit::setViolationHandler(nullptr);
+
+    }
+
+};
+
+
+TEST_F(AuditTest, Counting) {
+
+    auto bytes = AllocationAudit::bytes();
+
+    EXPECT_ALLOCATIONS(1, allocate(sizeof(int)));
+    EXPECT_ALLOCATIONS(0, int value = 1; (void) value);
+    EXPECT_LE(bytes + sizeof(int), AllocationAudit::bytes());
+
+    // other threads are counted separately
+    auto allocations = AllocationAudit::allocations();
+    std::thread thread([] { allocate(100 * sizeof(int)); });
+    thread.join();
+    EXPECT_GE(AllocationAudit::allocations() - allocations, 1);
+    EXPECT_EQ(0, reported);
+
+}
+
+
+TEST_F(AuditTest, Violation) {
+
+    auto violations = AllocationAudit::violations();
+
+    {
+        ScopedNoAlloc outer{};
+
+        // nested scope
+        {
+            ScopedNoAlloc inner{};
+            allocate(10 * sizeof(int));
+            EXPECT_EQ(1, inner.allocations());
+        }
+
+        EXPECT_EQ(1, outer.allocations());
+        EXPECT_EQ(1, reported);
+        EXPECT_EQ(10 * sizeof(int), reportedSize);
+    }
+
+    // outside of the scope
+    allocate(10 * sizeof(int));
+    EXPECT_EQ(1, reported);
+    EXPECT_EQ(violations + 1, AllocationAudit::violations());
+
+}
+
+
+TEST_F(AuditTest, SteadyStateStep) {
+
+    double temperature = 20.0;
+
+    // machine with callbacks, guards, events, timed transitions and a monitor
+    auto idle = createState();
+    auto heating = createState();
+    auto hold = heating->createState();
+    auto off = createState();
+    idle->addEventTransition(1, hold);
+    hold->addTransition(Guard::signal("temp") > 80.0, idle);
+    hold->addEventTransition(2, off);
+    off->addTimedTransition(std::chrono::milliseconds(0), idle);
+    hold->onStep = [&temperature](State *) { temperature += 10.0; };
+    idle->onEnter = [&temperature](const Transition *) { temperature = 20.0; };
+    hold->setTransitionOrder(TransitionOrder::Adaptive);
+    for(auto &t : hold->getTransitions()) {
+        if(t->guard)
+            t->guard->bind("temp", &temperature);
+    }
+
+    setMonitor(&_auditMonitor);
+    getEventQueue()->setCapacity(8);
+    idle->initialize();
+
+    auto cycle = [this](int i) {
+        post(Event{i % 3 == 0 ? 2u : 1u});
+        for(int j = 0; j < 10; ++j)
+            step();
+    };
+
+    // warm up (the event queue allocates its storage on the first push)
+    for(int i = 0; i < 3; ++i)
+        cycle(i);
+
+    // steady state
+    auto transitions = getTransitionCount();
+    for(int i = 0; i < 200; ++i)
+        ASSERT_NO_ALLOC(cycle(i));
+
+    EXPECT_NO_ALLOC(poll(Timer::absoluteTime()));
+    EXPECT_LT(transitions + 200, getTransitionCount());
+    EXPECT_EQ(0, reported);
+
+}
+
+#pragma clang diagnostic pop
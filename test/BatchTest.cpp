@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-16.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include <Batch.h>
+
+using namespace emb;
+
+
+TEST(BatchTest, Kernels) {
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+    // random values (odd count to check the remainder)
+    std::vector<double> values(1003);
+    for(auto &v : values)
+        v = dist(rng);
+    values[10] = 0.25;
+
+    std::vector<unsigned char> expected(values.size()), mask(values.size());
+    for(auto op : {GuardOp::Less, GuardOp::LessEqual, GuardOp::Greater, GuardOp::GreaterEqual, GuardOp::Equal,
+                   GuardOp::NotEqual}) {
+
+        // compare vectorized with scalar implementation
+        batchCompareScalar(values.data(), values.size(), op, 0.25, expected.data());
+        batchCompare(values.data(), values.size(), op, 0.25, mask.data());
+        EXPECT_EQ(expected, mask);
+
+    }
+
+}
+
+
+TEST(BatchTest, Stepping) {
+
+    BatchMachine batch(10);
+
+    // states and signals
+    auto cold = batch.createState();
+    auto hot = batch.createState();
+    auto cooling = batch.createState();
+    auto temp = batch.createSignal("temp");
+
+    // transitions
+    EXPECT_TRUE(batch.addTransition(cold, Guard::signal("temp") > 80.0, hot));
+    EXPECT_TRUE(batch.addTransition(hot, Guard::signal("temp") < 60.0, cooling));
+    EXPECT_TRUE(batch.addTransition(cooling, Guard::time() >= 1.0, cold));
+    EXPECT_FALSE(batch.addTransition(cold, Guard::signal("pressure") > 1.0, hot));
+    EXPECT_FALSE(batch.addTransition(cold, Guard::signal("temp") > 1.0 && Guard::time() > 1.0, hot));
+
+    // count transitions
+    unsigned long transitions = 0;
+    batch.onTransition = [&transitions](unsigned long, unsigned int, unsigned int) { transitions++; };
+
+    // initialize
+    batch.initialize(cold, 0.0);
+    EXPECT_EQ(10, batch.population(cold));
+
+    // heat up half of the instances
+    for(unsigned long i = 0; i < batch.size(); i += 2)
+        batch.signal(temp)[i] = 90.0;
+
+    // only one transition per step
+    EXPECT_EQ(5, batch.step(0.1));
+    EXPECT_EQ(5, batch.population(hot));
+    EXPECT_EQ(hot, batch.state(0));
+    EXPECT_EQ(cold, batch.state(1));
+
+    // cool down
+    for(unsigned long i = 0; i < batch.size(); ++i)
+        batch.signal(temp)[i] = 20.0;
+
+    EXPECT_EQ(5, batch.step(0.2));
+    EXPECT_EQ(5, batch.population(cooling));
+
+    // state time
+    EXPECT_EQ(0, batch.step(1.0));
+    EXPECT_EQ(5, batch.step(1.2));
+    EXPECT_EQ(10, batch.population(cold));
+    EXPECT_EQ(15, transitions);
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,245 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-23.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <Bus.h>
+#include <Mqtt.h>
+
+using namespace emb;
+
+class BusTest : public ::testing::Test, public State {
+
+};
+
+
+TEST_F(BusTest, Matching) {
+
+    EXPECT_TRUE(Bus::matches("a/b/c", "a/b/c"));
+    EXPECT_TRUE(Bus::matches("a/+/c", "a/b/c"));
+    EXPECT_TRUE(Bus::matches("a/#", "a/b/c"));
+    EXPECT_TRUE(Bus::matches("a/#", "a"));
+    EXPECT_TRUE(Bus::matches("#", "a/b"));
+    EXPECT_TRUE(Bus::matches("+/+", "a/"));
+    EXPECT_FALSE(Bus::matches("a/+", "a/b/c"));
+    EXPECT_FALSE(Bus::matches("a/b", "a/c"));
+    EXPECT_FALSE(Bus::matches("#", "$SYS/x"));
+    EXPECT_TRUE(Bus::matches("$SYS/#", "$SYS/x"));
+
+}
+
+
+TEST_F(BusTest, Publish) {
+
+    Bus bus{};
+    std::vector<std::string> received;
+
+    // subscribe callbacks
+    auto callback = [&received](const char *topic, const std::shared_ptr<const void> &) { received.emplace_back(topic); };
+    EXPECT_NE(0, bus.subscribe("sensors/+/temp", callback));
+    EXPECT_NE(0, bus.subscribe("sensors/#", callback));
+    auto id = bus.subscribe("sensors/kitchen/temp", callback);
+    EXPECT_NE(0, id);
+
+    // invalid filters
+    EXPECT_EQ(0, bus.subscribe("sensors/#/temp", callback));
+    EXPECT_EQ(0, bus.subscribe("sensors/a+", callback));
+
+    // publish
+    EXPECT_EQ(3, bus.publish("sensors/kitchen/temp", "21.5", 4));
+    EXPECT_EQ(2, bus.publish("sensors/hall/temp", "20.0", 4));
+    EXPECT_EQ(1, bus.publish("sensors", "", 0));
+    EXPECT_EQ(0, bus.publish("actors/kitchen/temp", "", 0));
+    EXPECT_EQ(0, bus.publish("sensors/+", "", 0));
+    EXPECT_EQ(6, received.size());
+
+    // unsubscribe
+    bus.unsubscribe(id);
+    EXPECT_EQ(2, bus.publish("sensors/kitchen/temp", "21.5", 4));
+
+}
+
+
+TEST_F(BusTest, SubscribeDuringDelivery) {
+
+    Bus bus{};
+    std::vector<std::string> received;
+
+    // the first callback removes itself and adds new subscribers
+    unsigned long first = 0;
+    first = bus.subscribe("a/#", [&](const char *, const std::shared_ptr<const void> &) {
+        received.emplace_back("first");
+        bus.unsubscribe(first);
+        for(int i = 0; i < 16; ++i)
+            bus.subscribe("a/b", [&received](const char *, const std::shared_ptr<const void> &) { received.emplace_back("new"); });
+    });
+
+    auto second = bus.subscribe("a/b", [&received](const char *, const std::shared_ptr<const void> &) { received.emplace_back("second"); });
+    bus.subscribe("a/b", [&](const char *, const std::shared_ptr<const void> &) { bus.unsubscribe(second); });
+
+    // new subscribers are served from the next publication on
+    EXPECT_EQ(3, bus.publish("a/b", "", 0));
+    EXPECT_EQ((std::vector<std::string>{"first", "second"}), received);
+
+    received.clear();
+    EXPECT_EQ(17, bus.publish("a/b", "", 0));
+    EXPECT_EQ(16, received.size());
+
+}
+
+
+TEST_F(BusTest, Machines) {
+
+    Bus bus{};
+
+    // states
+    auto idle = createState();
+    auto alarm = createState();
+    idle->addEventTransition(1, alarm);
+
+    // check the payload on entry
+    std::string content;
+    alarm->onEnter = [&content](const Transition *t) {
+        auto message = static_cast<const BusMessage *>(t->from->currentEvent()->payload.get());
+        content.assign(message->data.begin(), message->data.end());
+    };
+
+    // subscribe machine
+    bus.subscribe("alarms/#", this, 1);
+    idle->initialize();
+
+    // publish
+    EXPECT_EQ(1, bus.publish("alarms/fire", "smoke", 5));
+    step();
+    EXPECT_EQ(alarm, currentState());
+    EXPECT_EQ("smoke", content);
+
+    // shared payload is not copied
+    auto payload = std::make_shared<int>(42);
+    bus.publish("alarms/x", payload);
+    EXPECT_EQ(2, payload.use_count());
+    step();
+    EXPECT_EQ(payload.get(), currentEvent()->payload.get());
+
+    // full queue
+    getEventQueue()->setCapacity(1);
+    bus.publish("alarms/x", payload);
+    bus.publish("alarms/x", payload);
+    EXPECT_EQ(1, bus.dropped());
+
+}
+
+
+TEST_F(BusTest, Bridge) {
+
+    LocalBroker broker{};
+    Bus local{}, remote{};
+
+    // bridge two buses through the broker
+    MqttBridge bridgeLocal(local, *broker.connect());
+    MqttBridge bridgeRemote(remote, *broker.connect());
+    EXPECT_TRUE(bridgeLocal.exportTopics("devices/#"));
+    EXPECT_TRUE(bridgeRemote.importTopics("devices/+/status"));
+
+    // receive on remote bus
+    std::string received;
+    remote.subscribe("devices/#", [&received](const char *, const std::shared_ptr<const void> &payload) {
+        auto message = static_cast<const BusMessage *>(payload.get());
+        received.assign(message->data.begin(), message->data.end());
+    });
+
+    local.publish("devices/pump/status", "on", 2);
+    EXPECT_EQ("on", received);
+    local.publish("devices/pump/other", "x", 1);
+    EXPECT_EQ("on", received);
+    EXPECT_EQ(2, broker.messages());
+
+    // other payloads are not exported
+    EXPECT_EQ(0, local.publish("devices/pump/status", std::make_shared<int>(42)));
+    EXPECT_EQ("on", received);
+    EXPECT_EQ(2, broker.messages());
+
+}
+
+
+TEST_F(BusTest, BridgeOrigin) {
+
+    LocalBroker broker{};
+    Bus local{}, remote{};
+
+    MqttBridge bridgeLocal(local, *broker.connect());
+    MqttBridge bridgeRemote(remote, *broker.connect());
+    EXPECT_TRUE(bridgeLocal.exportTopics("devices/#"));
+    EXPECT_TRUE(bridgeRemote.importTopics("devices/+/status"));
+    EXPECT_TRUE(bridgeRemote.exportTopics("devices/#"));
+
+    // local messages published while a received message is delivered are exported
+    unsigned long acknowledged = 0;
+    remote.subscribeMessages("devices/+/status", [&remote](const BusMessage &message) {
+        EXPECT_NE(nullptr, message.origin);
+        remote.publish("devices/pump/ack", "1", 1);
+    });
+
+    local.subscribeMessages("devices/+/ack", [&acknowledged](const BusMessage &) { acknowledged++; });
+    EXPECT_TRUE(bridgeLocal.importTopics("devices/+/ack"));
+
+    // the received status is not sent back, the acknowledgement is
+    local.publish("devices/pump/status", "on", 2);
+    EXPECT_EQ(1, acknowledged);
+    EXPECT_EQ(2, broker.messages());
+
+}
+
+
+TEST_F(BusTest, BrokerChangesDuringDelivery) {
+
+    LocalBroker broker{};
+    auto client = broker.connect();
+    unsigned long received = 0;
+
+    // clients and filters added during the delivery receive the next message
+    client->onMessage = [&broker, &client, &received](const std::string &, const char *, unsigned long) {
+        received++;
+        for(int i = 0; i < 16; ++i) {
+            client->subscribe("a/#");
+            broker.connect()->subscribe("a/#");
+        }
+    };
+
+    EXPECT_TRUE(client->subscribe("a/+"));
+    EXPECT_TRUE(client->publish("a/b", "x", 1));
+    EXPECT_EQ(1, received);
+    EXPECT_EQ(17, client->filters.size());
+
+    EXPECT_TRUE(client->publish("a/b", "x", 1));
+    EXPECT_EQ(2, received);
+
+}
+
+
+#pragma clang diagnostic pop
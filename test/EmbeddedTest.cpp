@@ -0,0 +1,164 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-24.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <State.h>
+
+using namespace emb;
+
+class EmbeddedTest : public ::testing::Test, public State {
+
+public:
+
+    // the test framework allocates the fixture
+    static void *operator new(std::size_t size) { return ::operator new(size); }
+    static void operator delete(void *memory) { ::operator delete(memory); }
+
+};
+
+
+struct CounterState : public State {
+
+    int counter = 0;
+
+    void _run() override {
+
+        counter++;
+        State::_run();
+
+    }
+
+};
+
+
+TEST_F(EmbeddedTest, FixedContainers) {
+
+    FixedVector<int, 3> vector{};
+    int sum = 0;
+
+    // fill vector
+    vector.push_back(1);
+    vector.emplace_back(2);
+    vector.push_back(3);
+    EXPECT_EQ(3, vector.size());
+    EXPECT_EQ(3, vector.back());
+
+    for(auto v : vector)
+        sum += v;
+
+    EXPECT_EQ(6, sum);
+
+    // callback with captures
+    FixedFunction<int (int), 16> function{};
+    EXPECT_FALSE(function);
+
+    function = [sum](int x) { return x + sum; };
+    auto copy = function;
+    EXPECT_TRUE(copy);
+    EXPECT_EQ(10, copy(4));
+
+    // pool
+    BlockPool<16, 2> pool{};
+    auto a = pool.allocate(8);
+    auto b = pool.allocate(16);
+    EXPECT_NE(nullptr, a);
+    EXPECT_NE(nullptr, b);
+    EXPECT_EQ(nullptr, pool.allocate(8));
+    EXPECT_EQ(nullptr, pool.allocate(32));
+    pool.release(a);
+    EXPECT_EQ(a, pool.allocate(8));
+
+}
+
+
+TEST_F(EmbeddedTest, Machine) {
+
+    int entered = 0;
+
+    // create states from the pool
+    auto idle = createState();
+    auto running = createState<CounterState>();
+    auto stopped = createState();
+    name = "machine";
+
+    // transitions
+    idle->addEventTransition(1, running);
+    running->addTransition([running](const Transition *) { return running->counter >= 3; }, stopped);
+    stopped->addTimedTransition(0.01, idle);
+    idle->onEnter = [&entered](const Transition *) { entered++; };
+
+    // initialize
+    idle->initialize();
+    EXPECT_EQ(3, getChildren().size());
+    EXPECT_EQ(1, idle->getTransitions().size());
+
+    // event with static payload
+    static const int payload = 42;
+    EXPECT_TRUE(post(Event{1, &payload}));
+    step();
+    EXPECT_EQ(running, currentState());
+    EXPECT_EQ(42, *static_cast<const int *>(currentEvent()->payload));
+
+    // run until stopped
+    for(int i = 0; i < 3; ++i)
+        step();
+
+    EXPECT_EQ(3, running->counter);
+    step();
+    EXPECT_EQ(stopped, currentState());
+
+    // timed transition
+    Timer::delay(0.02);
+    step();
+    EXPECT_EQ(idle, currentState());
+    EXPECT_EQ(1, entered);
+
+    // queue capacity is limited by the static storage
+    getEventQueue()->setCapacity(1000);
+    EXPECT_EQ(EMB_EVENT_QUEUE_SIZE, getEventQueue()->capacity());
+
+    // policies are limited by the static storage
+    for(unsigned int id = 0; id < EMB_EVENT_POLICIES; ++id)
+        EXPECT_TRUE(getEventQueue()->setPolicy(100 + id, EventPolicy::Critical));
+
+    EXPECT_FALSE(getEventQueue()->setPolicy(200, EventPolicy::Latest));
+    EXPECT_TRUE(getEventQueue()->setPolicy(100, EventPolicy::Queue));
+    EXPECT_TRUE(getEventQueue()->setPolicy(200, EventPolicy::Latest));
+
+    // critical events in the static priority lane
+    getEventQueue()->setPriorityCapacity(1000);
+    for(int i = 0; i < EMB_EVENT_PRIORITY_SIZE; ++i)
+        EXPECT_TRUE(post(Event{101}));
+
+    EXPECT_FALSE(post(Event{101}));
+    EXPECT_EQ(1, getEventQueue()->dropped());
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-04.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <Generator.h>
+
+using namespace emb;
+
+class GeneratorTest : public ::testing::Test {
+
+};
+
+
+TEST_F(GeneratorTest, Topology) {
+
+    GeneratorConfig config{};
+    config.states = 1000;
+    config.depth = 20;
+    config.fanOut = 2;
+    config.transitions = 3;
+
+    MachineGenerator generator{config};
+    EXPECT_EQ(1000, generator.states());
+    EXPECT_LT(0, generator.leaves());
+    EXPECT_GE(20, generator.depth());
+    EXPECT_LT(5, generator.depth());
+
+    // not initialized
+    std::string message{};
+    EXPECT_FALSE(generator.check(&message));
+    EXPECT_EQ("no active state", message);
+
+}
+
+
+TEST_F(GeneratorTest, Fuzz) {
+
+    std::string message{};
+
+    // random machines with random shapes
+    for(unsigned long seed = 1; seed <= 30; ++seed) {
+
+        GeneratorConfig config{};
+        config.seed = seed;
+        config.states = 10 + seed * 17 % 300;
+        config.depth = 1 + (unsigned int) (seed % 7);
+        config.fanOut = 1 + (unsigned int) (seed % 5);
+        config.transitions = 1 + (unsigned int) (seed % 4);
+        config.probability = 0.3;
+
+        MachineGenerator generator{config};
+        generator.initialize();
+        ASSERT_TRUE(generator.check(&message)) << "seed " << seed << ": " << message;
+
+        // invariants after every step
+        for(int i = 0; i < 200; ++i) {
+            generator.machine().step();
+            ASSERT_TRUE(generator.check(&message)) << "seed " << seed << ", step " << i << ": " << message;
+        }
+
+        EXPECT_LT(0, generator.machine().getTransitionCount());
+
+    }
+
+}
+
+
+#pragma clang diagnostic pop
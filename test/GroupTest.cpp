@@ -0,0 +1,227 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-20.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <Group.h>
+
+using namespace emb;
+
+class GroupTest : public ::testing::Test {
+
+protected:
+
+    /** Machine with two states, switching when the other machine is in its first state */
+    struct Machine {
+
+        State root{};
+        State *first = nullptr;
+        State *second = nullptr;
+        unsigned long steps = 0;
+
+        Machine() {
+
+            first = root.createState();
+            second = root.createState();
+            first->onStep = [this](State *) { steps++; };
+            first->initialize();
+
+        }
+
+        void follow(const Machine &other) {
+
+            first->addTransition([&other](const Transition *) { return other.root.currentState() == other.first; },
+                                 second);
+
+        }
+
+    };
+
+};
+
+
+TEST_F(GroupTest, OrderIndependent) {
+
+    // sequential stepping depends on the order
+    Machine a{}, b{};
+    a.follow(b);
+    b.follow(a);
+
+    a.root.step();
+    b.root.step();
+
+    EXPECT_EQ(a.second, a.root.currentState());
+    EXPECT_EQ(b.first, b.root.currentState());
+
+    // two-phase stepping does not (both see the other one in its first state)
+    for(int order = 0; order < 2; ++order) {
+
+        Machine c{}, d{};
+        c.follow(d);
+        d.follow(c);
+
+        MachineGroup group{};
+        group.add(order == 0 ? &c.root : &d.root);
+        group.add(order == 0 ? &d.root : &c.root);
+
+        EXPECT_EQ(2, group.size());
+        EXPECT_EQ(2, group.step());
+        EXPECT_EQ(c.second, c.root.currentState());
+        EXPECT_EQ(d.second, d.root.currentState());
+
+        // no step callbacks in a step with a transition
+        EXPECT_EQ(0, c.steps);
+        EXPECT_EQ(0, group.step());
+        EXPECT_EQ(2, group.transitions());
+
+    }
+
+}
+
+
+TEST_F(GroupTest, StepsAndEvents) {
+
+    // sub-machine: idle -> busy.a on event 1, inner transition a -> b after the parent step
+    State root{};
+    auto idle = root.createState();
+    auto busy = root.createState();
+    auto a = busy->createState();
+    auto b = busy->createState();
+
+    int rootSteps = 0, busySteps = 0;
+    bool go = false;
+
+    root.onStep = [&rootSteps](State *) { rootSteps++; };
+    busy->onStep = [&busySteps](State *) { busySteps++; };
+
+    idle->addEventTransition(1, a);
+    a->addTransition([&go](const Transition *) { return go; }, b);
+    idle->initialize();
+
+    MachineGroup group{};
+    group.add(&root);
+
+    // no transition: all steps on the active path run
+    EXPECT_EQ(0, group.step());
+    EXPECT_EQ(1, rootSteps);
+
+    // event is taken in the read phase
+    root.post(Event{1});
+    EXPECT_EQ(1, group.step());
+    EXPECT_EQ(busy, root.currentState());
+    EXPECT_EQ(a, busy->currentState());
+    EXPECT_EQ(2, rootSteps);
+
+    // event is consumed
+    EXPECT_EQ(0, group.step());
+    EXPECT_EQ(3, rootSteps);
+    EXPECT_EQ(1, busySteps);
+
+    // transition of the sub-state: the parents above perform their step
+    go = true;
+    EXPECT_EQ(1, group.step());
+    EXPECT_EQ(b, busy->currentState());
+    EXPECT_EQ(4, rootSteps);
+    EXPECT_EQ(2, busySteps);
+    EXPECT_EQ(2, root.getTransitionCount());
+
+}
+
+
+TEST_F(GroupTest, EventsOfOtherMachines) {
+
+    // the second machine follows the event of the first one: the result must not depend on the order
+    for(bool reversed : {false, true}) {
+
+        Machine sender{}, receiver{};
+        receiver.first->addTransition([&sender](const Transition *) {
+            auto event = sender.root.currentEvent();
+            return event != nullptr && event->id == 1; }, receiver.second);
+
+        MachineGroup group{};
+        group.add(reversed ? &receiver.root : &sender.root);
+        group.add(reversed ? &sender.root : &receiver.root);
+
+        sender.root.post(Event{1});
+        EXPECT_EQ(1, group.step());
+        EXPECT_EQ(receiver.second, receiver.root.currentState());
+
+    }
+
+}
+
+
+TEST_F(GroupTest, Parallel) {
+
+    // ring of machines, each following its predecessor: the result must not depend on the threads
+    const unsigned long count = 257;
+    std::vector<std::vector<bool>> results{};
+
+    for(unsigned int threads : {0u, 1u, 3u}) {
+
+        std::vector<std::unique_ptr<Machine>> machines{};
+        for(unsigned long i = 0; i < count; ++i)
+            machines.emplace_back(new Machine);
+
+        for(unsigned long i = 0; i < count; ++i) {
+
+            auto &m = *machines[i];
+            auto &previous = *machines[(i + count - 1) % count];
+            m.follow(previous);
+
+            // back again when the predecessor has left the first state
+            m.second->addTransition([&previous](const Transition *) {
+                return previous.root.currentState() == previous.second; }, m.first);
+
+        }
+
+        // break the symmetry
+        machines[0]->second->initialize();
+
+        MachineGroup group{threads};
+        for(auto &m : machines)
+            group.add(&m->root);
+
+        for(int s = 0; s < 100; ++s)
+            group.step();
+
+        std::vector<bool> result{};
+        for(auto &m : machines)
+            result.push_back(m->root.currentState() == m->second);
+
+        EXPECT_GT(group.transitions(), 0);
+        results.push_back(result);
+
+    }
+
+    EXPECT_EQ(results[0], results[1]);
+    EXPECT_EQ(results[0], results[2]);
+
+}
+
+#pragma clang diagnostic pop
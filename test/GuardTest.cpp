@@ -0,0 +1,282 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-15.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <State.h>
+#include <Guard.h>
+
+using namespace emb;
+
+class GuardTest : public ::testing::Test, public State {
+
+};
+
+
+TEST_F(GuardTest, Expressions) {
+
+    double temperature = 20.0;
+    bool ok;
+
+    // build guard
+    auto guard = Guard::signal("temp") > Guard::parameter("limit", 25.0) && !(Guard::signal("temp") > 100.0);
+    EXPECT_FALSE(guard.valid());
+
+    // bind signal
+    EXPECT_TRUE(guard.bind("temp", &temperature));
+    EXPECT_FALSE(guard.bind("pressure", &temperature));
+    EXPECT_TRUE(guard.valid());
+
+    // check inputs
+    ASSERT_EQ(1, guard.signals().size());
+    EXPECT_EQ("temp", guard.signals()[0]);
+    EXPECT_EQ("limit", guard.parameters()[0]);
+    EXPECT_FALSE(guard.uses(GuardOp::Time));
+
+    // evaluate
+    EXPECT_DOUBLE_EQ(0.0, guard.value(0.0, nullptr));
+    temperature = 30.0;
+    EXPECT_DOUBLE_EQ(1.0, guard.value(0.0, nullptr));
+    temperature = 130.0;
+    EXPECT_DOUBLE_EQ(0.0, guard.value(0.0, nullptr));
+
+    // change parameter
+    temperature = 30.0;
+    EXPECT_TRUE(guard.setParameter("limit", 35.0));
+    EXPECT_DOUBLE_EQ(0.0, guard.value(0.0, nullptr));
+
+    // arithmetics
+    ok = Guard::parse("(2 + 3) * 4 - 10 / 5", guard);
+    EXPECT_TRUE(ok);
+    EXPECT_DOUBLE_EQ(18.0, guard.value(0.0, nullptr));
+
+}
+
+
+TEST_F(GuardTest, Parse) {
+
+    double flag = 1.0;
+    Event event{3};
+
+    // parse valid guard
+    Guard guard;
+    ASSERT_TRUE(Guard::parse("flag && time >= $after || event == 3", guard));
+    EXPECT_TRUE(guard.bind("flag", &flag));
+    EXPECT_TRUE(guard.setParameter("after", 2.0));
+    EXPECT_TRUE(guard.uses(GuardOp::Time));
+    EXPECT_TRUE(guard.uses(GuardOp::Event));
+
+    // evaluate
+    EXPECT_DOUBLE_EQ(0.0, guard.value(1.0, nullptr));
+    EXPECT_DOUBLE_EQ(1.0, guard.value(2.0, nullptr));
+    EXPECT_DOUBLE_EQ(1.0, guard.value(0.0, &event));
+    flag = 0.0;
+    EXPECT_DOUBLE_EQ(0.0, guard.value(2.0, nullptr));
+
+    // invalid text
+    EXPECT_FALSE(Guard::parse("temp >", guard));
+    EXPECT_FALSE(Guard::parse("(temp > 3", guard));
+    EXPECT_FALSE(Guard::parse("temp > 3 4", guard));
+
+    // nesting is limited
+    std::string nested = std::string(EMB_GUARD_PARSE_DEPTH, '(') + "1" + std::string(EMB_GUARD_PARSE_DEPTH, ')');
+    EXPECT_TRUE(Guard::parse(nested, guard));
+    EXPECT_TRUE(Guard::parse(std::string(EMB_GUARD_PARSE_DEPTH, '!') + "1", guard));
+    EXPECT_FALSE(Guard::parse("(" + nested + ")", guard));
+    EXPECT_FALSE(Guard::parse(std::string(100000, '(') + "1", guard));
+    EXPECT_FALSE(Guard::parse(std::string(100000, '!') + "1", guard));
+    EXPECT_FALSE(Guard::parse(std::string(100000, '-') + "1", guard));
+
+}
+
+
+TEST_F(GuardTest, Transitions) {
+
+    double pressure = 0.0;
+
+    // create states
+    auto idle = createState();
+    auto running = createState();
+    auto stopped = createState();
+
+    // guarded transitions
+    Guard guard = Guard::signal("pressure") > 2.5;
+    guard.bind("pressure", &pressure);
+    idle->addTransition(guard, running);
+    running->addEventTransition(7, stopped);
+
+    // initialize
+    idle->initialize();
+
+    // step
+    step();
+    EXPECT_EQ(idle, currentState());
+
+    // step
+    pressure = 3.0;
+    step();
+    EXPECT_EQ(running, currentState());
+
+    // wrong event
+    EXPECT_TRUE(post(Event{6}));
+    step();
+    EXPECT_EQ(running, currentState());
+    EXPECT_EQ(6, currentEvent()->id);
+
+    // right event (posted on a sub-state)
+    EXPECT_TRUE(running->post(Event{7}));
+    step();
+    EXPECT_EQ(stopped, currentState());
+
+    // the event is valid for one step only
+    step();
+    EXPECT_EQ(nullptr, currentEvent());
+
+}
+
+
+TEST_F(GuardTest, EventQueue) {
+
+    EventQueue queue{};
+    Event event{0};
+
+    // fill queue
+    queue.setCapacity(2);
+    EXPECT_TRUE(queue.push(Event{1}));
+    EXPECT_TRUE(queue.push(Event{2}));
+    EXPECT_FALSE(queue.push(Event{3}));
+    EXPECT_EQ(2, queue.size());
+
+    // empty queue
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(1, event.id);
+    EXPECT_TRUE(queue.push(Event{4}));
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(2, event.id);
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(4, event.id);
+    EXPECT_FALSE(queue.pop(event));
+
+}
+
+
+TEST_F(GuardTest, EventPolicies) {
+
+    EventQueue queue{};
+    Event event{0};
+    queue.setCapacity(4);
+    queue.setPriorityCapacity(1);
+
+    EXPECT_TRUE(queue.setPolicy(1, EventPolicy::Latest));
+    EXPECT_TRUE(queue.setPolicy(2, EventPolicy::DropOldest));
+    EXPECT_TRUE(queue.setPolicy(9, EventPolicy::Critical));
+    EXPECT_EQ(EventPolicy::Latest, queue.policy(1));
+    EXPECT_EQ(EventPolicy::Queue, queue.policy(3));
+
+    // value changes are coalesced in place
+    for(int i = 1; i <= 1000; ++i)
+        EXPECT_TRUE(queue.push(Event{1, std::make_shared<int>(i)}));
+
+    EXPECT_TRUE(queue.push(Event{3}));
+    EXPECT_EQ(2, queue.size());
+    EXPECT_EQ(999, queue.coalesced());
+
+    // drop oldest when full
+    EXPECT_TRUE(queue.push(Event{2}));
+    EXPECT_TRUE(queue.push(Event{2}));
+    EXPECT_FALSE(queue.push(Event{3}));
+    EXPECT_TRUE(queue.push(Event{2}));
+    EXPECT_EQ(4, queue.size());
+    EXPECT_EQ(2, queue.dropped());
+
+    // critical events overtake, the lane is bounded
+    EXPECT_TRUE(queue.push(Event{9}));
+    EXPECT_FALSE(queue.push(Event{9}));
+    EXPECT_EQ(5, queue.highWaterMark());
+    EXPECT_EQ(3, queue.dropped());
+
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(9, event.id);
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(3, event.id);
+
+    // the latest value was dropped as the oldest event, a new one is appended
+    EXPECT_TRUE(queue.push(Event{1, std::make_shared<int>(7)}));
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(2, event.id);
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_TRUE(queue.pop(event));
+    EXPECT_EQ(1, event.id);
+    EXPECT_EQ(7, *std::static_pointer_cast<const int>(event.payload));
+    EXPECT_FALSE(queue.pop(event));
+
+    // statistics
+    queue.resetStatistics();
+    EXPECT_EQ(0, queue.highWaterMark());
+    EXPECT_EQ(0, queue.dropped());
+    EXPECT_EQ(0, queue.coalesced());
+
+    // removed policy
+    EXPECT_TRUE(queue.setPolicy(1, EventPolicy::Queue));
+    EXPECT_EQ(EventPolicy::Queue, queue.policy(1));
+    EXPECT_EQ(EventPolicy::Critical, queue.policy(9));
+
+}
+
+
+TEST_F(GuardTest, CriticalEventLatency) {
+
+    // a burst of value changes ahead of an emergency stop
+    auto idle = createState();
+    auto stopped = createState();
+    idle->addEventTransition(99, stopped);
+    idle->initialize();
+
+    getEventQueue()->setCapacity(64);
+    getEventQueue()->setPolicy(1, EventPolicy::DropOldest);
+    getEventQueue()->setPolicy(99, EventPolicy::Critical);
+
+    for(int i = 0; i < 10000; ++i)
+        post(Event{1});
+
+    post(Event{99});
+    for(int i = 0; i < 10000; ++i)
+        post(Event{1});
+
+    // taken in the next step, whatever the input rate
+    step();
+    EXPECT_EQ(stopped, currentState());
+    EXPECT_EQ(64, getEventQueue()->size());
+    EXPECT_EQ(65, getEventQueue()->highWaterMark());
+    EXPECT_EQ(20000 - 64, getEventQueue()->dropped());
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-21.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <State.h>
+#include <StateJson.h>
+
+using namespace emb;
+
+class JsonTest : public ::testing::Test, public State {
+
+};
+
+
+TEST_F(JsonTest, Reader) {
+
+    const char text[] = R"({"a": [1, -2.5e1, true, false, null], "b": {"c": "x\"y\n"}, "d": {}})";
+    JsonReader reader(text, std::strlen(text));
+    char buffer[16];
+
+    EXPECT_EQ(JsonToken::BeginObject, reader.next());
+    EXPECT_EQ(JsonToken::Key, reader.next());
+    EXPECT_TRUE(reader.string().equals("a"));
+    EXPECT_EQ(JsonToken::BeginArray, reader.next());
+    EXPECT_EQ(JsonToken::Number, reader.next());
+    EXPECT_DOUBLE_EQ(1.0, reader.number());
+    EXPECT_EQ(JsonToken::Number, reader.next());
+    EXPECT_DOUBLE_EQ(-25.0, reader.number());
+    EXPECT_EQ(JsonToken::True, reader.next());
+    EXPECT_EQ(JsonToken::False, reader.next());
+    EXPECT_EQ(JsonToken::Null, reader.next());
+    EXPECT_EQ(JsonToken::EndArray, reader.next());
+    EXPECT_EQ(JsonToken::Key, reader.next());
+    EXPECT_TRUE(reader.string().equals("b"));
+    EXPECT_EQ(JsonToken::BeginObject, reader.next());
+    EXPECT_EQ(JsonToken::Key, reader.next());
+    EXPECT_EQ(JsonToken::String, reader.next());
+    EXPECT_EQ(4, reader.string().unescape(buffer, sizeof(buffer)));
+    EXPECT_STREQ("x\"y\n", buffer);
+    EXPECT_EQ(3, (JsonString{"\\u00e9a", 7}).unescape(buffer, sizeof(buffer)));
+    EXPECT_STREQ("\xc3\xa9" "a", buffer);
+    EXPECT_EQ(6, (JsonString{"\\u00g9", 6}).unescape(buffer, sizeof(buffer)));
+    EXPECT_STREQ("\\u00g9", buffer);
+    EXPECT_EQ(4, (JsonString{"\\u12", 4}).unescape(buffer, sizeof(buffer)));
+    EXPECT_STREQ("\\u12", buffer);
+    EXPECT_EQ(JsonToken::EndObject, reader.next());
+    EXPECT_EQ(JsonToken::Key, reader.next());
+    EXPECT_TRUE(reader.skip(reader.next()));
+    EXPECT_EQ(JsonToken::EndObject, reader.next());
+    EXPECT_EQ(JsonToken::End, reader.next());
+
+    // invalid documents
+    for(auto invalid : {"{\"a\" 1}", "[1 2]", "[1,]", "{\"a\":1,}", "[01x]", "\"abc", "[1]]", "{1:2}"}) {
+
+        JsonReader r(invalid, std::strlen(invalid));
+        auto t = r.next();
+        while(t != JsonToken::End && t != JsonToken::Error)
+            t = r.next();
+
+        EXPECT_EQ(JsonToken::Error, t) << invalid;
+
+    }
+
+}
+
+
+TEST_F(JsonTest, Writer) {
+
+    // write into small buffer with sink
+    std::string output;
+    char buffer[8];
+    JsonWriter writer(buffer, sizeof(buffer), [&output](const char *data, unsigned long size) {
+        output.append(data, size);
+    });
+
+    writer.beginObject();
+    writer.key("a").beginArray().value(1).value(2.5).value(true).null().endArray();
+    writer.key("b").value("q\"uote");
+    writer.key("c").beginObject().endObject();
+    writer.endObject();
+    writer.flush();
+
+    EXPECT_TRUE(writer.good());
+    EXPECT_EQ(R"({"a":[1,2.5,true,null],"b":"q\"uote","c":{}})", output);
+    EXPECT_EQ(output.size(), writer.written());
+
+    // overflow without sink
+    JsonWriter small(buffer, sizeof(buffer));
+    small.beginArray().value("too long for the buffer").endArray();
+    EXPECT_FALSE(small.good());
+
+    // levels beyond the maximum depth are counted, so their ends do not close the outer levels
+    output.clear();
+    JsonWriter deep(buffer, sizeof(buffer), [&output](const char *data, unsigned long size) {
+        output.append(data, size);
+    });
+
+    std::string expected = "[";
+    deep.beginArray();
+    for(int i = 0; i < EMB_JSON_MAX_DEPTH + 2; ++i) {
+        deep.beginArray().value(i);
+        expected += (i > 0 ? ",[" : "[") + std::to_string(i);
+    }
+    for(int i = 0; i < EMB_JSON_MAX_DEPTH + 2; ++i) {
+        deep.value(-i).endArray();
+        expected += "," + std::to_string(-i) + "]";
+    }
+    deep.endArray();
+    deep.flush();
+
+    EXPECT_TRUE(deep.good());
+    EXPECT_EQ(expected + "]", output);
+
+}
+
+
+TEST_F(JsonTest, Machine) {
+
+    double temperature = 50.0;
+
+    // states
+    name = "machine";
+    auto idle = createState();
+    auto heating = createState();
+    idle->name = "idle";
+    heating->name = "heating";
+
+    // transitions
+    Guard guard;
+    ASSERT_TRUE(Guard::parse("temp < $low", guard));
+    guard.bind("temp", &temperature);
+    idle->addTransition(guard, heating);
+    heating->addEventTransition(2, idle);
+
+    // configure threshold
+    EXPECT_EQ(1, configureGuards(*this, R"({"low": 60.0, "unknown": 1})", 28));
+    EXPECT_EQ(-1, configureGuards(*this, R"({"low": "x"})", 12));
+
+    // events
+    JsonEventMap events{};
+    events.add("stop", 2);
+
+    idle->initialize();
+    step();
+    EXPECT_EQ(heating, currentState());
+
+    const char message[] = R"({"source": {"id": 3}, "event": "stop"})";
+    EXPECT_TRUE(events.post(*this, message, std::strlen(message)));
+    EXPECT_FALSE(events.post(*this, R"({"event": "start"})", 18));
+
+    // event ids outside of the range are rejected
+    Event event{};
+    EXPECT_TRUE(events.read(R"({"event": 7})", 12, event));
+    EXPECT_EQ(7, event.id);
+    EXPECT_FALSE(events.read(R"({"event": -1})", 13, event));
+    EXPECT_FALSE(events.read(R"({"event": 1.5})", 14, event));
+    EXPECT_FALSE(events.read(R"({"event": 1e20})", 15, event));
+
+    // snapshot
+    char buffer[256];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writeSnapshot(writer, *this);
+    std::string snapshot(writer.data(), writer.size());
+    EXPECT_NE(std::string::npos, snapshot.find(R"("active":[{"name":"heating")"));
+    EXPECT_NE(std::string::npos, snapshot.find(R"("events":1)"));
+
+    // process event
+    temperature = 70.0;
+    step();
+    EXPECT_EQ(idle, currentState());
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,211 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-08.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <Lazy.h>
+
+using namespace emb;
+
+class LazyTest : public ::testing::Test, public State {
+
+protected:
+
+    State *_idle = nullptr;
+    LazyState *_service = nullptr;
+    State *_inner = nullptr;
+
+
+    void SetUp() override {
+
+        // idle <-> service (built on entry: inner1 -> inner2 -> idle)
+        _idle = createState();
+        _service = createState<LazyState>();
+        _idle->addEventTransition(1, _service);
+
+        _service->builder = [this](LazyState *state) {
+
+            auto inner1 = state->createState();
+            auto inner2 = state->createState();
+            inner1->addEventTransition(2, inner2);
+            inner2->addEventTransition(3, _idle);
+            _inner = inner1;
+
+            return inner1;
+
+        };
+
+        _idle->initialize();
+
+    }
+
+
+    void TearDown() override {
+
+        Timer::resetVirtualTime();
+
+    }
+
+};
+
+
+TEST_F(LazyTest, BuildOnEntry) {
+
+    EXPECT_FALSE(_service->built());
+    EXPECT_TRUE(_service->getChildren().empty());
+    EXPECT_EQ(0, _service->builds());
+
+    // entry builds and enters the initial sub-state
+    post(Event{1});
+    step();
+    EXPECT_TRUE(_service->built());
+    EXPECT_EQ(2, _service->getChildren().size());
+    EXPECT_EQ(_service, currentState());
+    EXPECT_EQ(_inner, _service->currentState());
+
+    // through the sub-machine and back
+    post(Event{2});
+    step();
+    EXPECT_EQ(_service->getChildren()[1], _service->currentState());
+    post(Event{3});
+    step();
+    EXPECT_EQ(_idle, currentState());
+    EXPECT_EQ(nullptr, _service->currentState());
+
+    // kept without release time
+    post(Event{1});
+    step();
+    EXPECT_EQ(1, _service->builds());
+    EXPECT_EQ(_inner, _service->currentState());
+
+}
+
+
+TEST_F(LazyTest, Release) {
+
+    Timer::setVirtualTime(10.0);
+    _service->releaseAfter = 5.0;
+    _service->addEventTransition(4, _idle);
+
+    // enter and leave
+    post(Event{1});
+    poll(10.0);
+    EXPECT_EQ(_inner, _service->currentState());
+    post(Event{4});
+    poll(10.0);
+    EXPECT_EQ(_idle, currentState());
+    EXPECT_EQ(1, _service->getTransitions().size());
+
+    // not idle long enough
+    Timer::setVirtualTime(14.0);
+    poll(14.0);
+    EXPECT_TRUE(_service->built());
+
+    // released, the own transition is kept
+    Timer::setVirtualTime(15.0);
+    poll(15.0);
+    EXPECT_FALSE(_service->built());
+    EXPECT_TRUE(_service->getChildren().empty());
+    EXPECT_EQ(1, _service->getTransitions().size());
+
+    // built again on the next entry
+    post(Event{1});
+    poll(15.0);
+    EXPECT_EQ(2, _service->builds());
+    EXPECT_EQ(_inner, _service->currentState());
+    post(Event{2});
+    poll(15.0);
+    post(Event{3});
+    poll(15.0);
+    EXPECT_EQ(_idle, currentState());
+
+}
+
+
+TEST_F(LazyTest, ReenteredBeforeRelease) {
+
+    Timer::setVirtualTime(0.0);
+    _service->releaseAfter = 1.0;
+    _service->addEventTransition(4, _idle);
+
+    post(Event{1});
+    poll(0.0);
+    post(Event{4});
+    poll(0.0);
+
+    // entered again before the release time
+    Timer::setVirtualTime(0.5);
+    post(Event{1});
+    poll(0.5);
+    Timer::setVirtualTime(2.0);
+    poll(2.0);
+    EXPECT_TRUE(_service->built());
+    EXPECT_EQ(_inner, _service->currentState());
+    EXPECT_FALSE(_service->release());
+
+}
+
+
+TEST_F(LazyTest, Nested) {
+
+    Timer::setVirtualTime(0.0);
+
+    // service contains a lazy diagnostic state
+    LazyState *diagnostic = nullptr;
+    _service->releaseAfter = 1.0;
+    _service->builder = [this, &diagnostic](LazyState *state) {
+
+        auto inner = state->createState();
+        diagnostic = state->createState<LazyState>();
+        diagnostic->releaseAfter = 10.0;
+        diagnostic->builder = [](LazyState *d) { return d->createState(); };
+        inner->addEventTransition(2, diagnostic);
+        diagnostic->addEventTransition(3, _idle);
+
+        return inner;
+
+    };
+
+    post(Event{1});
+    poll(0.0);
+    post(Event{2});
+    poll(0.0);
+    EXPECT_TRUE(diagnostic->built());
+    post(Event{3});
+    poll(0.0);
+    EXPECT_EQ(_idle, currentState());
+
+    // the outer one is released first, the registration of the inner one is dropped
+    Timer::setVirtualTime(1.0);
+    poll(1.0);
+    EXPECT_FALSE(_service->built());
+    Timer::setVirtualTime(20.0);
+    poll(20.0);
+    EXPECT_EQ(_idle, currentState());
+
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,127 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-31.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <State.h>
+
+using namespace emb;
+
+class MonitorTest : public ::testing::Test, public State {
+
+protected:
+
+    StateMonitor _snapshotMonitor{};
+
+};
+
+
+TEST_F(MonitorTest, Snapshot) {
+
+    StateSnapshot snapshot{};
+
+    // hierarchy
+    auto a = createState();
+    auto b = createState();
+    auto b1 = b->createState();
+    a->addEventTransition(1, b1);
+    setMonitor(&_snapshotMonitor);
+
+    // initial path
+    a->initialize();
+    _snapshotMonitor.read(snapshot);
+    ASSERT_EQ(1, snapshot.depth);
+    EXPECT_EQ(a, snapshot.path[0]);
+    EXPECT_EQ(0, snapshot.transitions);
+
+    // transition into the sub-state
+    post(Event{1});
+    step();
+    EXPECT_LT(0, _snapshotMonitor.read(snapshot));
+    ASSERT_EQ(2, snapshot.depth);
+    EXPECT_EQ(b, snapshot.path[0]);
+    EXPECT_EQ(b1, snapshot.path[1]);
+    EXPECT_EQ(1, snapshot.transitions);
+    EXPECT_EQ(1, getTransitionCount());
+    EXPECT_TRUE(_snapshotMonitor.tryRead(snapshot));
+
+}
+
+
+TEST_F(MonitorTest, Concurrent) {
+
+    std::atomic<bool> done{false};
+    unsigned long inconsistent = 0, reads = 0;
+
+    // toggling machine
+    auto a = createState();
+    auto b = createState();
+    a->addTransition([](const Transition *) { return true; }, b);
+    b->addTransition([](const Transition *) { return true; }, a);
+    setMonitor(&_snapshotMonitor);
+    a->initialize();
+
+    // monitoring thread
+    std::thread monitor([&]() {
+
+        StateSnapshot snapshot{};
+        unsigned long last = 0;
+
+        do {
+
+            _snapshotMonitor.read(snapshot);
+            reads++;
+
+            // the path is never empty and the counter never decreases
+            if(snapshot.depth != 1 || (snapshot.path[0] != a && snapshot.path[0] != b) || snapshot.transitions < last)
+                inconsistent++;
+
+            last = snapshot.transitions;
+            std::this_thread::yield();
+
+        } while(!done);
+
+    });
+
+    for(int i = 0; i < 20000; ++i) {
+        poll();
+        if(i % 1000 == 0)
+            std::this_thread::yield();
+    }
+
+    done = true;
+    monitor.join();
+
+    EXPECT_EQ(20000, getTransitionCount());
+    EXPECT_LT(0, reads);
+    EXPECT_EQ(0, inconsistent);
+
+}
+
+
+#pragma clang diagnostic pop
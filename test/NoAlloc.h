@@ -0,0 +1,46 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-10.
+//
+
+
+#ifndef STATE_MACHINE_NO_ALLOC_H
+#define STATE_MACHINE_NO_ALLOC_H
+
+#include <gtest/gtest.h>
+#include <Audit.h>
+
+/** @brief Expects that the statement does not allocate on the current thread (allocations are reported on stderr) */
+#define EXPECT_NO_ALLOC(statement) \
+    do { unsigned long count_; { emb::ScopedNoAlloc scope_{}; statement; count_ = scope_.allocations(); } \
+         EXPECT_EQ(0ul, count_) << "allocations in: " #statement; } while(0)
+
+/** @brief Asserts that the statement does not allocate on the current thread */
+#define ASSERT_NO_ALLOC(statement) \
+    do { unsigned long count_; { emb::ScopedNoAlloc scope_{}; statement; count_ = scope_.allocations(); } \
+         ASSERT_EQ(0ul, count_) << "allocations in: " #statement; } while(0)
+
+/** @brief Expects the given number of allocations of the statement on the current thread (not reported) */
+#define EXPECT_ALLOCATIONS(expected, statement) \
+    do { auto start_ = emb::AllocationAudit::allocations(); statement; \
+         EXPECT_EQ((unsigned long) (expected), emb::AllocationAudit::allocations() - start_) << "in: " #statement; } while(0)
+
+#endif // STATE_MACHINE_NO_ALLOC_H
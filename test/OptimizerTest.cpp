@@ -0,0 +1,226 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-22.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <Guard.h>
+#include <Optimizer.h>
+
+using namespace emb;
+
+class OptimizerTest : public ::testing::Test {
+
+protected:
+
+    State root{};
+    State *a = nullptr;
+    State *b = nullptr;
+    State *c = nullptr;
+    State *d = nullptr;
+    State *pass = nullptr;
+
+    void SetUp() override {
+
+        root.name = "Root";
+        a = root.createState();
+        b = root.createState();
+        c = root.createState();
+        d = root.createState();
+        pass = root.createState();
+        d->createState();
+
+        a->name = "A";
+        b->name = "B";
+        c->name = "C";
+        d->name = "D";
+        pass->name = "Pass";
+
+        a->addEventTransition(1, pass);            // 0
+        a->addEventTransition(1, c);               // 1: shadowed by 0
+        a->addEventTransition(2, b);               // 2
+        a->addEventTransition(2, b);               // 3: duplicate of 2
+        a->addTransition(Guard(0.0), d);           // 4: dead
+        a->addTimedTransition(1.0, b);             // 5
+        a->addTimedTransition(2.0, c);             // 6: shadowed by 5
+
+        pass->addTransition(Guard(), b);
+        b->addTimedTransition(0.5, a);
+        c->addEventTransition(3, a);
+
+        a->initialize();
+
+    }
+
+    static const GraphFinding *find(const std::vector<GraphFinding> &findings, GraphFindingType type,
+                                    const std::string &state, long transition = -1) {
+
+        for(auto &f : findings) {
+            if(f.type == type && f.state == state && f.transition == transition)
+                return &f;
+        }
+
+        return nullptr;
+
+    }
+
+};
+
+
+TEST_F(OptimizerTest, Analyze) {
+
+    GraphOptimizer optimizer{&root};
+    EXPECT_EQ(8, optimizer.analyze());
+
+    auto &findings = optimizer.findings();
+
+    auto shadowed = find(findings, GraphFindingType::Shadowed, "A", 1);
+    ASSERT_NE(nullptr, shadowed);
+    EXPECT_EQ(0, shadowed->related);
+    EXPECT_EQ("C", shadowed->target);
+
+    auto duplicate = find(findings, GraphFindingType::Duplicate, "A", 3);
+    ASSERT_NE(nullptr, duplicate);
+    EXPECT_EQ(2, duplicate->related);
+
+    EXPECT_NE(nullptr, find(findings, GraphFindingType::Dead, "A", 4));
+    EXPECT_NE(nullptr, find(findings, GraphFindingType::Shadowed, "A", 6));
+
+    auto folded = find(findings, GraphFindingType::Folded, "Pass");
+    ASSERT_NE(nullptr, folded);
+    EXPECT_EQ("B", folded->target);
+
+    // C is only targeted by shadowed transitions, D by a dead one
+    EXPECT_NE(nullptr, find(findings, GraphFindingType::Unreachable, "C"));
+    EXPECT_NE(nullptr, find(findings, GraphFindingType::Unreachable, "D"));
+    EXPECT_NE(nullptr, find(findings, GraphFindingType::Unreachable, "D.#5"));
+
+    // nothing changed
+    EXPECT_EQ(7, a->getTransitions().size());
+    EXPECT_EQ(5, root.getChildren().size());
+    EXPECT_TRUE(optimizer.mapping().empty());
+
+}
+
+
+TEST_F(OptimizerTest, Optimize) {
+
+    GraphOptimizer optimizer{&root};
+    EXPECT_EQ(8, optimizer.optimize());
+
+    // transitions of A: event 1 (redirected), event 2, timeout
+    auto &transitions = a->getTransitions();
+    ASSERT_EQ(3, transitions.size());
+    EXPECT_EQ(b, transitions[0]->to);
+    EXPECT_EQ(b, transitions[1]->to);
+    EXPECT_EQ(b, transitions[2]->to);
+    EXPECT_DOUBLE_EQ(1.0, transitions[2]->after);
+
+    // C, D and the folded state are removed
+    ASSERT_EQ(2, root.getChildren().size());
+    EXPECT_EQ(a, root.getChildren()[0]);
+    EXPECT_EQ(b, root.getChildren()[1]);
+
+    // mapping to the optimized machine
+    auto &mapping = optimizer.mapping();
+    ASSERT_EQ(7, mapping.size());
+    EXPECT_EQ("Root", mapping[0].original);
+    EXPECT_EQ("Root", mapping[0].optimized);
+    EXPECT_EQ("A", mapping[1].optimized);
+    EXPECT_EQ("C", mapping[3].original);
+    EXPECT_EQ("", mapping[3].optimized);
+    EXPECT_EQ("Pass", mapping[6].original);
+    EXPECT_EQ("B", mapping[6].optimized);
+    EXPECT_EQ("B", optimizer.path(b));
+
+    // the event goes to B in one step
+    root.post(Event{1});
+    root.step();
+    EXPECT_EQ(b, root.currentState());
+
+    // nothing left to optimize
+    EXPECT_EQ(0, optimizer.analyze());
+
+}
+
+
+TEST_F(OptimizerTest, OrderedTransitions) {
+
+    // the statistics of the remaining transitions are kept
+    State machine{};
+    auto x = machine.createState();
+    auto y = machine.createState();
+    double value = 0.0;
+
+    auto guard = Guard::signal("value") > 1.0;
+    guard.bind("value", &value);
+
+    x->addTransition(Guard(0.0), y);
+    x->addTransition(guard, y);
+    x->addTransition(guard, y);
+    x->setTransitionOrder(TransitionOrder::Exclusive);
+    ASSERT_TRUE(x->setTransitionStatistics({{1, 0, 0.0}, {2, 1, 0.0}, {3, 2, 0.0}}));
+    x->initialize();
+
+    // identical guards of mutually exclusive transitions are not reported as shadowed
+    GraphOptimizer optimizer{&machine};
+    EXPECT_EQ(1, optimizer.optimize());
+    EXPECT_EQ(GraphFindingType::Dead, optimizer.findings()[0].type);
+    EXPECT_EQ("#1", optimizer.findings()[0].state);
+
+    ASSERT_EQ(2, x->getTransitions().size());
+    ASSERT_EQ(2, x->getTransitionStatistics().size());
+    EXPECT_EQ(2, x->getTransitionStatistics()[0].evaluations);
+    EXPECT_EQ(3, x->getTransitionStatistics()[1].evaluations);
+    EXPECT_EQ(2, x->getEvaluationOrder().size());
+
+    value = 2.0;
+    machine.step();
+    EXPECT_EQ(y, machine.currentState());
+
+}
+
+
+TEST_F(OptimizerTest, InitialStates) {
+
+    // without active or initial states, nothing is unreachable
+    State machine{};
+    auto x = machine.createState();
+    auto y = machine.createState();
+    auto z = machine.createState();
+    x->addEventTransition(1, y);
+
+    GraphOptimizer optimizer{&machine};
+    EXPECT_EQ(0, optimizer.analyze());
+
+    // starting from x, z is never entered
+    optimizer.addInitial(x);
+    EXPECT_EQ(1, optimizer.analyze());
+    EXPECT_EQ(GraphFindingType::Unreachable, optimizer.findings()[0].type);
+    EXPECT_EQ(optimizer.path(z), optimizer.findings()[0].state);
+
+}
+
+#pragma clang diagnostic pop
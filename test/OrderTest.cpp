@@ -0,0 +1,213 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-06.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <State.h>
+#include <StateJson.h>
+
+using namespace emb;
+
+class OrderTest : public ::testing::Test, public State {
+
+protected:
+
+    State *_a = nullptr;
+    State *_target = nullptr;
+    unsigned long _evaluations[3] = {};
+
+
+    void SetUp() override {
+
+        // a has two conditions which are never fulfilled and a likely one added last
+        _a = createState();
+        _a->name = "a";
+        _target = createState();
+        _target->name = "target";
+
+        _a->addTransition([this](const Transition *) { _evaluations[0]++; return false; }, _target);
+        _a->addTransition([this](const Transition *) { _evaluations[1]++; return false; }, _target);
+        _a->addTransition([this](const Transition *) { _evaluations[2]++; return true; }, _target);
+        _target->addTransition([](const Transition *) { return true; }, _a);
+
+        _a->initialize();
+
+    }
+
+};
+
+
+TEST_F(OrderTest, PriorityOrder) {
+
+    // a second fulfilled transition is never taken
+    auto other = createState();
+    _a->addTransition([](const Transition *) { return true; }, other);
+
+    for(int i = 0; i < 200; ++i)
+        step();
+
+    EXPECT_EQ(TransitionOrder::Priority, _a->getTransitionOrder());
+    EXPECT_EQ(100, _evaluations[0]);
+    EXPECT_EQ(100, _evaluations[1]);
+    EXPECT_EQ(100, _evaluations[2]);
+    EXPECT_TRUE(_a->getTransitionStatistics().empty());
+    EXPECT_EQ(100, getTransitionCount() / 2);
+
+}
+
+
+TEST_F(OrderTest, Adaptive) {
+
+    _a->setTransitionOrder(TransitionOrder::Adaptive);
+    ASSERT_EQ(3, _a->getEvaluationOrder().size());
+    EXPECT_EQ(0, _a->getEvaluationOrder()[0]);
+
+    for(int i = 0; i < 1000; ++i)
+        step();
+
+    // the likely transition is checked first
+    EXPECT_EQ(500, _evaluations[2]);
+    EXPECT_EQ(2, _a->getEvaluationOrder()[0]);
+    EXPECT_GT(100, _evaluations[0]);
+    EXPECT_GT(100, _evaluations[1]);
+
+    // statistics
+    auto &statistics = _a->getTransitionStatistics();
+    ASSERT_EQ(3, statistics.size());
+    EXPECT_EQ(500, statistics[2].evaluations);
+    EXPECT_EQ(500, statistics[2].hits);
+    EXPECT_EQ(0, statistics[0].hits);
+    EXPECT_EQ(_evaluations[0], statistics[0].evaluations);
+    EXPECT_LT(0.0, statistics[2].cost);
+
+    // the machine still behaves the same
+    EXPECT_EQ(1000, getTransitionCount());
+    EXPECT_EQ(_a, currentState());
+
+}
+
+
+TEST_F(OrderTest, Cost) {
+
+    // two transitions which are never fulfilled, the first is expensive
+    auto b = createState();
+    auto c = createState();
+    volatile double sum = 0.0;
+    b->addTransition([&sum](const Transition *) {
+        for(int i = 0; i < 20000; ++i)
+            sum = sum + 1.0;
+        return false;
+    }, c);
+    b->addTransition([](const Transition *) { return false; }, c);
+    b->setTransitionOrder(TransitionOrder::Adaptive);
+    b->initialize();
+
+    for(int i = 0; i < 200; ++i)
+        step();
+
+    // the cheap one is checked first
+    EXPECT_EQ(1, b->getEvaluationOrder()[0]);
+    EXPECT_LT(b->getTransitionStatistics()[1].cost, b->getTransitionStatistics()[0].cost);
+
+}
+
+
+TEST_F(OrderTest, AddedLater) {
+
+    _a->setTransitionOrder(TransitionOrder::Exclusive);
+
+    // transitions added after the order was set are appended
+    auto other = createState();
+    _a->addTransition([](const Transition *) { return false; }, other);
+    step();
+
+    ASSERT_EQ(4, _a->getEvaluationOrder().size());
+    EXPECT_EQ(3, _a->getEvaluationOrder()[3]);
+    EXPECT_EQ(4, _a->getTransitionStatistics().size());
+
+    // exclusive does not measure
+    EXPECT_EQ(0, _a->getTransitionStatistics()[0].evaluations);
+    EXPECT_EQ(_target, currentState());
+
+}
+
+
+TEST_F(OrderTest, Profile) {
+
+    _a->setTransitionOrder(TransitionOrder::Adaptive);
+    for(int i = 0; i < 1000; ++i)
+        step();
+
+    // save
+    std::string profile{};
+    char buffer[64];
+    JsonWriter writer(buffer, sizeof(buffer), [&profile](const char *data, unsigned long size) {
+        profile.append(data, size);
+    });
+
+    writeTransitionProfile(writer, *this);
+    writer.flush();
+    EXPECT_EQ(0, profile.find("[{\"state\":1,\"name\":\"a\",\"transitions\":[["));
+
+    // a second machine of the same shape with a fixed order
+    State machine{};
+    auto a = machine.createState();
+    a->name = "a";
+    auto target = machine.createState();
+    unsigned long evaluations[3] = {};
+    a->addTransition([&evaluations](const Transition *) { evaluations[0]++; return false; }, target);
+    a->addTransition([&evaluations](const Transition *) { evaluations[1]++; return false; }, target);
+    a->addTransition([&evaluations](const Transition *) { evaluations[2]++; return true; }, target);
+    a->setTransitionOrder(TransitionOrder::Exclusive);
+    a->initialize();
+
+    EXPECT_EQ(1, loadTransitionProfile(machine, profile.data(), profile.size()));
+    EXPECT_EQ(_a->getEvaluationOrder(), a->getEvaluationOrder());
+    EXPECT_EQ(500, a->getTransitionStatistics()[2].hits);
+
+    // the likely transition is checked first from the start
+    machine.step();
+    EXPECT_EQ(target, machine.currentState());
+    EXPECT_EQ(0, evaluations[0]);
+    EXPECT_EQ(1, evaluations[2]);
+
+    // mismatching entries are skipped, invalid profiles are rejected
+    std::string renamed = "[{\"state\":1,\"name\":\"b\",\"transitions\":[[1,1,0],[1,1,0],[1,1,0]]}]";
+    std::string shorter = "[{\"state\":1,\"name\":\"a\",\"transitions\":[[1,1,0]]}]";
+    std::string invalid = "[{\"state\":1,\"transitions\":[1,1,0]}]";
+    std::string negative = "[{\"state\":1,\"name\":\"a\",\"transitions\":[[-1,1,0],[1,1,0],[1,1,0]]}]";
+    std::string index = "[{\"state\":-1,\"name\":\"a\",\"transitions\":[[1,1,0],[1,1,0],[1,1,0]]}]";
+    EXPECT_EQ(0, loadTransitionProfile(machine, renamed.data(), renamed.size()));
+    EXPECT_EQ(0, loadTransitionProfile(machine, shorter.data(), shorter.size()));
+    EXPECT_EQ(-1, loadTransitionProfile(machine, invalid.data(), invalid.size()));
+    EXPECT_EQ(-1, loadTransitionProfile(machine, negative.data(), negative.size()));
+    EXPECT_EQ(0, loadTransitionProfile(machine, index.data(), index.size()));
+    EXPECT_EQ(500, a->getTransitionStatistics()[2].hits);
+
+}
+
+#pragma clang diagnostic pop
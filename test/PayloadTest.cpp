@@ -0,0 +1,154 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-14.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <State.h>
+#include <Payload.h>
+#include "NoAlloc.h"
+
+using namespace emb;
+
+namespace {
+
+    struct SensorFrame {
+
+        unsigned long sequence;
+        double level;
+        unsigned char samples[400];
+
+        SensorFrame(unsigned long sequence, double level) : sequence(sequence), level(level), samples{} {}
+
+    };
+
+}
+
+class PayloadTest : public ::testing::Test, public State {
+
+protected:
+
+    PayloadPool _pool{{64, 8}, {512, 4}};
+    EventType<SensorFrame> _frame{7};
+    EventType<double> _value{8};
+
+};
+
+
+TEST_F(PayloadTest, Pool) {
+
+    EXPECT_EQ(12, _pool.available(1));
+    EXPECT_EQ(4, _pool.available(100));
+    EXPECT_EQ(0, _pool.available(1000));
+
+    // smallest fitting class, then larger classes
+    void *blocks[9];
+    for(auto &b : blocks)
+        b = _pool.allocate(64);
+
+    EXPECT_EQ(3, _pool.available(100));
+    EXPECT_EQ(nullptr, _pool.allocate(1000));
+    EXPECT_EQ(1, _pool.exhausted());
+
+    for(auto b : blocks)
+        _pool.release(b);
+
+    EXPECT_EQ(12, _pool.available(1));
+
+    // shared payloads return their block with the last reference
+    {
+        auto payload = _pool.make<SensorFrame>(1ul, 2.0);
+        ASSERT_TRUE(payload);
+        EXPECT_EQ(3, _pool.available(sizeof(SensorFrame)));
+        auto copy = payload;
+        payload = nullptr;
+        EXPECT_EQ(3, _pool.available(sizeof(SensorFrame)));
+        EXPECT_EQ(2.0, static_cast<const SensorFrame *>(copy.get())->level);
+    }
+
+    EXPECT_EQ(4, _pool.available(sizeof(SensorFrame)));
+
+}
+
+
+TEST_F(PayloadTest, TypedEvents) {
+
+    double entered = 0.0;
+
+    // transition on the payload, entry callback with the payload
+    auto idle = createState();
+    auto alarm = createState();
+    _frame.addTransition(idle, [](const SensorFrame &f) { return f.level > 80.0; }, alarm);
+    alarm->onEnter = _frame.callback([&entered](const Transition *, const SensorFrame &f) { entered = f.level; });
+    alarm->addEventTransition(1, idle);
+    idle->initialize();
+    getEventQueue()->setCapacity(4);
+
+    // warm up (the event queue allocates on first use)
+    post(Event{1});
+    step();
+
+    // no allocation and no copy between producer and consumer
+    EXPECT_NO_ALLOC(_frame.post(this, _pool, 1ul, 20.0));
+    EXPECT_NO_ALLOC(_frame.post(this, _pool, 2ul, 90.0));
+    EXPECT_NO_ALLOC(_value.post(this, _pool, 85.0));
+    EXPECT_EQ(2, _pool.available(sizeof(SensorFrame) + 64));
+
+    EXPECT_NO_ALLOC(step());
+    EXPECT_EQ(idle, currentState());
+    EXPECT_EQ(1ul, _frame.current(this)->sequence);
+    EXPECT_EQ(nullptr, _value.current(this));
+
+    EXPECT_NO_ALLOC(step());
+    EXPECT_EQ(alarm, currentState());
+    EXPECT_EQ(90.0, entered);
+
+    // a value event does not match the frame type
+    EXPECT_NO_ALLOC(step());
+    EXPECT_EQ(nullptr, _frame.current(this));
+    EXPECT_EQ(85.0, *_value.current(this));
+
+    // blocks are returned after dispatch, also when no event follows
+    step();
+    EXPECT_EQ(nullptr, currentEvent());
+    EXPECT_EQ(4, _pool.available(sizeof(SensorFrame) + 64));
+    EXPECT_EQ(12, _pool.available(1));
+
+    // exhausted pool
+    for(int i = 0; i < 4; ++i)
+        EXPECT_TRUE(_frame.post(this, _pool, 3ul, 0.0));
+
+    EXPECT_FALSE(_frame.post(this, _pool, 4ul, 0.0));
+    EXPECT_EQ(1, _pool.exhausted());
+
+    // the machine drops all payloads before the pool is destroyed
+    for(int i = 0; i < 5; ++i)
+        step();
+
+    EXPECT_EQ(12, _pool.available(1));
+
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,135 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-19.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <Reactor.h>
+
+using namespace emb;
+
+
+TEST(ReactorTest, Machines) {
+
+    Reactor reactor{};
+    Timer timer{};
+
+    // timed machines
+    unsigned int toggles = 0;
+    State machines[50];
+    for(auto &m : machines) {
+
+        auto a = m.createState();
+        auto b = m.createState();
+        a->addTimedTransition(0.02, b);
+        b->addTimedTransition(0.02, a);
+        b->onEnter = [&toggles](const Transition *) { toggles++; };
+
+        a->initialize();
+        reactor.add(&m);
+
+    }
+
+    // event driven machine
+    State eventMachine{};
+    auto idle = eventMachine.createState();
+    auto done = eventMachine.createState();
+    idle->addEventTransition(1, done);
+    idle->initialize();
+    reactor.add(&eventMachine);
+
+    // pipe as event source
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_TRUE(reactor.addSource(fds[0], EPOLLIN, [&](int fd, unsigned int) {
+        char c;
+        auto r = read(fd, &c, 1);
+        (void) r;
+        reactor.post(&eventMachine, Event{1});
+    }));
+
+    // run for some time
+    timer.start();
+    unsigned long polls = 0;
+    while(timer.time() < 0.1) {
+
+        polls += reactor.runOnce(10);
+
+        // trigger the source once
+        if(timer.time() > 0.05 && eventMachine.currentState() == idle) {
+            auto w = write(fds[1], "x", 1);
+            (void) w;
+            reactor.runOnce(10);
+        }
+
+    }
+
+    // every machine toggled about twice, idle machines are not polled continuously
+    EXPECT_GE(toggles, 50u);
+    EXPECT_LT(polls, 2000u);
+    EXPECT_EQ(done, eventMachine.currentState());
+
+    // clean up
+    reactor.removeSource(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+
+}
+
+
+TEST(ReactorTest, NoDescriptors) {
+
+    // no file descriptors left
+    rlimit limit{};
+    ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+    auto next = dup(0);
+    ASSERT_GE(next, 0);
+    close(next);
+
+    auto reduced = limit;
+    reduced.rlim_cur = (rlim_t) next;
+    ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &reduced));
+    Reactor reactor{};
+    ASSERT_EQ(0, setrlimit(RLIMIT_NOFILE, &limit));
+
+    // the failure is reported, machines are still polled without waiting
+    State machine{};
+    machine.createState()->initialize();
+    reactor.add(&machine);
+
+    EXPECT_FALSE(reactor.good());
+    EXPECT_FALSE(reactor.addSource(0, EPOLLIN, [](int, unsigned int) {}));
+    EXPECT_EQ(1, reactor.runOnce());
+    reactor.run();
+
+    EXPECT_TRUE(Reactor{}.good());
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,138 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-27.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <Record.h>
+
+using namespace emb;
+
+class RecordTest : public ::testing::Test {
+
+protected:
+
+    struct Machine {
+
+        State root{};
+        State *idle = nullptr;
+        State *heating = nullptr;
+        State *cooling = nullptr;
+        double temperature = 20.0;
+
+        explicit Machine(double limit) {
+
+            idle = root.createState();
+            heating = root.createState();
+            cooling = root.createState();
+
+            idle->addEventTransition(1, heating);
+            heating->addTransition([this, limit](const Transition *) { return temperature > limit; }, cooling);
+            cooling->addTimedTransition(0.5, idle);
+
+        }
+
+    };
+
+};
+
+
+TEST_F(RecordTest, RecordAndReplay) {
+
+    // record a run with synthetic time
+    Machine live{25.0};
+    Recorder recorder{&live.root};
+    recorder.signal(&live.temperature);
+    recorder.begin(live.idle);
+
+    auto start = Timer::absoluteTime();
+    for(int i = 0; i < 100; ++i) {
+
+        if(i == 10)
+            recorder.post(Event{1});
+
+        live.temperature = 20.0 + 0.2 * i;
+        recorder.poll(start + 0.01 * i);
+
+    }
+
+    EXPECT_EQ(live.idle, live.root.currentState());
+    auto &log = recorder.log();
+
+    // replay on equal machine
+    Machine same{25.0};
+    Replay replay{&same.root};
+    replay.signal(&same.temperature);
+    ASSERT_TRUE(replay.run(log));
+
+    EXPECT_EQ(100, replay.steps());
+    EXPECT_EQ(3, replay.transitions());
+    EXPECT_TRUE(replay.differences().empty());
+    EXPECT_NEAR(0.99, replay.duration(), 1e-6);
+    EXPECT_EQ(same.idle, same.root.currentState());
+    EXPECT_DOUBLE_EQ(live.temperature, same.temperature);
+
+    // replay on changed machine
+    Machine changed{30.0};
+    Replay diff{&changed.root};
+    diff.signal(&changed.temperature);
+    ASSERT_TRUE(diff.run(log));
+
+    ASSERT_FALSE(diff.differences().empty());
+    auto &first = diff.differences()[0];
+    EXPECT_EQ(1, first.index);
+    EXPECT_EQ(3, first.expected);
+    EXPECT_EQ(3, first.actual);
+    EXPECT_NEAR(0.26, first.time, 1e-6);
+
+}
+
+
+TEST_F(RecordTest, File) {
+
+    Machine machine{25.0};
+    Recorder recorder{&machine.root};
+    recorder.begin(machine.idle);
+    recorder.post(Event{1});
+    recorder.poll();
+
+    // save and load
+    std::vector<unsigned char> log{};
+    ASSERT_TRUE(recorder.save("record_test.bin"));
+    ASSERT_TRUE(Replay::load("record_test.bin", log));
+    EXPECT_EQ(recorder.log(), log);
+    std::remove("record_test.bin");
+
+    // invalid log
+    log[0] = 'X';
+    Machine other{25.0};
+    Replay replay{&other.root};
+    EXPECT_FALSE(replay.run(log));
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,115 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-25.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <Scheduler.h>
+
+using namespace emb;
+
+class SchedulerTest : public ::testing::Test, public Scheduler {
+
+};
+
+
+TEST_F(SchedulerTest, RateGroups) {
+
+    State fast{}, slow{};
+    std::vector<std::string> order{};
+    int fastSteps = 0, slowSteps = 0, subSteps = 0;
+
+    // machines
+    fast.onStep = [&](State *) { fastSteps++; order.emplace_back("fast"); };
+    slow.onStep = [&](State *) { slowSteps++; order.emplace_back("slow"); };
+
+    // slow sub-state with its own period
+    auto sub = slow.createState();
+    sub->setTimeStepSize(0.02);
+    sub->onStep = [&](State *) { subSteps++; };
+    sub->initialize();
+    fast.initialize();
+
+    // groups are sorted by period
+    EXPECT_EQ(0, add(&slow, 0.01));
+    EXPECT_EQ(0, add(&fast, 0.001));
+    EXPECT_EQ(2, groups());
+    EXPECT_DOUBLE_EQ(0.001, basePeriod());
+
+    // 100 ms in virtual time
+    for(int k = 0; k < 100; ++k)
+        tick(1000.0 + k * basePeriod());
+
+    EXPECT_EQ(100, fastSteps);
+    EXPECT_EQ(10, slowSteps);
+    EXPECT_EQ(5, subSteps);
+
+    // fast group first
+    ASSERT_LE(2, order.size());
+    EXPECT_EQ("fast", order[0]);
+    EXPECT_EQ("slow", order[1]);
+
+    // statistics
+    auto statistics = this->statistics(1);
+    EXPECT_DOUBLE_EQ(0.01, statistics.period);
+    EXPECT_EQ(10, statistics.steps);
+    EXPECT_LE(0.0, statistics.utilisation);
+    EXPECT_GE(statistics.busy, statistics.worst);
+
+    resetStatistics();
+    EXPECT_EQ(0, this->statistics(0).steps);
+
+}
+
+
+TEST_F(SchedulerTest, Run) {
+
+    State machine{};
+    int steps = 0;
+
+    // stop after 20 steps
+    machine.onStep = [&](State *) {
+        if(++steps == 20)
+            stop();
+    };
+
+    machine.setTimeStepSize(0.005);
+    machine.initialize();
+    add(&machine);
+
+    // run on the base clock
+    auto start = Timer::absoluteTime();
+    run();
+
+    EXPECT_EQ(20, steps);
+    EXPECT_NEAR(0.1, Timer::absoluteTime() - start, 0.05);
+    EXPECT_EQ(20, statistics(0).steps);
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,265 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-16.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include <Series.h>
+#include "NoAlloc.h"
+
+using namespace emb;
+
+class SeriesTest : public ::testing::Test {
+
+protected:
+
+    State root{};
+    State *low = nullptr;
+    State *high = nullptr;
+    double level = 0.0;
+    double pressure = 1.0;
+    std::string path{};
+
+    void SetUp() override {
+
+        low = root.createState();
+        high = root.createState();
+        low->addTransition([this](const Transition *) { return level > 50.0; }, high);
+        high->addTransition([this](const Transition *) { return level <= 50.0; }, low);
+
+        path = "/tmp/series_test_" + std::to_string((long) ::testing::UnitTest::GetInstance()->random_seed()) + ".bin";
+
+    }
+
+    void TearDown() override {
+
+        std::remove(path.c_str());
+        for(int i = 1; i < 4; ++i)
+            std::remove((path + "." + std::to_string(i)).c_str());
+
+    }
+
+    /** Runs the machine for the given number of 1 ms samples starting at the given sample */
+    void run(SeriesRecorder &recorder, int from, int samples) {
+
+        for(int i = from; i < from + samples; ++i) {
+
+            level = (double) (i % 100);
+            pressure = 1.0 + 0.001 * (i % 7);
+            root.step();
+            recorder.record(1000.0 + 0.001 * i);
+
+        }
+
+    }
+
+};
+
+
+TEST_F(SeriesTest, RoundTrip) {
+
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 0.01);
+    recorder.addSignal("pressure", &pressure, 0.0001);
+    recorder.setBlockSize(64);
+    ASSERT_TRUE(recorder.open(path.c_str()));
+
+    low->initialize();
+    run(recorder, 0, 1000);
+    recorder.close();
+
+    EXPECT_EQ(1000, recorder.recorded());
+
+    SeriesReader reader{};
+    ASSERT_TRUE(reader.open(path.c_str()));
+    ASSERT_EQ(2, reader.signals().size());
+    EXPECT_EQ("level", reader.signals()[0]);
+    EXPECT_EQ("pressure", reader.signals()[1]);
+
+    // all samples
+    int i = 0;
+    auto count = reader.query(0.0, 2000.0, [this, &i](const SeriesSample &sample) {
+
+        EXPECT_NEAR(1000.0 + 0.001 * i, sample.time, 1e-6);
+        EXPECT_NEAR((double) (i % 100), sample.values[0], 1e-9);
+        EXPECT_NEAR(1.0 + 0.001 * (i % 7), sample.values[1], 1e-9);
+
+        // state after the step of the sample
+        EXPECT_EQ(i % 100 > 50 ? 2 : 1, sample.state);
+        i++;
+
+    });
+
+    EXPECT_EQ(1000, count);
+    EXPECT_EQ(1000, i);
+    EXPECT_EQ(16, reader.blocks());
+    EXPECT_EQ(16, reader.decoded());
+
+    // regular time stamps and piecewise linear signals are compressed (raw: 1000 * 4 * 8 bytes)
+    EXPECT_LT(recorder.written(), 1000u * 4u);
+
+}
+
+
+TEST_F(SeriesTest, NoAllocation) {
+
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 1.0);
+    recorder.addSignal("pressure", &pressure, 0.0001);
+    recorder.setBlockSize(100);
+    ASSERT_TRUE(recorder.open(path.c_str()));
+
+    low->initialize();
+    run(recorder, 0, 1);
+
+    // the buffers of a block are reserved on open (including writing the blocks)
+    EXPECT_NO_ALLOC(run(recorder, 1, 300));
+    recorder.close();
+
+}
+
+
+TEST_F(SeriesTest, RangeQuery) {
+
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 1.0);
+    recorder.setBlockSize(100);
+    ASSERT_TRUE(recorder.open(path.c_str()));
+
+    low->initialize();
+    run(recorder, 0, 10000);
+    recorder.close();
+
+    SeriesReader reader{};
+    ASSERT_TRUE(reader.open(path.c_str()));
+
+    // samples 2050 ... 2249 in blocks 20, 21 and 22
+    double first = 0.0, last = 0.0;
+    auto count = reader.query(1002.05, 1002.249, [&first, &last](const SeriesSample &sample) {
+
+        if(first == 0.0)
+            first = sample.time;
+
+        last = sample.time;
+
+    });
+
+    EXPECT_EQ(200, count);
+    EXPECT_NEAR(1002.05, first, 1e-6);
+    EXPECT_NEAR(1002.249, last, 1e-6);
+    EXPECT_EQ(100, reader.blocks());
+    EXPECT_EQ(3, reader.decoded());
+
+    // empty range
+    EXPECT_EQ(0, reader.query(2000.0, 3000.0, [](const SeriesSample &) { FAIL(); }));
+    EXPECT_EQ(0, reader.decoded());
+
+}
+
+
+TEST_F(SeriesTest, Rotation) {
+
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 1.0);
+    recorder.setBlockSize(100);
+    ASSERT_TRUE(recorder.open(path.c_str(), 1000, 3));
+
+    low->initialize();
+    run(recorder, 0, 20000);
+    recorder.close();
+
+    // bounded storage: the three files only keep the latest samples
+    SeriesReader reader{};
+    ASSERT_TRUE(reader.open(path.c_str(), 3));
+
+    double first = 0.0, previous = 0.0;
+    auto count = reader.query(0.0, 2000.0, [&first, &previous](const SeriesSample &sample) {
+
+        if(first == 0.0)
+            first = sample.time;
+
+        // files are read from the oldest to the newest
+        EXPECT_GT(sample.time, previous);
+        previous = sample.time;
+
+    });
+
+    EXPECT_GT(count, 0);
+    EXPECT_LT(count, 20000);
+    EXPECT_GT(first, 1000.0);
+    EXPECT_NEAR(1019.999, previous, 1e-6);
+    EXPECT_GT(recorder.written(), 3000u);
+    EXPECT_GT(recorder.worstFlush(), 0.0);
+
+}
+
+
+TEST_F(SeriesTest, Truncated) {
+
+    SeriesRecorder recorder{&root};
+    recorder.addSignal("level", &level, 1.0);
+    recorder.setBlockSize(100);
+    ASSERT_TRUE(recorder.open(path.c_str()));
+
+    low->initialize();
+    run(recorder, 0, 200);
+    auto complete = recorder.written();
+    run(recorder, 200, 50);
+    recorder.close();
+
+    // cut the last block in its body and then in its header
+    for(auto size : {recorder.written() - 5, complete + 10}) {
+
+        ASSERT_EQ(0, truncate(path.c_str(), (off_t) size));
+
+        // the complete blocks are still read
+        SeriesReader reader{};
+        ASSERT_TRUE(reader.open(path.c_str()));
+        EXPECT_EQ(200, reader.query(0.0, 2000.0, [](const SeriesSample &) {}));
+
+    }
+
+}
+
+
+TEST_F(SeriesTest, InvalidFile) {
+
+    SeriesReader reader{};
+    EXPECT_FALSE(reader.open("/tmp/series_test_missing.bin"));
+
+    auto file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    std::fputs("not a series", file);
+    std::fclose(file);
+
+    EXPECT_FALSE(reader.open(path.c_str()));
+
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,278 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <ShmPublisher.h>
+#include <Swap.h>
+
+using namespace emb;
+
+class ShmTest : public ::testing::Test {
+
+protected:
+
+    std::string _name = "/emb_shm_test_" + std::to_string(getpid());
+
+};
+
+
+TEST_F(ShmTest, PublishAndRead) {
+
+    State machine{};
+    auto a = machine.createState();
+    auto b = machine.createState();
+    auto b1 = b->createState();
+    a->addEventTransition(1, b1);
+    b1->addEventTransition(2, a);
+
+    // publish
+    ShmPublisher publisher{};
+    ASSERT_TRUE(publisher.open(_name.c_str(), 2, 8));
+    a->initialize();
+    EXPECT_EQ(0, publisher.add(&machine, "controller"));
+
+    // read
+    ShmReader reader{};
+    ShmStatus status{};
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_EQ(1, reader.machines());
+    ASSERT_TRUE(reader.read(0, status));
+    EXPECT_EQ("controller", status.label);
+    ASSERT_EQ(1, status.path.size());
+    EXPECT_EQ(1, status.path[0]);
+    EXPECT_EQ(1, status.publications);
+    EXPECT_FALSE(reader.read(1, status));
+
+    // steps update in place
+    machine.post(Event{1});
+    machine.step();
+    machine.post(Event{2});
+    machine.step();
+    machine.post(Event{1});
+    machine.step();
+
+    ASSERT_TRUE(reader.read(0, status));
+    ASSERT_EQ(2, status.path.size());
+    EXPECT_EQ(2, status.path[0]);
+    EXPECT_EQ(3, status.path[1]);
+    EXPECT_EQ(2, status.times.size());
+    EXPECT_EQ(3, status.transitions);
+    EXPECT_EQ(4, status.publications);
+
+    // entries per state id
+    ASSERT_EQ(4, status.entries.size());
+    EXPECT_EQ(2, status.entries[1]);
+    EXPECT_EQ(2, status.entries[2]);
+    EXPECT_EQ(2, status.entries[3]);
+
+    // machine with too many states
+    State large{};
+    for(int i = 0; i < 8; ++i)
+        large.createState();
+
+    EXPECT_EQ(-1, publisher.add(&large, "large"));
+
+    // a replacing segment does not invalidate the mapping of the reader
+    ShmPublisher replacing{};
+    ASSERT_TRUE(replacing.open(_name.c_str(), 1, 1));
+    ASSERT_TRUE(reader.read(0, status));
+    EXPECT_EQ("controller", status.label);
+    replacing.close();
+
+    // segment is removed on close
+    publisher.close();
+    ShmReader closed{};
+    EXPECT_FALSE(closed.open(_name.c_str()));
+
+}
+
+
+TEST_F(ShmTest, HotSwap) {
+
+    // a -> b on event 1
+    auto build = [](bool extra) {
+
+        std::unique_ptr<State> machine{new State};
+        if(extra)
+            machine->createState()->name = "c";
+
+        auto a = machine->createState();
+        auto b = machine->createState();
+        a->name = "a";
+        b->name = "b";
+        a->addEventTransition(1, b);
+        a->initialize();
+        return machine;
+
+    };
+
+    ShmPublisher publisher{};
+    ASSERT_TRUE(publisher.open(_name.c_str(), 1, 8));
+
+    HotSwap swap{build(false)};
+    EXPECT_EQ(0, publisher.add(swap.machine(), "controller"));
+
+    // new definition with a state inserted before the others
+    auto next = build(true);
+    auto root = next.get();
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root)));
+    ASSERT_TRUE(swap.update());
+
+    // the replaced definition is detached and destroyed
+    EXPECT_EQ(1, swap.reclaim());
+
+    // the slot publishes the ids of the new definition
+    swap.machine()->post(Event{1});
+    swap.step();
+
+    ShmReader reader{};
+    ShmStatus status{};
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    ASSERT_TRUE(reader.read(0, status));
+    ASSERT_EQ(1, status.path.size());
+    EXPECT_EQ(3, status.path[0]);
+    EXPECT_EQ(4, status.entries.size());
+    EXPECT_EQ(1, status.entries[3]);
+
+    // detaches the new root
+    publisher.close();
+
+}
+
+
+TEST_F(ShmTest, HotSwapExceedingCapacity) {
+
+    auto build = [](unsigned int states) {
+
+        std::unique_ptr<State> machine{new State};
+        for(unsigned int i = 0; i < states; ++i)
+            machine->createState()->name = std::to_string(i);
+
+        machine->getChildren().front()->initialize();
+        return machine;
+
+    };
+
+    ShmPublisher publisher{};
+    ASSERT_TRUE(publisher.open(_name.c_str(), 1, 3));
+
+    HotSwap swap{build(2)};
+    EXPECT_EQ(0, publisher.add(swap.machine(), "controller"));
+
+    // the new definition has too many states: the slot is detached and keeps its last publication
+    auto next = build(3);
+    auto root = next.get();
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root)));
+    ASSERT_TRUE(swap.update());
+    swap.step();
+
+    // the slot is not attached to later definitions either
+    next = build(3);
+    root = next.get();
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root)));
+    ASSERT_TRUE(swap.update());
+    EXPECT_EQ(2, swap.reclaim());
+
+    ShmReader reader{};
+    ShmStatus status{};
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    ASSERT_TRUE(reader.read(0, status));
+    EXPECT_EQ(1, status.publications);
+    EXPECT_EQ(3, status.entries.size());
+
+    // the destroyed roots are not touched
+    publisher.close();
+
+}
+
+
+TEST_F(ShmTest, InvalidLayout) {
+
+    // segment of another writer: one machine with 2 states and a path depth of 1
+    std::uint64_t words[ShmHeaderWords + ShmSlotFixedWords + 4] = {};
+    words[0] = EMB_SHM_MAGIC | ((std::uint64_t) EMB_SHM_VERSION << 32);
+    words[1] = ShmHeaderWords | ((std::uint64_t) (ShmSlotFixedWords + 4) << 32);
+    words[2] = 1 | ((std::uint64_t) 2 << 32);
+    words[3] = 1;
+    words[4] = 1;
+    words[ShmHeaderWords + 5] = 2 | ((std::uint64_t) 1 << 32);
+
+    auto write = [this, &words]() {
+        shm_unlink(_name.c_str());
+        auto fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        ASSERT_LE(0, fd);
+        ASSERT_EQ((ssize_t) sizeof(words), ::write(fd, words, sizeof(words)));
+        ::close(fd);
+    };
+
+    ShmReader reader{};
+    ShmStatus status{};
+
+    write();
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_TRUE(reader.read(0, status));
+    EXPECT_EQ(1, status.path.size());
+
+    // active path deeper than the path capacity
+    words[ShmHeaderWords + 5] = 2 | ((std::uint64_t) 2 << 32);
+    write();
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_FALSE(reader.read(0, status));
+    words[ShmHeaderWords + 5] = 2 | ((std::uint64_t) 1 << 32);
+
+    // slot smaller than its fixed part
+    words[1] = ShmHeaderWords | ((std::uint64_t) 4 << 32);
+    write();
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_FALSE(reader.read(0, status));
+
+    // slot size not matching the capacities
+    words[1] = ShmHeaderWords | ((std::uint64_t) (ShmSlotFixedWords + 4) << 32);
+    words[3] = 100;
+    write();
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_FALSE(reader.read(0, status));
+    words[3] = 1;
+
+    // header offset beyond the segment
+    words[1] = 1000 | ((std::uint64_t) (ShmSlotFixedWords + 4) << 32);
+    write();
+    ASSERT_TRUE(reader.open(_name.c_str()));
+    EXPECT_FALSE(reader.read(0, status));
+
+    reader.close();
+    shm_unlink(_name.c_str());
+
+}
+
+
+#pragma clang diagnostic pop
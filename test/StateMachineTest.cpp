@@ -26,6 +26,7 @@
 #pragma ide diagnostic ignored "cert-err58-cpp"
 
 #include <gtest/gtest.h>
+#include <cmath>
 #include <State.h>
 
 #ifndef EPS_TIME
@@ -328,4 +329,51 @@ TEST_F(StateMachineTest, TimedExecution) {
 }
 
 
+TEST_F(StateMachineTest, Polling) {
+
+    Timer timer{};
+
+    // start and end
+    auto start = createState();
+    auto end = createState();
+
+    // transitions
+    start->addTimedTransition(0.1, end);
+    end->addTimedTransition(0.05, start);
+
+    // init
+    start->initialize();
+    timer.start();
+
+    // the deadline is the timed transition
+    auto deadline = poll();
+    EXPECT_EQ(start, currentState());
+    EXPECT_NEAR(Timer::absoluteTime() + 0.1, deadline, EPS_TIME);
+
+    // poll does not block
+    EXPECT_LT(timer.time(), EPS_TIME);
+
+    // wait for the deadline
+    while(Timer::absoluteTime() < deadline)
+        Timer::delay(0.001);
+
+    EXPECT_NEAR(Timer::absoluteTime() + 0.05, poll(), EPS_TIME);
+    EXPECT_EQ(end, currentState());
+
+    // nothing is scheduled without timed transitions and time step size
+    auto other = createState();
+    end->addTransition([](const Transition *) { return true; }, other);
+    poll();
+    EXPECT_EQ(other, currentState());
+    EXPECT_TRUE(std::isinf(poll()));
+
+    // the time step size defines the deadline
+    setTimeStepSize(0.2);
+    auto now = Timer::absoluteTime();
+    EXPECT_NEAR(now + 0.2, poll(), EPS_TIME);
+    EXPECT_NEAR(now + 0.2, poll(), EPS_TIME);
+
+}
+
+
 #pragma clang diagnostic pop
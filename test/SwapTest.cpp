@@ -0,0 +1,266 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-24.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <Record.h>
+#include <Swap.h>
+#include "NoAlloc.h"
+
+using namespace emb;
+
+class SwapTest : public ::testing::Test {
+
+protected:
+
+    double temperature = 20.0;
+
+    /** Idle -> Heating.Low on event 1, Low -> High above the limit, optionally with an Off state */
+    std::unique_ptr<State> build(double limit, bool off = false) {
+
+        std::unique_ptr<State> root{new State};
+        auto idle = root->createState();
+        auto heating = root->createState();
+        auto low = heating->createState();
+        auto high = heating->createState();
+
+        idle->name = "Idle";
+        heating->name = "Heating";
+        low->name = "Low";
+        high->name = "High";
+
+        idle->addEventTransition(1, low);
+        low->addTransition([this, limit](const Transition *) { return temperature > limit; }, high);
+
+        if(off) {
+            auto state = root->createState();
+            state->name = "Off";
+            heating->addEventTransition(2, state);
+        }
+
+        idle->initialize();
+
+        return root;
+
+    }
+
+    static State *find(State *state, const std::string &name) {
+
+        for(auto s : state->getChildren()) {
+
+            if(s->name == name)
+                return s;
+
+            auto sub = find(s, name);
+            if(sub != nullptr)
+                return sub;
+
+        }
+
+        return nullptr;
+
+    }
+
+    void TearDown() override {
+
+        Timer::resetVirtualTime();
+
+    }
+
+};
+
+
+TEST_F(SwapTest, KeepsActiveStateAndTimers) {
+
+    Timer::setVirtualTime(100.0);
+
+    HotSwap swap{build(50.0)};
+    auto old = swap.machine();
+    old->post(Event{1});
+    swap.step();
+    ASSERT_EQ("Low", old->currentState()->currentState()->name);
+
+    // two seconds in Low with an event queued
+    Timer::setVirtualTime(102.0);
+    old->post(Event{2});
+
+    auto next = build(40.0, true);
+    auto root = next.get();
+    std::string error{};
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root), &error)) << error;
+
+    // the swap neither allocates nor runs callbacks
+    bool swapped = false;
+    EXPECT_NO_ALLOC(swapped = swap.update());
+    EXPECT_TRUE(swapped);
+    EXPECT_EQ(1, swap.swaps());
+    EXPECT_EQ(root, swap.machine());
+
+    auto low = find(root, "Low");
+    EXPECT_EQ(find(root, "Heating"), root->currentState());
+    EXPECT_EQ(low, root->currentState()->currentState());
+    EXPECT_NEAR(2.0, low->getTime(), 1e-9);
+    EXPECT_EQ(1, root->getTransitionCount());
+    EXPECT_EQ(1, root->getEventQueue()->size());
+
+    // new threshold
+    temperature = 45.0;
+    swap.step();
+    EXPECT_EQ(find(root, "Off"), root->currentState());
+
+}
+
+
+TEST_F(SwapTest, Callback) {
+
+    HotSwap swap{build(50.0)};
+    RecordMachine record{swap.machine()};
+
+    // the monitor is detached from the replaced root
+    StateMonitor monitor{};
+    swap.machine()->setMonitor(&monitor);
+
+    State *from = nullptr, *to = nullptr;
+    swap.onSwap = [&from, &to, &record](State *replaced, State *machine) {
+        from = replaced;
+        to = machine;
+        record.rebind(machine);
+    };
+
+    auto old = swap.machine();
+    auto next = build(50.0, true);
+    auto root = next.get();
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root)));
+    ASSERT_TRUE(swap.update());
+
+    EXPECT_EQ(old, from);
+    EXPECT_EQ(root, to);
+    EXPECT_EQ(-1, record.id(find(old, "Idle")));
+    EXPECT_EQ(1, record.id(find(root, "Idle")));
+    EXPECT_EQ(5, record.id(find(root, "Off")));
+
+    StateSnapshot snapshot{};
+    EXPECT_EQ(1, monitor.read(snapshot));
+    EXPECT_EQ(find(root, "Idle"), snapshot.path[0]);
+
+}
+
+
+TEST_F(SwapTest, Validation) {
+
+    HotSwap swap{build(50.0)};
+
+    // High is missing
+    std::unique_ptr<State> next{new State};
+    auto heating = next->createState();
+    heating->name = "Heating";
+    next->createState()->name = "Idle";
+    heating->createState()->name = "Low";
+
+    std::string error{};
+    auto root = next.get();
+    EXPECT_FALSE(swap.prepare(std::move(next), mapByName(root), &error));
+    EXPECT_EQ("state Heating.High is not mapped to a state of the new machine", error);
+
+    // mapped outside of the mapping of the parent
+    auto other = build(50.0);
+    auto idle = find(other.get(), "Idle");
+    auto target = other.get();
+    auto byName = mapByName(target);
+    EXPECT_FALSE(swap.prepare(std::move(other), [&byName, idle](const State *state) {
+        return state->name == "Low" ? idle : byName(state);
+    }, &error));
+    EXPECT_EQ("state Heating.Low is not mapped below the mapping of its parent", error);
+
+    EXPECT_FALSE(swap.update());
+    EXPECT_EQ(0, swap.swaps());
+
+}
+
+
+TEST_F(SwapTest, Reclaim) {
+
+    HotSwap swap{build(50.0)};
+
+    // a reader keeps the first definition alive
+    auto reader = swap.acquire();
+    EXPECT_EQ(swap.machine(), reader.get());
+
+    auto next = build(40.0);
+    auto root = next.get();
+    ASSERT_TRUE(swap.prepare(std::move(next), mapByName(root)));
+    ASSERT_TRUE(swap.update());
+
+    EXPECT_EQ(root, swap.acquire().get());
+    EXPECT_EQ(0, swap.reclaim());
+
+    reader.reset();
+    EXPECT_EQ(1, swap.reclaim());
+
+}
+
+
+TEST_F(SwapTest, ConcurrentPrepare) {
+
+    HotSwap swap{build(50.0)};
+    std::atomic<bool> running{true};
+
+    // builder thread preparing definitions and reclaiming old ones
+    std::thread builder([this, &swap, &running]() {
+
+        while(running) {
+
+            auto next = build(50.0);
+            auto root = next.get();
+            swap.prepare(std::move(next), mapByName(root));
+            swap.reclaim();
+            std::this_thread::yield();
+
+        }
+
+    });
+
+    for(int i = 0; i < 2000 && swap.swaps() < 20; ++i) {
+
+        if(i % 10 == 0)
+            swap.machine()->post(Event{1});
+
+        swap.step();
+        std::this_thread::yield();
+
+    }
+
+    running = false;
+    builder.join();
+
+    EXPECT_GT(swap.swaps(), 0);
+    EXPECT_NE(nullptr, swap.machine()->currentState());
+
+}
+
+#pragma clang diagnostic pop
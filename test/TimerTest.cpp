@@ -26,6 +26,9 @@
 #pragma ide diagnostic ignored "cert-err58-cpp"
 
 #include <gtest/gtest.h>
+#include <chrono>
+#include <climits>
+#include <State.h>
 #include <Timer.h>
 
 class TimerTest : public ::testing::Test, public emb::Timer {
@@ -33,6 +36,11 @@ class TimerTest : public ::testing::Test, public emb::Timer {
 };
 
 
+class TickTimerTest : public ::testing::Test, public emb::TickTimer {
+
+};
+
+
 TEST_F(TimerTest, Start) {
 
     EXPECT_NEAR(0.0, this->_startTime, 1e-12);
@@ -106,4 +114,67 @@ TEST_F(TimerTest, Pause) {
 }
 
 
+TEST_F(TickTimerTest, WrapAround) {
+
+    using emb::Ticks;
+
+    // differences across the wrap-around of the clock
+    EXPECT_EQ(20, elapsed(ULONG_MAX - 9, 10));
+    EXPECT_TRUE(reached(5, ULONG_MAX - 4));
+    EXPECT_FALSE(reached(ULONG_MAX - 4, 5));
+    EXPECT_TRUE(reached(100, 100));
+
+    // timer started shortly before the wrap-around
+    _startTicks = ULONG_MAX - 99;
+    EXPECT_EQ(50, milliseconds(ULONG_MAX - 49));
+    EXPECT_EQ(300, milliseconds(200));
+
+    // pause
+    _pauseTicks = 100;
+    _paused = true;
+    EXPECT_EQ(200, milliseconds(5000));
+
+}
+
+
+TEST_F(TickTimerTest, StateTransitions) {
+
+    emb::State machine{};
+    auto a = machine.createState();
+    auto b = machine.createState();
+
+    // integer durations
+    a->addTimedTransition(std::chrono::milliseconds(250), b);
+    b->addTimedTransition(std::chrono::microseconds(100500), a);
+    EXPECT_DOUBLE_EQ(0.101, b->getTransitions()[0]->after);
+
+    // run on virtual time
+    emb::Timer::setVirtualTime(1000.0);
+    a->initialize();
+
+    emb::Timer::setVirtualTime(1000.249);
+    machine.poll(1000.249);
+    EXPECT_EQ(a, machine.currentState());
+
+    emb::Timer::setVirtualTime(1000.250);
+    machine.poll(1000.250);
+    EXPECT_EQ(b, machine.currentState());
+    EXPECT_EQ(0, b->getTickTimer()->milliseconds());
+
+    emb::Timer::setVirtualTime(1000.351);
+    machine.poll(1000.351);
+    EXPECT_EQ(a, machine.currentState());
+    emb::Timer::resetVirtualTime();
+
+    // integer step size
+    machine.setTimeStepSize(std::chrono::milliseconds(20));
+    EXPECT_DOUBLE_EQ(0.02, machine.getTimeStepSize());
+
+    start();
+    machine.step();
+    EXPECT_NEAR(19, milliseconds(), 5);
+
+}
+
+
 #pragma clang diagnostic pop
@@ -0,0 +1,169 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-05-29.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <Lazy.h>
+#include <State.h>
+#include <Trace.h>
+
+using namespace emb;
+
+class TraceTest : public ::testing::Test, public State {
+
+protected:
+
+    void SetUp() override {
+
+        Trace::clear();
+        Trace::enable(true);
+
+    }
+
+    std::string _export() {
+
+        char buffer[65536];
+        JsonWriter writer(buffer, sizeof(buffer));
+        Trace::write(writer);
+
+        return std::string(writer.data(), writer.size());
+
+    }
+
+};
+
+
+TEST_F(TraceTest, Records) {
+
+    // spans on two threads
+    Trace::setThreadName("main");
+    {
+        TraceScope scope("work", "test");
+    }
+
+    std::thread worker([]() {
+        Trace::span("other", "test", 10.0, 15.0);
+    });
+    worker.join();
+
+    int id = 0;
+    Trace::begin("state", "residency", &id);
+    Trace::end("state", "residency", &id);
+    EXPECT_EQ(4, Trace::size());
+
+    // export
+    auto json = _export();
+    EXPECT_NE(std::string::npos, json.find("\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"work\",\"cat\":\"test\",\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, json.find("\"dur\":5"));
+    EXPECT_NE(std::string::npos, json.find("\"ph\":\"b\""));
+    EXPECT_NE(std::string::npos, json.find("\"thread_name\""));
+
+    // disabled
+    Trace::enable(false);
+    Trace::span("ignored", "test", 0.0, 1.0);
+    EXPECT_EQ(4, Trace::size());
+
+    Trace::clear();
+    EXPECT_EQ(0, Trace::size());
+
+}
+
+
+TEST_F(TraceTest, Hooks) {
+
+    auto a = createState();
+    auto b = createState();
+    a->name = "a";
+    b->name = "b";
+
+    a->onStep = [](State *) {};
+    b->onEnter = [](const Transition *) {};
+    a->addTransition([](const Transition *) { return true; }, b);
+    a->initialize();
+    step();
+
+#ifdef EMB_TRACE
+
+    // residency of the initial state, guard, leave residency of a, residency and entry of b
+    auto json = _export();
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"a\",\"cat\":\"state\",\"ph\":\"b\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"a\",\"cat\":\"guard\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"a\",\"cat\":\"state\",\"ph\":\"e\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"b\",\"cat\":\"state\",\"ph\":\"b\""));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"b\",\"cat\":\"enter\""));
+
+#else
+
+    // hooks are compiled out
+    EXPECT_EQ(0, Trace::size());
+
+#endif
+
+}
+
+
+TEST_F(TraceTest, DestroyedStates) {
+
+    // lazy sub-states with names, released before the export
+    auto idle = createState();
+    auto service = createState<LazyState>();
+    service->builder = [](LazyState *state) {
+        auto inner = state->createState();
+        inner->name = std::string("inner state with a name too long for small strings");
+        return inner;
+    };
+
+    idle->addEventTransition(1, service);
+    service->addEventTransition(2, idle);
+    idle->initialize();
+
+    post(Event{1});
+    step();
+    post(Event{2});
+    step();
+    EXPECT_TRUE(service->release());
+
+    // names of states which no longer exist
+    auto name = std::string("temporary");
+    Trace::span(name.c_str(), "test", 0.0, 1.0);
+    name.assign("overwritten");
+
+#ifdef EMB_TRACE
+
+    auto json = _export();
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"inner state with a name too long for small strings\",\"cat\":\"state\",\"ph\":\"b\""));
+
+#endif
+
+    EXPECT_NE(std::string::npos, _export().find("\"name\":\"temporary\""));
+
+}
+
+
+#pragma clang diagnostic pop
@@ -0,0 +1,217 @@
+// Copyright (c) 2021 Jens Klimke. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-12.
+//
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunknown-pragmas"
+#pragma ide diagnostic ignored "cert-err58-cpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <State.h>
+#include <Worker.h>
+
+using namespace emb;
+
+class WorkerTest : public ::testing::Test, public State {
+
+protected:
+
+    /** Steps and delivers until the predicate holds (or the timeout has passed) */
+    template<typename P>
+    bool run(WorkerPool &pool, P predicate, double timeout = 5.0) {
+
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+        while(!predicate() && std::chrono::steady_clock::now() < end) {
+            pool.deliver();
+            step();
+            std::this_thread::yield();
+        }
+
+        return predicate();
+
+    }
+
+};
+
+
+TEST_F(WorkerTest, HoldUntilCompleted) {
+
+    WorkerPool pool{2, 4};
+    std::atomic<bool> release{false};
+    std::atomic<int> written{0};
+
+    // writing holds until the (slow) flash write has completed
+    auto idle = createState();
+    auto writing = createState();
+    auto done = createState();
+    idle->addEventTransition(1, writing);
+    writing->addEventTransition(2, done);
+    writing->onEnter = pool.action([&release, &written] {
+        while(!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        written++;
+    }, 2);
+
+    idle->initialize();
+    post(Event{1});
+
+    // the control loop keeps stepping while the action runs
+    double worst = 0.0;
+    for(int i = 0; i < 20; ++i) {
+
+        auto t0 = std::chrono::steady_clock::now();
+        pool.deliver();
+        step();
+        worst = std::max(worst, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+    }
+
+    EXPECT_EQ(writing, currentState());
+    EXPECT_EQ(1, pool.pending());
+    EXPECT_GT(0.5, worst);
+
+    // completion is posted back
+    release = true;
+    EXPECT_TRUE(run(pool, [&] { return currentState() == done; }));
+    EXPECT_EQ(1, written.load());
+    EXPECT_EQ(1, pool.completed());
+    EXPECT_EQ(0, pool.pending());
+
+}
+
+
+TEST_F(WorkerTest, Rejected) {
+
+    WorkerPool pool{1, 1};
+    std::atomic<bool> release{false};
+    std::atomic<int> started{0};
+    auto block = [&release, &started] {
+        started++;
+        while(!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    auto idle = createState();
+    idle->initialize();
+
+    // one running, one queued, the third one is skipped and completes immediately
+    EXPECT_TRUE(pool.submit(block, this, 5));
+    EXPECT_TRUE(run(pool, [&] { return started.load() == 1; }));
+    EXPECT_TRUE(pool.submit(block, this, 6));
+    EXPECT_FALSE(pool.submit(block, this, 7));
+    EXPECT_EQ(1, pool.rejected());
+    EXPECT_EQ(1, getEventQueue()->size());
+
+    release = true;
+    EXPECT_TRUE(run(pool, [&] { return pool.completed() == 2; }));
+
+}
+
+
+TEST_F(WorkerTest, LockHeld) {
+
+    struct Pool : public WorkerPool {
+        using WorkerPool::WorkerPool;
+        using WorkerPool::_mutex;
+    };
+
+    Pool pool{1, 2};
+    std::atomic<bool> locked{false};
+
+    auto idle = createState();
+    idle->initialize();
+
+    // another thread holds the lock for a moment (like a worker adding a completion)
+    std::thread holder([&pool, &locked] {
+        std::lock_guard<std::mutex> lock(pool._mutex);
+        locked = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    });
+
+    while(!locked.load())
+        std::this_thread::yield();
+
+    // the job is queued after the wait, not rejected
+    EXPECT_TRUE(pool.submit([] {}, this, 5));
+    holder.join();
+
+    auto wait = [&pool](unsigned long completed) {
+        auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(pool.completed() < completed && std::chrono::steady_clock::now() < end)
+            std::this_thread::yield();
+    };
+
+    // undelivered completions count as queued jobs
+    wait(1);
+    EXPECT_TRUE(pool.submit([] {}, this, 5));
+    EXPECT_TRUE(pool.submit([] {}, this, 5));
+    wait(3);
+
+    EXPECT_FALSE(pool.submit([] {}, this, 5));
+    EXPECT_EQ(1, pool.rejected());
+
+    EXPECT_EQ(3, pool.deliver());
+    EXPECT_TRUE(pool.submit([] {}, this, 5));
+
+}
+
+
+TEST_F(WorkerTest, StepAction) {
+
+    WorkerPool pool{1, 4};
+    std::atomic<int> runs{0};
+    std::atomic<bool> release{false};
+
+    // the step action is not queued again while running, a failed action completes as well
+    auto idle = createState();
+    auto failed = createState();
+    idle->onStep = pool.stepAction([&runs, &release] {
+        runs++;
+        while(!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        throw std::runtime_error("publish failed");
+    }, 3);
+    idle->addEventTransition(3, failed);
+    idle->initialize();
+
+    for(int i = 0; i < 50; ++i)
+        step();
+
+    EXPECT_TRUE(run(pool, [&] { return runs.load() == 1; }));
+    for(int i = 0; i < 50; ++i)
+        step();
+
+    EXPECT_EQ(1, runs.load());
+    EXPECT_EQ(1, pool.pending());
+
+    // queued again once completed, until the completion event is delivered
+    release = true;
+    EXPECT_TRUE(run(pool, [&] { return currentState() == failed; }));
+    EXPECT_LE(1, pool.failed());
+
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,93 @@
+// Copyright (c) 2021 Jens Klimke.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Created by Jens Klimke on 2021-06-02.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <ShmReader.h>
+
+using namespace emb;
+
+
+namespace {
+
+    void print(const ShmReader &reader) {
+
+        ShmStatus status{};
+
+        std::printf("%-4s %-24s %-24s %12s %12s %12s\n", "#", "label", "active path", "time [s]", "transitions",
+                    "steps");
+
+        for(unsigned long i = 0; i < reader.machines(); ++i) {
+
+            if(!reader.read(i, status))
+                continue;
+
+            // path as ids separated by slashes
+            char path[64] = "-";
+            unsigned long pos = 0;
+            for(unsigned long d = 0; d < status.path.size() && pos + 12 < sizeof(path); ++d)
+                pos += (unsigned long) std::snprintf(path + pos, sizeof(path) - pos, d == 0 ? "%lu" : "/%lu",
+                                                     status.path[d]);
+
+            auto time = status.times.empty() ? 0.0 : status.times.back();
+            std::printf("%-4lu %-24s %-24s %12.3f %12lu %12lu\n", i, status.label.c_str(), path, time,
+                        status.transitions, status.publications);
+
+        }
+
+    }
+
+}
+
+
+int main(int argc, char **argv) {
+
+    if(argc < 2) {
+        std::fprintf(stderr, "usage: %s <segment> [interval in ms]\n", argv[0]);
+        return 1;
+    }
+
+    ShmReader reader{};
+    if(!reader.open(argv[1])) {
+        std::fprintf(stderr, "cannot open segment %s\n", argv[1]);
+        return 1;
+    }
+
+    // print once
+    if(argc < 3) {
+        print(reader);
+        return 0;
+    }
+
+    // print periodically
+    auto interval = std::chrono::milliseconds(std::atol(argv[2]));
+    for(;;) {
+        std::printf("\033[H\033[2J");
+        print(reader);
+        std::fflush(stdout);
+        std::this_thread::sleep_for(interval);
+    }
+
+}